@@ -0,0 +1,143 @@
+/*
+ * AlarmCore.h
+ *
+ * Header file for the alarm state shared by the LCD and 7 segment builds:
+ * the stored PIN, whether it has been set, and whether the alarm is armed.
+ * Arming and disarming go through core_arm and core_disarm so both builds
+ * behave the same way. Disarming keeps the PIN, so the panel can be armed
+ * again without setting a new one. Build specific work (logging, siren,
+ * display) is done by the caller. A new PIN is entered into newPIN and only
+ * replaces the stored pin through core_set_pin once it has been accepted.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef ALARMCORE_H_
+#define ALARMCORE_H_
+
+#include "Zones.h"
+#include "Invariant.h"
+
+#ifndef PIN_LENGTH
+#define PIN_LENGTH 4		//digits in a PIN (4 - 12), set at build time
+#endif
+#if (PIN_LENGTH < 4) || (PIN_LENGTH > 12)
+#error "PIN_LENGTH must be 4 - 12"
+#endif
+
+int pinMatches(const int a[PIN_LENGTH], const int b[PIN_LENGTH]);
+int core_arm();
+int core_disarm(const int code[PIN_LENGTH]);
+void core_set_pin(const int code[PIN_LENGTH]);
+void core_check();
+
+
+int pin[PIN_LENGTH] = {-1};		//stored pin number for arming system
+int unlockPIN[PIN_LENGTH] = {-2};	//unlock pin number for unlocking system
+int newPIN[PIN_LENGTH] = {-1};	//new pin being entered, not yet accepted
+
+int alarmEnable = 0;	//1 when alarm is enabled
+int PINset = 0;		//1 when pin has been set
+
+
+/*
+ * Function:  pinMatches
+ *  Compares two PINs. The loop length is fixed at build time and every
+ *  digit is compared, so the time taken does not depend on where the codes
+ *  differ.
+ *
+ *  a		int[]	first PIN (PIN_LENGTH digits)
+ *  b		int[]	second PIN (PIN_LENGTH digits)
+ *
+ *  returns:    1	PINs match
+ *		0	PINs differ
+ */
+int pinMatches(const int a[PIN_LENGTH], const int b[PIN_LENGTH]){
+	int diff = 0;
+
+	for(int i = 0; i < PIN_LENGTH; i++){
+		diff |= a[i] ^ b[i];
+	}
+	return diff == 0;
+}
+
+/*
+ * Function:  core_arm
+ *  Arms the alarm and starts the exit delay if a PIN has been set. Does
+ *  nothing if the alarm is already armed, so a running entry delay or
+ *  alarm is not restarted as an exit delay.
+ *
+ *  returns:    0	alarm is armed
+ *		1	no PIN has been set
+ *		2	alarm was already armed, nothing changed
+ */
+int core_arm(){
+	if(PINset != 1){
+		return 1;
+	}
+	if(alarmEnable != 0){
+		return 2;
+	}
+	alarmEnable = 1;	//set alarm enable flag
+	zones_arm();		//start exit delay
+	return 0;
+}
+
+/*
+ * Function:  core_disarm
+ *  Disarms the alarm if the code matches the stored pin. The PIN stays set.
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *
+ *  returns:    0	alarm is disarmed
+ *		1	code does not match the stored pin
+ *		2	alarm is not armed
+ */
+int core_disarm(const int code[PIN_LENGTH]){
+	if(alarmEnable == 0){
+		return 2;
+	}
+	if(!pinMatches(pin, code)){
+		return 1;
+	}
+	alarmEnable = 0;	//disable alarm
+	zones_disarm();		//stop delays and beeper
+	return 0;
+}
+
+/*
+ * Function:  core_set_pin
+ *  Replaces the stored pin. The caller checks the current pin first, if
+ *  one has been set.
+ *
+ *  code	int[]	new PIN (PIN_LENGTH digits)
+ *
+ *  returns:    none
+ */
+void core_set_pin(const int code[PIN_LENGTH]){
+	for(int i = 0; i < PIN_LENGTH; i++){
+		pin[i] = code[i];
+	}
+	PINset = 1;
+	return;
+}
+
+/*
+ * Function:  core_check
+ *  Checks the alarm state invariants: the alarm is armed exactly when the
+ *  zones are, and a stored PIN only has digits 0 - 9. Main loop only.
+ *
+ *  returns:    none
+ */
+void core_check(){
+	INV_CHECK((alarmEnable != 0) == (zoneState != ZONES_DISARMED), 
+		INV_ARM_STATE);
+	if(PINset){
+		for(int i = 0; i < PIN_LENGTH; i++){
+			INV_CHECK((pin[i] >= 0) && (pin[i] <= 9), INV_PIN_DIGIT);
+		}
+	}
+	return;
+}
+
+#endif /* ALARMCORE_H_ */
@@ -0,0 +1,117 @@
+/*
+ * Display.h
+ *
+ * Header file for the display-agnostic render model. The alarm flows set a
+ * view (what the panel wants to show) with display_show and each display
+ * driver draws that view its own way. Drivers are picked at build time and
+ * called directly, so there are no function pointers:
+ *
+ *	DISPLAY_LCD	16x2 LCD (LCDView.h, LCD build)
+ *	DISPLAY_SEG	4 digit 7 segment display (SevenSeg.h)
+ *
+ * With both defined the same view is mirrored on both displays. The
+ * driver header must be included after this file and define lcd_render or
+ * seg_render.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <avr/io.h>
+#include "Probe.h"
+#include "Invariant.h"
+
+#if !defined(DISPLAY_LCD) && !defined(DISPLAY_SEG)
+#error "define DISPLAY_LCD and/or DISPLAY_SEG"
+#endif
+
+//views
+#define VIEW_SETUP 0		//no PIN set yet
+#define VIEW_IDLE 1			//PIN set, waiting for a command
+#define VIEW_ENTER_CODE 2	//entering a new PIN, value = digits so far
+#define VIEW_ENTER_PIN 3	//entering the disarm PIN, value = digits so far
+#define VIEW_PIN 4			//newPIN shown back, value = first digit shown
+#define VIEW_ARMED 5		//alarm has just been armed
+#define VIEW_DISARMED 6		//alarm has just been disarmed
+#define VIEW_ERROR 7		//value = DISP_ERR_ message
+#define VIEW_COUNTDOWN 8	//value = seconds left (0 = none), entry flag
+#define VIEW_LOCKOUT 9		//value = seconds left
+#define VIEW_COUNT 10
+
+//VIEW_ERROR messages
+#define DISP_ERR_GENERAL 0
+#define DISP_ERR_NOT_ARMED 1
+#define DISP_ERR_WRONG_PIN 2
+
+#define DISP_COUNTDOWN_ALARM 0xFFFF	//VIEW_COUNTDOWN value after the alarm
+									//has gone off
+
+//render model
+typedef struct{
+	uint8_t view;				//VIEW_ value
+	uint8_t entry;				//1 when a countdown is an entry delay
+	uint16_t value;				//meaning depends on the view
+}DisplayModel;
+
+DisplayModel displayModel = {VIEW_SETUP, 0, 0};
+unsigned long displayFrames = 0;	//frames drawn since reset
+void (*displayTraceHook)(const DisplayModel* m) = 0;	//called after each
+														//frame, e.g. to log it
+
+#ifdef DISPLAY_LCD
+void lcd_render(const DisplayModel* m);
+#endif
+#ifdef DISPLAY_SEG
+void seg_render(const DisplayModel* m);
+#endif
+
+void display_show(uint8_t view, uint16_t value, uint8_t entry);
+void display_render();
+
+
+/*
+ * Function:  display_show
+ *  Sets the view in the render model and draws it on every display in the
+ *  build.
+ *
+ *  view	uint8_t		VIEW_ value
+ *  value	uint16_t	value for the view
+ *  entry	uint8_t		1 for an entry delay countdown, otherwise 0
+ *
+ *  returns:    none
+ */
+void display_show(uint8_t view, uint16_t value, uint8_t entry){
+	INV_CHECK(view < VIEW_COUNT, INV_VIEW);
+	displayModel.view = view;
+	displayModel.value = value;
+	displayModel.entry = entry;
+	display_render();
+	return;
+}
+
+/*
+ * Function:  display_render
+ *  Draws the current render model on every display in the build. The
+ *  drivers are called directly, not through pointers. The trace hook, if
+ *  set, sees every frame drawn.
+ *
+ *  returns:    none
+ */
+void display_render(){
+	PROBE_SCOPE(PROBE_RENDER);
+	displayFrames++;
+#ifdef DISPLAY_LCD
+	lcd_render(&displayModel);
+#endif
+#ifdef DISPLAY_SEG
+	seg_render(&displayModel);
+#endif
+	if(displayTraceHook != 0){
+		displayTraceHook(&displayModel);
+	}
+	return;
+}
+
+#endif /* DISPLAY_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Invariant.h
+ *
+ * Header file for run time invariant checks. INV_CHECK(cond, id) records a
+ * failure when cond is false and carries on, so a broken invariant shows
+ * up in the statistics instead of stopping the panel. The first failure
+ * (its ID and source line) and the number of failures are kept. Checks
+ * that need the whole alarm state are in core_check (AlarmCore.h).
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef INVARIANT_H_
+#define INVARIANT_H_
+
+#include <avr/io.h>
+
+//invariant IDs
+#define INV_ARM_STATE 1		//alarmEnable and zoneState disagree
+#define INV_PIN_DIGIT 2		//stored PIN has a digit outside 0 - 9
+#define INV_PIN_INDEX 3		//PIN digit index out of range
+#define INV_VIEW 4			//render model view out of range
+#define INV_STACK 5			//stack came within STACK_MARGIN of the heap
+
+//record a failure of id if cond is false
+#define INV_CHECK(cond, id) do{ \
+		if(!(cond)){ \
+			inv_fail((id), __LINE__); \
+		} \
+	}while(0)
+
+void inv_fail(uint8_t id, uint16_t line);
+void inv_reset();
+
+
+uint8_t invFirst = 0;		//ID of the first failure, 0 if none
+uint16_t invLine = 0;		//source line of the first failure
+uint16_t invCount = 0;		//failures, stops at 0xFFFF
+
+
+/*
+ * Function:  inv_fail
+ *  Records a failed invariant. Called by INV_CHECK.
+ *
+ *  id		uint8_t		INV_ value
+ *  line	uint16_t	source line of the check
+ *
+ *  returns:    none
+ */
+void inv_fail(uint8_t id, uint16_t line){
+	if(invCount == 0){
+		invFirst = id;
+		invLine = line;
+	}
+	if(invCount != 0xFFFF){
+		invCount++;
+	}
+	return;
+}
+
+/*
+ * Function:  inv_reset
+ *  Clears the recorded failures.
+ *
+ *  returns:    none
+ */
+void inv_reset(){
+	invFirst = 0;
+	invLine = 0;
+	invCount = 0;
+	return;
+}
+
+#endif /* INVARIANT_H_ */
@@ -0,0 +1,338 @@
+/*
+ * Panel.h
+ *
+ * Header file for the keypad menu shared by the LCD and 7 segment builds:
+ * setting the first PIN, changing it, arming and disarming, and the exit
+ * and entry delay countdown on the menu. The flows only set views in the
+ * render model (Display.h) and change the alarm state through AlarmCore.h,
+ * so both builds behave the same way. The build defines the functions
+ * below for the parts that differ, the same way Modbus.h leaves its
+ * register map to the application. They are bound at link time, so there
+ * are no function pointers.
+ *
+ *	int panelKey()				waits for the next key and returns it
+ *								(0 - 9, 0xA - 0xD, 0xE #, 0xF *). Keeps the
+ *								display, deferred work and panel_countdown
+ *								running while it waits
+ *	void panelError(int msg)	shows VIEW_ERROR with a DISP_ERR_ message
+ *								until it ends or a key cancels it
+ *	void panelPause(uint16_t ms)	keeps the current view for ms
+ *	void panelShowPIN()			shows newPIN back (VIEW_PIN) for confirming
+ *	int panelLocked()			1 if the keypad is locked out after wrong
+ *								PINs (the build shows the time left), else 0
+ *	int panelArmSystem()		arms, returns as core_arm
+ *	int panelDisarmSystem(const int code[PIN_LENGTH])
+ *								disarms, returns as core_disarm, or 3 when
+ *								locked out
+ *	int panelCheckPIN(const int code[PIN_LENGTH])
+ *								0 if code is the stored pin, 1 if not, 3
+ *								when locked out
+ *	void panelPINChanged()		the stored pin has changed, e.g. to save it
+ *
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with Display.h (Rev 1), AlarmCore.h (Rev 1) and
+ * Watchdog.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef PANEL_H_
+#define PANEL_H_
+
+#include <avr/io.h>
+#include "Display.h"
+#include "AlarmCore.h"
+#include "Zones.h"
+#include "Watchdog.h"
+
+#ifndef PANEL_ENTRY_MAX
+#define PANEL_ENTRY_MAX 16		//keys in a PIN entry before it is an error
+#endif
+#define PANEL_SHOW_MS 1000		//time the armed and disarmed messages show
+
+//task IDs kept through a watchdog reset
+#define TASK_MENU 1
+#define TASK_SETUP 2
+#define TASK_CHANGE_PIN 3
+#define TASK_ARM 4
+#define TASK_DISARM 5
+
+//application functions
+int panelKey();
+void panelError(int msg);
+void panelPause(uint16_t ms);
+void panelShowPIN();
+int panelLocked();
+int panelArmSystem();
+int panelDisarmSystem(const int code[PIN_LENGTH]);
+int panelCheckPIN(const int code[PIN_LENGTH]);
+void panelPINChanged();
+
+void panel_select();
+void panel_start();
+void panel_new_pin();
+int panel_enter_code(int changePIN);
+int panel_confirm();
+void panel_change_pin();
+void panel_arm();
+void panel_disarm();
+void panel_countdown();
+
+
+uint8_t panelIdle = 0;			//1 while the menu waits for a command
+unsigned int panelCountdown = 0;	//delay seconds shown on the menu
+
+
+/*
+ * Function:  panel_select
+ *  Runs one menu command: sets the first PIN if there is none, otherwise
+ *  shows the menu and waits for A (arm), C (change PIN) or D (disarm).
+ *  Other keys are ignored. Call from the main loop.
+ *
+ *  returns:    none
+ */
+void panel_select(){
+	int key;
+
+	if(PINset == 0){		//no PIN yet, set one
+		panel_start();
+		return;
+	}
+	wd_task(TASK_MENU);
+	display_show(VIEW_IDLE, alarmEnable, 0);
+	panelCountdown = 0;		//countdown was overwritten
+	panelIdle = 1;
+	key = panelKey();
+	panelIdle = 0;
+
+	switch(key){
+		case 0xA:
+			panel_arm();
+			break;
+		case 0xC:
+			panel_change_pin();
+			break;
+		case 0xD:
+			panel_disarm();
+			break;
+	}
+	return;
+}
+
+/*
+ * Function:  panel_start
+ *  Shows the setup screen until A or C is pressed, then sets the first PIN.
+ *
+ *  returns:    none
+ */
+void panel_start(){
+	int key;
+
+	wd_task(TASK_SETUP);
+	display_show(VIEW_SETUP, 0, 0);
+	key = panelKey();
+	while((key != 0xA) && (key != 0xC)){	//wait for A or C
+		key = panelKey();
+	}
+	panel_new_pin();
+	return;
+}
+
+/*
+ * Function:  panel_new_pin
+ *  Asks for a new PIN until one is entered and confirmed, then makes it
+ *  the stored pin. The stored pin is not touched before that.
+ *
+ *  returns:    none
+ */
+void panel_new_pin(){
+	int confirm = 1;		//0 once the user has confirmed the PIN
+
+	while(confirm != 0){
+		if(panel_enter_code(1) == 0){
+			confirm = panel_confirm();
+		}
+		else{
+			panelError(DISP_ERR_GENERAL);
+		}
+	}
+	core_set_pin(newPIN);
+	panelPINChanged();
+	return;
+}
+
+/*
+ * Function:  panel_enter_code
+ *  Reads a PIN from the keypad into newPIN or unlockPIN. Digits are
+ *  counted in the render model as they are typed, "*" deletes the last
+ *  one and "#" ends the entry. Any other key, or PANEL_ENTRY_MAX digits,
+ *  is an error. Digits past PIN_LENGTH are counted but not stored.
+ *
+ *  changePIN	int		1 reads a new pin (newPIN, VIEW_ENTER_CODE)
+ *						0 reads a pin to check (unlockPIN, VIEW_ENTER_PIN)
+ *
+ *  returns:    0	PIN_LENGTH digits were entered
+ *		1	entry was cut short or has the wrong number of digits
+ */
+int panel_enter_code(int changePIN){
+	int* code = changePIN ? newPIN : unlockPIN;
+	int view = changePIN ? VIEW_ENTER_CODE : VIEW_ENTER_PIN;
+	int n = 0;				//digits entered
+	int key;
+
+	display_show(view, 0, 0);	//prompt and empty entry
+	while(n < PANEL_ENTRY_MAX){
+		key = panelKey();
+		if(key == 0xE){		//# ends the entry
+			return (n == PIN_LENGTH) ? 0 : 1;
+		}
+		if(key == 0xF){		//* deletes the last digit
+			if(n > 0){
+				n--;
+				display_show(view, n, 0);
+			}
+			continue;
+		}
+		if((key < 0) || (key > 9)){
+			return 1;
+		}
+		if(n < PIN_LENGTH){
+			code[n] = key;
+		}
+		n++;
+		display_show(view, n, 0);
+	}
+	return 1;
+}
+
+/*
+ * Function:  panel_confirm
+ *  Shows the new PIN and asks the user to keep it (1) or enter another
+ *  (2). Other keys show an error and ask again.
+ *
+ *  returns:    0	PIN confirmed
+ *		1	user would like to enter a different PIN
+ */
+int panel_confirm(){
+	int key;
+
+	panelShowPIN();
+	key = panelKey();
+	while((key < 1) || (key > 2)){
+		panelError(DISP_ERR_GENERAL);
+		panelShowPIN();
+		key = panelKey();
+	}
+	return key - 1;
+}
+
+/*
+ * Function:  panel_change_pin
+ *  Changes the stored pin. The current pin is asked for first and checked
+ *  by the build (panelCheckPIN), so a wrong one counts towards the lockout
+ *  like a wrong disarm code.
+ *
+ *  returns:    none
+ */
+void panel_change_pin(){
+	wd_task(TASK_CHANGE_PIN);
+	if(panelLocked()){
+		return;
+	}
+	if(panel_enter_code(0) != 0){
+		panelError(DISP_ERR_GENERAL);
+		return;
+	}
+	if(panelCheckPIN(unlockPIN) != 0){
+		panelError(DISP_ERR_WRONG_PIN);
+		return;
+	}
+	panel_new_pin();
+	return;
+}
+
+/*
+ * Function:  panel_arm
+ *  Arms the alarm, or sets a PIN first if there is none. Arming while
+ *  armed changes nothing.
+ *
+ *  returns:    none
+ */
+void panel_arm(){
+	wd_task(TASK_ARM);
+	if(panelArmSystem() == 1){	//no PIN set
+		panel_new_pin();
+		return;
+	}
+	display_show(VIEW_ARMED, 0, 0);
+	panelPause(PANEL_SHOW_MS);
+	return;
+}
+
+/*
+ * Function:  panel_disarm
+ *  Asks for the PIN and disarms the alarm if it matches. The alarm stays
+ *  armed, and any delay keeps running, if it does not.
+ *
+ *  returns:    none
+ */
+void panel_disarm(){
+	wd_task(TASK_DISARM);
+	if(alarmEnable == 0){
+		panelError(DISP_ERR_NOT_ARMED);
+		return;
+	}
+	if(panelLocked()){
+		return;
+	}
+	if(panel_enter_code(0) != 0){
+		panelError(DISP_ERR_GENERAL);
+		return;
+	}
+	switch(panelDisarmSystem(unlockPIN)){
+		case 0:
+			display_show(VIEW_DISARMED, 0, 0);
+			panelPause(PANEL_SHOW_MS);
+			break;
+		case 2:				//disarmed some other way meanwhile
+			panelError(DISP_ERR_NOT_ARMED);
+			break;
+		default:
+			panelError(DISP_ERR_WRONG_PIN);
+			break;
+	}
+	return;
+}
+
+/*
+ * Function:  panel_countdown
+ *  Shows the exit or entry delay on the menu, or DISP_COUNTDOWN_ALARM once
+ *  a zone has set off the alarm. Only draws while the menu waits for a
+ *  command, and only when the number changes. If the alarm is disarmed
+ *  some other way the menu is drawn again without it. Call from panelKey.
+ *
+ *  returns:    none
+ */
+void panel_countdown(){
+	int entry = 0;
+	unsigned int left;
+
+	if(!panelIdle){
+		return;
+	}
+	left = zones_countdown(&entry);
+	if(zoneState == ZONES_ALARM){
+		left = DISP_COUNTDOWN_ALARM;	//not a countdown value
+	}
+	if(left == panelCountdown){
+		return;
+	}
+	panelCountdown = left;
+	if(zoneState == ZONES_DISARMED){
+		display_show(VIEW_IDLE, alarmEnable, 0);
+		return;
+	}
+	display_show(VIEW_COUNTDOWN, left, entry);
+	return;
+}
+
+#endif /* PANEL_H_ */
@@ -0,0 +1,249 @@
+/*
+ * Probe.h
+ *
+ * Header file for timing probes on hot paths. PROBE_SCOPE(id) at the top
+ * of a function or ISR reads a free running 16 bit timer (no prescaler,
+ * one count per CPU cycle) and the timer overflow count, and the same is
+ * read again whenever the scope is left, on any return. The cycles taken
+ * go into the min, max, count and sum for that probe. The probe names are
+ * kept in flash and probe_dump prints the table.
+ *
+ * Probes are only built with PROBE_ENABLE defined. Without it the macros
+ * are empty and nothing here is compiled. The timer is picked with
+ * PROBE_TIMER (16 bit timer 1, 3, 4 or 5, default 4) and must not be used
+ * by anything else while probes are on.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+//probe IDs, the names are in probeNames
+#define PROBE_KEYPAD_READ 0		//readNumPad
+#define PROBE_LCD_WRITE 1		//LCD_write_str
+#define PROBE_SCROLL 2			//updateScrollStr
+#define PROBE_DISPLAY 3			//updateDisplay (7 segment build)
+#define PROBE_RENDER 4			//display_render
+#define PROBE_ISR_TICK 5		//1 ms system tick
+#define PROBE_ISR_KEYPAD 6		//keypad edge or scan timer
+#define PROBE_ISR_SCROLL 7		//timer 3 scroll (LCD build)
+#define PROBE_ISR_DELAY 8		//timer 3 delay (7 segment build)
+#define PROBE_ISR_SIREN 9		//timer 1 siren (LCD build)
+#define PROBE_ISR_BLINK 10		//timer 1 blink (7 segment build)
+#define PROBE_ISR_ZONES 11		//timer 4 zone tick (7 segment build)
+#define PROBE_ISR_MB_RX 12		//Modbus receive
+#define PROBE_ISR_MB_T35 13		//Modbus end of frame
+#define PROBE_ISR_MB_TX 14		//Modbus transmit
+#define PROBE_ISR_TX0 15		//USART0 transmit
+#define PROBE_ISR_RX0 16		//USART0 receive
+#define PROBE_ISR_EEPROM 17		//EEPROM ready
+#define PROBE_COUNT 18
+
+#ifndef PROBE_ENABLE
+
+#define PROBE_SCOPE(id)
+#define probe_init()
+
+#else
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#ifndef PROBE_TIMER
+#define PROBE_TIMER 4
+#endif
+#if defined(USART0_AUTOBAUD) && (PROBE_TIMER == 4)
+#error "USART0_autobaud uses timer 4, set PROBE_TIMER to a free timer"
+#endif
+
+//timer registers for PROBE_TIMER
+#define PROBE_CAT(a, b, c) a ## b ## c
+#define PROBE_REG(a, b, c) PROBE_CAT(a, b, c)
+#define PROBE_TCNT PROBE_REG(TCNT, PROBE_TIMER, )
+#define PROBE_TCCRA PROBE_REG(TCCR, PROBE_TIMER, A)
+#define PROBE_TCCRB PROBE_REG(TCCR, PROBE_TIMER, B)
+#define PROBE_TIMSK PROBE_REG(TIMSK, PROBE_TIMER, )
+#define PROBE_TIFR PROBE_REG(TIFR, PROBE_TIMER, )
+#define PROBE_TOIE PROBE_REG(TOIE, PROBE_TIMER, )
+#define PROBE_TOV PROBE_REG(TOV, PROBE_TIMER, )
+#define PROBE_CS PROBE_REG(CS, PROBE_TIMER, 0)
+#define PROBE_OVF_vect PROBE_REG(TIMER, PROBE_TIMER, _OVF_vect)
+
+//time the rest of the enclosing scope
+#define PROBE_SCOPE(id) ProbeScope probeScope \
+	__attribute__((cleanup(probe_end))) = {probe_now(), (id)}
+
+//one timed scope, lives on the stack
+typedef struct{
+	uint32_t start;				//cycle count at the start
+	uint8_t id;
+}ProbeScope;
+
+//statistics for one probe, in CPU cycles
+typedef struct{
+	uint32_t min;
+	uint32_t max;
+	uint32_t count;
+	uint32_t sum;				//halved with count when it would overflow
+}ProbeStat;
+
+void probe_init();
+uint32_t probe_now();
+void probe_end(ProbeScope* s);
+void probe_reset();
+void probe_dump(FILE* out);
+
+
+ProbeStat probeStats[PROBE_COUNT];
+volatile uint16_t probeOverflows = 0;	//high 16 bits of the cycle count
+uint8_t probeBias = 0;				//cycles taken by the probe itself
+
+const char probeNames[PROBE_COUNT][16] PROGMEM = {
+	"readNumPad",
+	"LCD_write_str",
+	"updateScrollStr",
+	"updateDisplay",
+	"display_render",
+	"isr tick",
+	"isr keypad",
+	"isr scroll",
+	"isr delay",
+	"isr siren",
+	"isr blink",
+	"isr zones",
+	"isr modbus rx",
+	"isr modbus t3.5",
+	"isr modbus tx",
+	"isr usart0 tx",
+	"isr usart0 rx",
+	"isr eeprom"
+};
+
+/*
+ * ISR(PROBE_OVF_vect)
+ *  Counts probe timer overflows, every 4.096 ms.
+ *
+ *  returns:    none
+ */
+ISR(PROBE_OVF_vect){
+	probeOverflows++;
+}
+
+/*
+ * Function:  probe_init
+ *  Starts the probe timer in normal mode with no prescaler, measures the
+ *  cost of a probe and clears the statistics.
+ *
+ *  returns:    none
+ */
+void probe_init(){
+	PROBE_TCCRA = 0x00;			//normal mode
+	PROBE_TCCRB = (1<<PROBE_CS);	//no prescaler
+	PROBE_TIMSK |= (1<<PROBE_TOIE);
+
+	uint32_t start = probe_now();
+	probeBias = probe_now() - start;
+	probe_reset();
+	return;
+}
+
+/*
+ * Function:  probe_now
+ *  Reads the cycle count. An overflow that has happened but not been
+ *  counted yet (interrupts off) is added.
+ *
+ *  returns:    uint32_t	CPU cycles since probe_init, wraps every 268 s
+ */
+uint32_t probe_now(){
+	uint8_t sreg = SREG;		//save interrupt state
+	cli();
+	uint16_t t = PROBE_TCNT;
+	uint16_t ov = probeOverflows;
+	if((PROBE_TIFR & (1<<PROBE_TOV)) && (t < 0x8000)){
+		ov++;					//wrapped before t was read
+	}
+	SREG = sreg;				//restore interrupt state
+	return ((uint32_t)ov << 16) | t;
+}
+
+/*
+ * Function:  probe_end
+ *  Called when a PROBE_SCOPE is left. Adds the cycles taken to the
+ *  probe's statistics.
+ *
+ *  s		ProbeScope*	scope being left
+ *
+ *  returns:    none
+ */
+void probe_end(ProbeScope* s){
+	uint32_t d = probe_now() - s->start - probeBias;
+	ProbeStat* p = &probeStats[s->id];
+	uint8_t sreg = SREG;		//an ISR probe may update the same entry
+	cli();
+	if(p->sum + d < p->sum){	//keep the mean when the sum is full
+		p->sum >>= 1;
+		p->count >>= 1;
+	}
+	p->sum += d;
+	p->count++;
+	if(d < p->min){
+		p->min = d;
+	}
+	if(d > p->max){
+		p->max = d;
+	}
+	SREG = sreg;				//restore interrupt state
+	return;
+}
+
+/*
+ * Function:  probe_reset
+ *  Clears the statistics of every probe.
+ *
+ *  returns:    none
+ */
+void probe_reset(){
+	uint8_t sreg = SREG;		//save interrupt state
+	cli();
+	for(int i = 0; i < PROBE_COUNT; i++){
+		probeStats[i].min = 0xFFFFFFFF;
+		probeStats[i].max = 0;
+		probeStats[i].count = 0;
+		probeStats[i].sum = 0;
+	}
+	SREG = sreg;				//restore interrupt state
+	return;
+}
+
+/*
+ * Function:  probe_dump
+ *  Prints count, min, mean and max cycles of every probe that has run.
+ *
+ *  out		FILE*	stream to print to
+ *
+ *  returns:    none
+ */
+void probe_dump(FILE* out){
+	ProbeStat p;
+
+	fputs_P(PSTR("probe count min mean max (cycles)\n"), out);
+	for(int i = 0; i < PROBE_COUNT; i++){
+		uint8_t sreg = SREG;	//copy while no probe can change it
+		cli();
+		p = probeStats[i];
+		SREG = sreg;
+		if(p.count == 0){
+			continue;
+		}
+		fprintf_P(out, PSTR("%S %lu %lu %lu %lu\n"), probeNames[i],
+			p.count, p.min, p.sum / p.count, p.max);
+	}
+	return;
+}
+
+#endif /* PROBE_ENABLE */
+
+#endif /* PROBE_H_ */
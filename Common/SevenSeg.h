@@ -0,0 +1,296 @@
+/*
+ * SevenSeg.h
+ *
+ * Header file for the 4 digit 7 segment display driver. Draws the views of
+ * the render model (Display.h) as four characters. The digits are
+ * multiplexed, so the display only shows while seg_refresh (all digits,
+ * from a wait loop) or seg_tick (one digit per call, from a timer) is
+ * called. Segment and digit ports can be changed before including this
+ * file, e.g. to mirror the LCD build on PORTF and PORTJ.
+ * Author : Jace Johnson
+ * Rev 1
+ * Hardware:	ATMega 2560 operating at 16 MHz
+ *				four digit, seven segment display
+ *				four 330 Ohm resistors
+ * Configuration shown below (default ports)
+ *
+ * ATMega 2560
+ *  PORT   pin		   7 segment display
+ * -----------
+ * | A0-A7   |---------segments (wiring in the 7 segment build main.c)
+ * | B0-B3   |-330 Ohm-digits 1 - 4 (low turns the digit on)
+ * -----------
+ */
+
+#ifndef SEVENSEG_H_
+#define SEVENSEG_H_
+
+#include <avr/io.h>
+#include "Display.h"
+#include "AlarmCore.h"
+
+#ifndef SEG_PORT
+#define SEG_PORT PORTA			//segments
+#define SEG_DDR DDRA
+#endif
+#ifndef SEG_DIGIT_PORT
+#define SEG_DIGIT_PORT PORTB	//digit enables on the low nybble
+#define SEG_DIGIT_DDR DDRB
+#endif
+
+#define SEG_ALL 20				//displayNums index, all segments
+#define SEG_BLANK 21			//displayNums index, no segments
+
+void seg_init();
+int decodeChar(char c);
+char seg_char(int index);
+void seg_text(const char* str);
+void seg_number(uint16_t n);
+void seg_refresh();
+void seg_tick();
+
+
+int digits[4] = {20, 20, 20, 20};	//stores digits of display from left to
+					//right
+int displayOff = 0x0;	//1 turns display off
+
+//index values correspond with displayed character when array value is
+//outputted to SEG_PORT. Display characters in order: 0 - 9, A, C, D, E, I,
+//L, P, R, S, U, all segments, and no segments.
+const uint8_t displayNums[22] = {
+	0x7B, 0x0A, 0x3D, 0x1F, 0x4E, 0x57, 0x77, 0x1A, 0x7F, 0x5F,	//0 - 9
+	0x7E,	//A
+	0x71,	//C
+	0x2F,	//D
+	0x75,	//E
+	0x60,	//I
+	0x61,	//L
+	0x7C,	//P
+	0x24,	//R
+	0x57,	//S
+	0x6B,	//U
+	0xFF,	//all LEDs
+	0x00	//no LEDs
+};
+
+
+/*
+ * Function:  seg_init
+ *  Sets the segment port and the digit enables as outputs, with all digits
+ *  off.
+ *
+ *  returns:    none
+ */
+void seg_init(){
+	SEG_DDR = 0xFF;
+	SEG_DIGIT_DDR |= 0x0F;
+	SEG_DIGIT_PORT |= 0x0F;		//all digits off
+	return;
+}
+
+/*
+ * Function:  decodeChar
+ *  Outputs index value for displayNums that corresponds to the input
+ *  character c
+ *
+ *  c	input character that corresponds to a character that displays when
+ *	displayNums[index] is outputted to SEG_PORT
+ *
+ *  returns:    int		index value that corresponds to input char
+ *		20		default case for unknown input
+ */
+int decodeChar(char c){
+	switch(c){
+		case 'a':
+		case 'A':
+			return 10;
+		case 'c':
+		case 'C':
+			return 11;
+		case 'd':
+		case 'D':
+			return 12;
+		case 'e':
+		case 'E':
+			return 13;
+		case 'i':
+		case 'I':
+			return 14;
+		case 'l':
+		case 'L':
+			return 15;
+		case 'p':
+		case 'P':
+			return 16;
+		case 'r':
+		case 'R':
+			return 17;
+		case 's':
+		case 'S':
+			return 18;
+		case 'u':
+		case 'U':
+			return 19;
+		case ' ':
+			return SEG_BLANK;
+		default:
+			return SEG_ALL;
+
+	}
+	return SEG_ALL;
+}
+
+/*
+ * Function:  seg_char
+ *  Reverse of decodeChar, for showing the display as text
+ *
+ *  index	int		displayNums index
+ *
+ *  returns:    char	character shown, '8' for all segments
+ */
+char seg_char(int index){
+	static const char segChars[SEG_BLANK + 1] = "0123456789ACDEILPRSU8 ";
+
+	if((index < 0) || (index > SEG_BLANK)){
+		return '?';
+	}
+	return segChars[index];
+}
+
+/*
+ * Function:  seg_text
+ *  Sets the four digits to a four character string
+ *
+ *  str		const char*	four characters from decodeChar's set
+ *
+ *  returns:    none
+ */
+void seg_text(const char* str){
+	for(int i = 0; i < 4; i++){
+		digits[i] = decodeChar(str[i]);
+	}
+	return;
+}
+
+/*
+ * Function:  seg_number
+ *  Sets the last two digits to a number up to 99, tens blank below 10
+ *
+ *  n		uint16_t	number to show, larger numbers show as 99
+ *
+ *  returns:    none
+ */
+void seg_number(uint16_t n){
+	if(n > 99){
+		n = 99;
+	}
+	digits[2] = (n >= 10) ? n / 10 : SEG_BLANK;	//tens, blank below 10
+	digits[3] = n % 10;							//ones
+	return;
+}
+
+/*
+ * Function:  seg_render
+ *  Draws a view of the render model on the four digits
+ *
+ *  m		const DisplayModel*	render model
+ *
+ *  returns:    none
+ */
+void seg_render(const DisplayModel* m){
+	switch(m->view){
+		case VIEW_SETUP:
+			seg_text("####");		//all segments
+			break;
+		case VIEW_IDLE:				//ALAR while armed, SUCC otherwise
+			seg_text(m->value ? "alar" : "succ");
+			break;
+		case VIEW_ENTER_CODE:
+			seg_text("ecde");
+			break;
+		case VIEW_ENTER_PIN:
+			seg_text("erpi");
+			break;
+		case VIEW_PIN:				//four PIN digits from value on
+			if(m->value + 4 > PIN_LENGTH){	//past the end of the PIN
+				inv_fail(INV_PIN_INDEX, __LINE__);
+				break;
+			}
+			for(int i = 0; i < 4; i++){
+				digits[i] = newPIN[m->value + i];
+			}
+			break;
+		case VIEW_ARMED:
+			seg_text("alar");
+			break;
+		case VIEW_DISARMED:
+			seg_text("succ");
+			break;
+		case VIEW_ERROR:
+			seg_text("err ");
+			break;
+		case VIEW_COUNTDOWN:		//A (exit) or E (entry) and seconds
+			if((m->value == 0) || (m->value == DISP_COUNTDOWN_ALARM)){
+				seg_text("alar");
+				break;
+			}
+			seg_text(m->entry ? "e   " : "a   ");
+			seg_number(m->value);
+			break;
+		case VIEW_LOCKOUT:			//L and seconds
+			seg_text("l   ");
+			seg_number(m->value);
+			break;
+	}
+	return;
+}
+
+/*
+ * Function:  seg_refresh
+ *  toggle though each seven segment display digit and display the
+ *  corresponding digit stored in the digits array. Call from a wait loop.
+ *
+ *  returns:    none
+ */
+void seg_refresh(){
+	SEG_PORT = 0x00;		//clear segments
+
+	if(displayOff == 0x1){	//if display should be off, exit
+		SEG_DIGIT_PORT |= 0x0F;	//set all digits high (turn off all digits)
+		return;
+	}
+
+	//loop to turn off all digits, update the displayed number, and turn on
+	//the next digit
+	for(int i = 0; i < 4; i++){
+		SEG_DIGIT_PORT |= 0x0F;	//set all digits high (turn off all digits)
+
+		SEG_PORT = displayNums[digits[i]];	//display stored digit for the
+											//current location
+
+		SEG_DIGIT_PORT &= ~(1 << i);	//turn on current digit
+	}
+	return;
+}
+
+/*
+ * Function:  seg_tick
+ *  Shows the next digit each call, so each digit is lit for a quarter of
+ *  the time. Call from a timer, e.g. the 1 ms system tick.
+ *
+ *  returns:    none
+ */
+void seg_tick(){
+	static uint8_t i = 0;		//digit shown by this call
+
+	SEG_DIGIT_PORT |= 0x0F;		//all digits off while segments change
+	if(displayOff == 0x1){
+		return;
+	}
+	SEG_PORT = displayNums[digits[i]];
+	SEG_DIGIT_PORT &= ~(1 << i);
+	i = (i + 1) & 0x03;
+	return;
+}
+
+#endif /* SEVENSEG_H_ */
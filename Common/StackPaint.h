@@ -0,0 +1,169 @@
+/*
+ * StackPaint.h
+ *
+ * Header file for the stack high water mark and the RAM budget. Before
+ * main runs, every byte from the end of the static data (.data, .bss and
+ * .noinit) to the top of RAM is painted with STACK_CANARY. The stack grows
+ * down into the painted bytes and the heap (if malloc is ever used) grows
+ * up into them, so the lowest byte that is no longer the canary is the
+ * deepest the stack has been, interrupts included.
+ *
+ * stack_check scans a few bytes per call, from the top of the heap up to
+ * the lowest used byte found so far, and starts again when it reaches it.
+ * Call it from a loop that runs often; each call takes a few us.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef STACKPAINT_H_
+#define STACKPAINT_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "Invariant.h"
+
+#define STACK_CANARY 0xC5		//paint value, unlikely as a return address
+#define STACK_CHECK_BYTES 32	//bytes scanned per stack_check call
+#define STACK_MARGIN 128		//least free RAM before INV_STACK fails
+
+void stack_paint() __attribute__((naked, used, section(".init1")));
+uint8_t* ram_heap_top();
+void stack_check();
+uint16_t ram_static();
+uint16_t ram_heap();
+uint16_t stack_max();
+uint16_t stack_now();
+uint16_t ram_free_min();
+
+extern uint8_t __data_start;	//linker symbols, first byte of .data
+extern uint8_t __heap_start;	//first byte after .data, .bss and .noinit
+extern uint8_t* __brkval __attribute__((weak));	//malloc heap top, only
+												//linked if malloc is used
+
+uint8_t* stackLow = (uint8_t*)(RAMEND + 1);	//lowest stack byte seen used
+uint8_t* stackScan = 0;						//next byte stack_check looks at
+
+
+/*
+ * Function:  stack_paint
+ *  Fills RAM from __heap_start to RAMEND with STACK_CANARY. Runs from
+ *  .init1, before the stack is in use and before .data and .bss are set
+ *  up, so it is written in assembly and uses no stack.
+ *
+ *  returns:    none
+ */
+void stack_paint(){
+	asm volatile(
+		"	ldi r30, lo8(__heap_start)\n"
+		"	ldi r31, hi8(__heap_start)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(%1)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(%1)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (STACK_CANARY), "i" (RAMEND));
+	//no return, runs on into the next .init section
+}
+
+/*
+ * Function:  ram_heap_top
+ *  Finds the first byte above the heap, which is the end of the static
+ *  data while malloc has not been used.
+ *
+ *  returns:    uint8_t*	lowest byte the stack may grow into
+ */
+uint8_t* ram_heap_top(){
+	if((&__brkval != 0) && (__brkval != 0)){
+		return __brkval;
+	}
+	return &__heap_start;
+}
+
+/*
+ * Function:  stack_check
+ *  Scans up to STACK_CHECK_BYTES painted bytes for one that has been
+ *  written. The first one found in a pass is the new high water mark, and
+ *  less than STACK_MARGIN bytes left above the heap is an INV_STACK
+ *  failure. Main loop only.
+ *
+ *  returns:    none
+ */
+void stack_check(){
+	uint8_t* bottom = ram_heap_top();
+
+	if((stackScan < bottom) || (stackScan >= stackLow)){
+		stackScan = bottom;		//start a new pass
+	}
+	for(int i = 0; i < STACK_CHECK_BYTES; i++){
+		if(stackScan >= stackLow){
+			return;				//nothing deeper this pass
+		}
+		if(*stackScan != STACK_CANARY){
+			stackLow = stackScan;
+			INV_CHECK(ram_free_min() >= STACK_MARGIN, INV_STACK);
+			return;
+		}
+		stackScan++;
+	}
+	return;
+}
+
+/*
+ * Function:  ram_static
+ *  Size of the static data.
+ *
+ *  returns:    uint16_t	bytes in .data, .bss and .noinit
+ */
+uint16_t ram_static(){
+	return &__heap_start - &__data_start;
+}
+
+/*
+ * Function:  ram_heap
+ *  Size of the heap.
+ *
+ *  returns:    uint16_t	bytes taken by malloc, 0 if it is not used
+ */
+uint16_t ram_heap(){
+	return ram_heap_top() - &__heap_start;
+}
+
+/*
+ * Function:  stack_max
+ *  Deepest the stack has been, as far as stack_check has scanned.
+ *
+ *  returns:    uint16_t	bytes
+ */
+uint16_t stack_max(){
+	return (uint8_t*)(RAMEND + 1) - stackLow;
+}
+
+/*
+ * Function:  stack_now
+ *  Current depth of the stack.
+ *
+ *  returns:    uint16_t	bytes
+ */
+uint16_t stack_now(){
+	return RAMEND - SP;
+}
+
+/*
+ * Function:  ram_free_min
+ *  Smallest gap there has been between the heap and the stack.
+ *
+ *  returns:    uint16_t	bytes
+ */
+uint16_t ram_free_min(){
+	uint8_t* top = ram_heap_top();
+
+	if(stackLow <= top){		//stack has run into the heap
+		return 0;
+	}
+	return stackLow - top;
+}
+
+#endif /* STACKPAINT_H_ */
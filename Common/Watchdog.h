@@ -0,0 +1,197 @@
+/*
+ * Watchdog.h
+ *
+ * Header file for a watchdog supervisor. The hardware watchdog is only 
+ * kicked while every required task has sent a heartbeat (wd_beat) within
+ * the last WD_WINDOW_MS. If a task stops, the supervisor stops kicking and
+ * the watchdog resets the panel WDTO_2S later.
+ *
+ * A record in .noinit RAM survives the reset. It holds the ID of the last
+ * task the application started, the heartbeats that were missing, and a 
+ * few bytes of application state (e.g. the arm state) so the panel can 
+ * carry on where it was instead of starting from scratch. The record has a
+ * check byte and is ignored after a power on reset, when RAM is random.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <string.h>
+#include <util/atomic.h>
+
+#ifndef WD_TICK_MS
+#define WD_TICK_MS 1			//wd_tick period
+#endif
+#define WD_WINDOW_MS 8000		//time each task has to send a heartbeat
+#define WD_STATE_SIZE 16		//bytes of application state kept
+#define WD_MAGIC 0x5D1E			//marks a record written by this code
+
+//record kept through a reset
+typedef struct{
+	uint16_t magic;				//WD_MAGIC
+	uint8_t lastTask;			//last task ID from wd_task
+	uint8_t missing;			//heartbeats missing when the kicks stopped
+	uint8_t state[WD_STATE_SIZE];	//application state
+	uint8_t check;				//xor of the bytes above
+}WatchdogRecord;
+
+void wd_early(void) __attribute__((naked, used, section(".init3")));
+int wd_init(uint8_t required);
+void wd_beat(uint8_t tasks);
+void wd_task(uint8_t id);
+void wd_save_state(const void* state, int len);
+void wd_tick();
+uint8_t wd_check();
+void wd_seal();
+
+WatchdogRecord wdRecord __attribute__((section(".noinit")));
+uint8_t wdResetFlags __attribute__((section(".noinit")));	//MCUSR at reset
+volatile uint8_t wdBeats = 0;		//heartbeats seen in this window
+uint8_t wdRequired = 0;				//heartbeats needed each window
+uint16_t wdWindowCount = 0;			//ticks in this window
+volatile uint8_t wdFailed = 0;		//1 once the kicks have stopped
+
+/*
+ * Function:  wd_early
+ *  Runs before main. Saves the reset cause and turns the watchdog off, 
+ *	because it stays on with the shortest timeout after a watchdog reset.
+ *
+ *  returns:    none
+ */
+void wd_early(void){
+	wdResetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+/*
+ * Function:  wd_init
+ *  Checks the record kept through the reset and starts the watchdog.
+ *
+ *	required	uint8_t		heartbeat bits needed in each window
+ *
+ *  returns:    1 record is valid, its state can be restored
+ *		0 power on or record is corrupt, record is cleared
+ */
+int wd_init(uint8_t required){
+	int valid = (wdRecord.magic == WD_MAGIC) && 
+		(wd_check() == wdRecord.check) && !(wdResetFlags & (1<<PORF));
+	
+	if(!valid){
+		memset(&wdRecord, 0, sizeof(wdRecord));
+		wdRecord.magic = WD_MAGIC;
+		wd_seal();
+	}
+	wdRequired = required;
+	wdBeats = 0;
+	wdWindowCount = 0;
+	wdFailed = 0;
+	wdt_enable(WDTO_2S);
+	return valid;
+}
+
+/*
+ * Function:  wd_beat
+ *  Sends heartbeats.
+ *
+ *	tasks	uint8_t		heartbeat bits
+ *
+ *  returns:    none
+ */
+void wd_beat(uint8_t tasks){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		wdBeats |= tasks;
+	}
+	return;
+}
+
+/*
+ * Function:  wd_task
+ *  Records the task that is running, reported after a watchdog reset.
+ *
+ *	id		uint8_t		task ID
+ *
+ *  returns:    none
+ */
+void wd_task(uint8_t id){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		wdRecord.lastTask = id;
+		wd_seal();
+	}
+	return;
+}
+
+/*
+ * Function:  wd_save_state
+ *  Stores application state in the record.
+ *
+ *	state	void*	state to keep
+ *	len		int		bytes of state (at most WD_STATE_SIZE)
+ *
+ *  returns:    none
+ */
+void wd_save_state(const void* state, int len){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		memcpy(wdRecord.state, state, len);
+		wd_seal();
+	}
+	return;
+}
+
+/*
+ * Function:  wd_tick
+ *  Kicks the watchdog while all heartbeats keep arriving. Called from a 
+ *	timer interrupt every WD_TICK_MS.
+ *
+ *  returns:    none
+ */
+void wd_tick(){
+	if(wdFailed){
+		return;					//let the watchdog reset the panel
+	}
+	if(++wdWindowCount >= WD_WINDOW_MS / WD_TICK_MS){
+		wdWindowCount = 0;
+		if((wdBeats & wdRequired) != wdRequired){
+			wdRecord.missing = wdRequired & ~wdBeats;
+			wd_seal();
+			wdFailed = 1;
+			return;
+		}
+		wdBeats = 0;
+	}
+	wdt_reset();
+	return;
+}
+
+/*
+ * Function:  wd_check
+ *  Computes the check byte of the record.
+ *
+ *  returns:    uint8_t		xor of the record bytes before the check byte
+ */
+uint8_t wd_check(){
+	uint8_t* b = (uint8_t*)&wdRecord;
+	uint8_t check = 0xA5;
+	
+	for(int i = 0; i < sizeof(wdRecord) - 1; i++){
+		check ^= b[i];
+	}
+	return check;
+}
+
+/*
+ * Function:  wd_seal
+ *  Updates the check byte after the record has changed.
+ *
+ *  returns:    none
+ */
+void wd_seal(){
+	wdRecord.check = wd_check();
+	return;
+}
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * WorkQueue.h
+ *
+ * Header file for a deferred work queue. Interrupts only post a function
+ * and a one byte argument (work_post) and the main loop runs them later
+ * (work_run), so slow work like LCD writes and keypad scans happens with
+ * interrupts enabled. There is one ring per priority and work_run always
+ * takes the highest priority item first.
+ *
+ * AVR interrupts do not nest, so posts from interrupts never race each
+ * other. Each ring has one writer for head (the interrupt posting) and
+ * one for tail (work_run), so no interrupts are disabled. work_post must
+ * only be called from interrupt context.
+ *
+ * WORK_ISR_BEGIN and WORK_ISR_END time an interrupt on a free running
+ * timer with a /64 prescaler (4 us per count). The longest time and the
+ * deepest the queue has been are kept as statistics.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef WORKQUEUE_H_
+#define WORKQUEUE_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#ifndef WORK_TIMER
+#define WORK_TIMER TCNT0			//timer counting at 4 us (SysTick.h)
+#define WORK_TIMER_TOP (OCR0A + 1)	//counts per timer period
+#endif
+#define WORK_US_PER_COUNT 4			//16 MHz / 64
+
+#define WORK_SLOTS 8				//items per priority, power of 2
+#define WORK_PRIORITIES 3
+#define WORK_HIGH 0					//keypad
+#define WORK_NORMAL 1
+#define WORK_LOW 2					//display refresh
+
+//start and end an interrupt timing, one pair per ISR
+#define WORK_ISR_BEGIN() uint16_t workIsrStart = WORK_TIMER
+#define WORK_ISR_END() work_isr_time(workIsrStart)
+
+//deferred function call
+typedef struct{
+	void (*fn)(uint8_t arg);
+	uint8_t arg;
+}WorkItem;
+
+//one priority of the queue
+typedef struct{
+	WorkItem item[WORK_SLOTS];
+	volatile uint8_t head;		//next free slot, written by work_post
+	volatile uint8_t tail;		//next item to run, written by work_run
+}WorkRing;
+
+int work_post(uint8_t prio, void (*fn)(uint8_t arg), uint8_t arg);
+int work_run();
+void work_isr_time(uint16_t start);
+uint16_t work_isr_max_us();
+void work_stats_reset();
+
+
+WorkRing workRings[WORK_PRIORITIES];
+volatile uint8_t workMaxDepth = 0;	//most items waiting at once
+volatile uint16_t workDropped = 0;	//posts lost to a full ring
+volatile uint16_t workIsrMax = 0;	//longest timed interrupt (timer counts)
+
+
+/*
+ * Function:  work_post
+ *  Adds a function call to the queue. Interrupt context only.
+ *
+ *  prio	uint8_t		WORK_HIGH, WORK_NORMAL or WORK_LOW
+ *  fn		void(*)(uint8_t)	function for work_run to call
+ *  arg		uint8_t		argument passed to fn
+ *
+ *  returns:    0	posted
+ *		-1	ring for that priority is full, the call is dropped
+ */
+int work_post(uint8_t prio, void (*fn)(uint8_t arg), uint8_t arg){
+	WorkRing* r = &workRings[prio];
+	uint8_t head = r->head;
+	uint8_t next = (head + 1) & (WORK_SLOTS - 1);
+	uint8_t depth = 0;
+
+	if(next == r->tail){
+		workDropped++;
+		return -1;
+	}
+	r->item[head].fn = fn;
+	r->item[head].arg = arg;
+	r->head = next;				//item is complete before it is visible
+
+	for(int i = 0; i < WORK_PRIORITIES; i++){
+		depth += (workRings[i].head - workRings[i].tail) & (WORK_SLOTS - 1);
+	}
+	if(depth > workMaxDepth){
+		workMaxDepth = depth;
+	}
+	return 0;
+}
+
+/*
+ * Function:  work_run
+ *  Runs every waiting item, highest priority first. Items posted while
+ *  this runs are run too. Main loop only.
+ *
+ *  returns:    int	number of items run
+ */
+int work_run(){
+	int count = 0;
+	int prio = 0;
+
+	while(prio < WORK_PRIORITIES){
+		WorkRing* r = &workRings[prio];
+		uint8_t tail = r->tail;
+
+		if(tail == r->head){	//this priority is empty, try the next
+			prio++;
+			continue;
+		}
+		WorkItem w = r->item[tail];
+		r->tail = (tail + 1) & (WORK_SLOTS - 1);	//slot free once copied
+		w.fn(w.arg);
+		count++;
+		prio = 0;				//higher priority work may have arrived
+	}
+	return count;
+}
+
+/*
+ * Function:  work_isr_time
+ *  Ends an interrupt timing started by WORK_ISR_BEGIN and keeps the
+ *  longest. Times longer than one timer period are under-reported.
+ *
+ *  start	uint16_t	timer count at the start of the interrupt
+ *
+ *  returns:    none
+ */
+void work_isr_time(uint16_t start){
+	uint16_t now = WORK_TIMER;
+	uint16_t counts;
+
+	if(now >= start){
+		counts = now - start;
+	}
+	else{						//timer wrapped at TOP
+		counts = now + WORK_TIMER_TOP - start;
+	}
+	if(counts > workIsrMax){
+		workIsrMax = counts;
+	}
+	return;
+}
+
+/*
+ * Function:  work_isr_max_us
+ *  Reads the longest timed interrupt.
+ *
+ *  returns:    uint16_t	longest interrupt in us
+ */
+uint16_t work_isr_max_us(){
+	uint16_t counts;
+	uint8_t sreg = SREG;	//save interrupt state
+	cli();
+	counts = workIsrMax;
+	SREG = sreg;			//restore interrupt state
+	return counts * WORK_US_PER_COUNT;
+}
+
+/*
+ * Function:  work_stats_reset
+ *  Clears the longest interrupt time, deepest queue and dropped count.
+ *
+ *  returns:    none
+ */
+void work_stats_reset(){
+	uint8_t sreg = SREG;	//save interrupt state
+	cli();
+	workIsrMax = 0;
+	workMaxDepth = 0;
+	workDropped = 0;
+	SREG = sreg;			//restore interrupt state
+	return;
+}
+
+#endif /* WORKQUEUE_H_ */
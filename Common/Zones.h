@@ -0,0 +1,330 @@
+/*
+ * Zones.h
+ *
+ * Header file for alarm zone inputs with exit and entry delays. Zones are
+ * normally closed contacts on PORTK (pulled up, an open contact reads 1 
+ * and trips the zone). zones_tick must be called every ZONE_TICK_MS from 
+ * a timer interrupt. It debounces the inputs, counts down the exit delay 
+ * and one entry delay per zone, and drives the beeper. All delays share 
+ * that one tick, so no timer is used per zone. The other functions keep
+ * the interrupt state they are called with, so they can also be used 
+ * before interrupts are enabled or from an interrupt.
+ * Author : Jace Johnson
+ * Rev 1
+ * Hardware:	ATMega 2560 operating at 16 MHz
+ *				up to 8 normally closed zone contacts
+ *				piezo beeper with driver
+ * Configuration shown below
+ *
+ * ATMega 2560
+ *  PORT   pin
+ * -----------
+ * | K0    89|---zone 0 contact---GND
+ * |  ...    |
+ * | K7    82|---zone 7 contact---GND
+ * | B4    10|---beeper
+ * -----------
+ *
+ * Zones in the entry mask start an entry delay when they trip and only set
+ * off the alarm if it runs out. They are ignored during the exit delay. 
+ * Other zones set off the alarm at once. The beeper chirps once a second 
+ * during a delay, twice a second in the last 10 s and four times a second
+ * in the last 5 s, and stays on once the alarm has gone off.
+ */
+
+#ifndef ZONES_H_
+#define ZONES_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define ZONE_COUNT 8
+#define ZONE_TICK_MS 10				//zones_tick period
+#define ZONE_TICKS_PER_S (1000 / ZONE_TICK_MS)
+#define ZONE_DEBOUNCE 3				//equal samples before a change counts
+#define ZONE_BEEP_PIN PB4			//beeper on PORTB
+#define ZONE_CHIRP 5				//ticks the beeper is on for each chirp
+
+//zone states
+#define ZONES_DISARMED 0
+#define ZONES_EXIT 1				//armed, exit delay running
+#define ZONES_ARMED 2
+#define ZONES_ALARM 3
+
+void zones_init(uint8_t mask, uint8_t entryMask, uint8_t exitDelay, 
+	uint8_t entryDelay);
+void zones_arm();
+void zones_disarm();
+void zones_restore(uint8_t state);
+void zones_tick();
+void zones_trip(int zone);
+void zones_beep(uint16_t left);
+unsigned int zones_countdown(int* entry);
+uint8_t zones_take_trips();
+
+volatile uint8_t zoneState = ZONES_DISARMED;
+volatile uint8_t zoneOpen = 0;			//debounced zones that are open
+volatile uint8_t zoneNewTrips = 0;		//alarm zones not yet reported
+volatile uint16_t zoneExitLeft = 0;		//ticks left in the exit delay
+volatile uint16_t zoneEntryLeft[ZONE_COUNT];	//ticks left, 0 when not running
+uint8_t zoneMask;				//zones in use
+uint8_t zoneEntryMask;			//zones with an entry delay
+uint16_t zoneExitTicks;			//exit delay in ticks
+uint16_t zoneEntryTicks;		//entry delay in ticks
+uint8_t zoneSample;				//last raw sample
+uint8_t zoneSameCount = 0;		//equal samples in a row
+
+/*
+ * Function:  zones_init
+ *  Sets up the zone inputs and beeper and sets the delays.
+ *
+ *	mask		uint8_t		zones in use
+ *	entryMask	uint8_t		zones with an entry delay
+ *	exitDelay	uint8_t		exit delay (s)
+ *	entryDelay	uint8_t		entry delay (s)
+ *
+ *  returns:    none
+ */
+void zones_init(uint8_t mask, uint8_t entryMask, uint8_t exitDelay, 
+	uint8_t entryDelay){
+	DDRK = 0x00;				//zone inputs with pull ups
+	PORTK = 0xFF;
+	DDRB |= (1<<ZONE_BEEP_PIN);
+	PORTB &= ~(1<<ZONE_BEEP_PIN);
+	
+	zoneMask = mask;
+	zoneEntryMask = entryMask;
+	zoneExitTicks = exitDelay * ZONE_TICKS_PER_S;
+	zoneEntryTicks = entryDelay * ZONE_TICKS_PER_S;
+	return;
+}
+
+/*
+ * Function:  zones_arm
+ *  Arms the zones and starts the exit delay.
+ *
+ *  returns:    none
+ */
+void zones_arm(){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		for(int i = 0; i < ZONE_COUNT; i++){
+			zoneEntryLeft[i] = 0;
+		}
+		zoneExitLeft = zoneExitTicks;
+		zoneState = (zoneExitTicks > 0) ? ZONES_EXIT : ZONES_ARMED;
+	}
+	return;
+}
+
+/*
+ * Function:  zones_disarm
+ *  Disarms the zones, stops all delays and the beeper.
+ *
+ *  returns:    none
+ */
+void zones_disarm(){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		zoneState = ZONES_DISARMED;
+		zoneExitLeft = 0;
+		for(int i = 0; i < ZONE_COUNT; i++){
+			zoneEntryLeft[i] = 0;
+		}
+		PORTB &= ~(1<<ZONE_BEEP_PIN);
+	}
+	return;
+}
+
+/*
+ * Function:  zones_restore
+ *  Puts the zones back in a saved state after a reset. An exit delay is
+ *	started again from the full time, and so is an entry delay if its zone 
+ *	is still open.
+ *
+ *	state	uint8_t		saved zone state (ZONES_ states)
+ *
+ *  returns:    none
+ */
+void zones_restore(uint8_t state){
+	if(state == ZONES_EXIT){
+		zones_arm();
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		zoneState = (state > ZONES_ALARM) ? ZONES_DISARMED : state;
+	}
+	return;
+}
+
+/*
+ * Function:  zones_tick
+ *  Samples and debounces the zones, counts down the delays and drives the
+ *	beeper. Called from a timer interrupt every ZONE_TICK_MS.
+ *
+ *  returns:    none
+ */
+void zones_tick(){
+	uint8_t raw = PINK & zoneMask;
+	uint16_t left = 0;			//shortest delay running
+	uint8_t bit;
+	
+	if(raw == zoneSample){		//debounce
+		if(zoneSameCount < ZONE_DEBOUNCE){
+			zoneSameCount++;
+		}
+		else{
+			zoneOpen = raw;
+		}
+	}
+	else{
+		zoneSample = raw;
+		zoneSameCount = 0;
+	}
+	
+	switch(zoneState){
+		case ZONES_EXIT:
+			bit = zoneOpen & ~zoneEntryMask;	//instant zones stay armed
+			if(bit != 0){
+				for(int i = 0; i < ZONE_COUNT; i++){
+					if(bit & (1 << i)){
+						zones_trip(i);
+						break;
+					}
+				}
+				break;
+			}
+			if(--zoneExitLeft == 0){
+				zoneState = ZONES_ARMED;
+			}
+			left = zoneExitLeft;
+			break;
+		case ZONES_ARMED:
+			for(int i = 0; i < ZONE_COUNT; i++){
+				bit = 1 << i;
+				if(zoneEntryLeft[i] != 0){	//entry delay running
+					if(--zoneEntryLeft[i] == 0){
+						zones_trip(i);
+						break;
+					}
+					if((left == 0) || (zoneEntryLeft[i] < left)){
+						left = zoneEntryLeft[i];
+					}
+				}
+				else if(zoneOpen & bit){
+					if((zoneEntryMask & bit) && (zoneEntryTicks > 0)){
+						zoneEntryLeft[i] = zoneEntryTicks;
+						left = (left == 0) ? zoneEntryTicks : left;
+					}
+					else{
+						zones_trip(i);
+						break;
+					}
+				}
+			}
+			break;
+		default:
+			break;
+	}
+	zones_beep(left);
+	return;
+}
+
+/*
+ * Function:  zones_trip
+ *  Sets off the alarm.
+ *
+ *	zone	int		zone that set off the alarm
+ *
+ *  returns:    none
+ */
+void zones_trip(int zone){
+	zoneState = ZONES_ALARM;
+	zoneNewTrips |= (1 << zone);
+	return;
+}
+
+/*
+ * Function:  zones_beep
+ *  Drives the beeper. Chirps faster as the shortest delay runs out and is
+ *	on all the time once the alarm has gone off.
+ *
+ *	left	uint16_t	ticks left in the shortest delay, 0 if none
+ *
+ *  returns:    none
+ */
+void zones_beep(uint16_t left){
+	uint16_t period;
+	
+	if(zoneState == ZONES_ALARM){
+		PORTB |= (1<<ZONE_BEEP_PIN);
+		return;
+	}
+	if(left == 0){
+		PORTB &= ~(1<<ZONE_BEEP_PIN);
+		return;
+	}
+	if(left > 10 * ZONE_TICKS_PER_S){
+		period = ZONE_TICKS_PER_S;
+	}
+	else if(left > 5 * ZONE_TICKS_PER_S){
+		period = ZONE_TICKS_PER_S / 2;
+	}
+	else{
+		period = ZONE_TICKS_PER_S / 4;
+	}
+	if((left % period) < ZONE_CHIRP){
+		PORTB |= (1<<ZONE_BEEP_PIN);
+	}
+	else{
+		PORTB &= ~(1<<ZONE_BEEP_PIN);
+	}
+	return;
+}
+
+/*
+ * Function:  zones_countdown
+ *  Seconds left in the exit delay or the shortest entry delay.
+ *
+ *	entry	int*	set to 1 for an entry delay, 0 for the exit delay
+ *
+ *  returns:    unsigned int	seconds left (rounded up), 0 if no delay
+ */
+unsigned int zones_countdown(int* entry){
+	uint16_t left = 0;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		if(zoneState == ZONES_EXIT){
+			left = zoneExitLeft;
+			*entry = 0;
+		}
+		else if(zoneState == ZONES_ARMED){
+			for(int i = 0; i < ZONE_COUNT; i++){
+				if((zoneEntryLeft[i] != 0) && 
+				   ((left == 0) || (zoneEntryLeft[i] < left))){
+					left = zoneEntryLeft[i];
+				}
+			}
+			*entry = 1;
+		}
+	}
+	return (left + ZONE_TICKS_PER_S - 1) / ZONE_TICKS_PER_S;
+}
+
+/*
+ * Function:  zones_take_trips
+ *  Zones that have set off the alarm since the last call, so they can be
+ *	reported outside the interrupt.
+ *
+ *  returns:    uint8_t		zone bits
+ */
+uint8_t zones_take_trips(){
+	uint8_t trips;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		trips = zoneNewTrips;
+		zoneNewTrips = 0;
+	}
+	return trips;
+}
+
+#endif
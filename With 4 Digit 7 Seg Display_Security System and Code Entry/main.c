@@ -12,6 +12,7 @@
  *		four digit, seven segment display
  *		4x4 keypad module
  *		four 330 Ohm resistors
+ *		zone contacts and beeper (wiring in Zones.h)
  *		jumper wires
  * Configuration shown below
  *
@@ -48,60 +49,62 @@
 
 #define F_CPU 16000000
 
+#define DISPLAY_SEG		//render on the 7 segment display (Display.h)
+#define PROBE_TIMER 5		//timing probes, when built with -DPROBE_ENABLE
+#define MARQUEE_STEP 500	//ms each position of a long PIN is shown
+
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <math.h>
 #include <util/delay.h>
+#include "../Common/Zones.h"
+
+#define WD_TICK_MS ZONE_TICK_MS	//supervisor runs on the zone tick
+#include "../Common/Watchdog.h"
+#include "../Common/StackPaint.h"	//no console, read stackLow with a debugger
+#include "../Common/AlarmCore.h"
+#include "../Common/Display.h"
+#include "../Common/SevenSeg.h"
+#include "../Common/Panel.h"
+
+#define WORK_TIMER TCNT4		//interrupt timing on the zone tick timer
+#define WORK_TIMER_TOP (OCR4A + 1)
+#include "../Common/WorkQueue.h"
+
+#define EXIT_DELAY 30		//seconds to leave after arming
+#define ENTRY_DELAY 30		//seconds to disarm after the door zone trips
+#define ENTRY_ZONES 0x01	//zones with an entry delay (zone 0 is the door)
+#define KEY_CLEAR_SCANS 10	//scans the keypad must read clear before the next
+							//key, about 17 ms as timer0 overflows every 1.7 ms
+
+//heartbeats the watchdog supervisor needs
+#define BEAT_KEYPAD 0x01	//keypad scan interrupt running
+#define BEAT_DISPLAY 0x02	//main loop refreshing the display
 
 void init();
 void initializePorts();
 void initializeTimers();
-void fillNumArray();
-int decodeChar(char c);
-void setEnterCode();
-void setSuccess();
-void setAlarm();
-void setError();
-void setEnterPIN();
-void setStart();
-void setPIN();
 void setTimer3(int t);
 void disableTimer1();
 void enableTimer1Blink500();
-void err();
 void updateDisplay();
 void checkNumPad();
+void keypadWork(uint8_t arg);
 int readNumPad();
-void start();
-int enterCode();
-int fillPIN(int index, int changePIN);
-void succPIN();
-void enAlarm();
-void disAlarm();
-void selection();
+void saveState();
+void restoreState();
 
 
-int pin[4] = {-1, 0, 0, 0};		//stored pin number for arming system
-int unlockPIN[4] = {-2, 0, 0, 0};	//unlock pin number for unlocking system
 						
-int input = 0;		//stores input from number pad
+int input = -1;		//stores input from number pad, -1 when taken
 int timer3Finish = 0;	//1 when timer 0 finishes
-int displayOff = 0x0;	//1 turns display off
 int keypadClear = 1;	//1 when keypad buttons are unpressed
+int keyClearScans = 0;	//scans in a row the keypad has read clear
 
-int alarmEnable = 0;	//1 when alarm is enabled
-int PINset = 0;		//1 when pin has been set
-
-int digits[4] = {20, 20, 20, 20};	//stores digits of display from left to
-					//right
-int displayNums[22];	
-//index values correspond with displayed character when array value is 
-//outputted to PORTA. Display characters in order: 0 - 9, A, C, D, E, I, L, P,
-//R, S, U, all segments, and no segments.
 
 /*
  * Function:  main
- *  Calls functions to initialize ports, timers, and fill display array and to
+ *  Calls functions to initialize ports and timers and to
  *  handle the commands from the key pad. Uses a forever loop to constantly 
  *  update the 4 digit 7 segment display and handle commands from the key pad
  *
@@ -109,25 +112,46 @@ int displayNums[22];
  */
 int main(void)
 {
-	init();		//initialize ports, timers, and fill displayNums array
+	init();		//initialize ports and timers
 	
     while (1) {				//forever loop
-		updateDisplay();	//display characters in digits
-		selection();		//select option
+		panel_select();		//menu command, refreshes the display while it waits
     }
 	return 0;
 }
 
 /*
  * ISR:  TIMER0_OVF_vect
- *  Interrupt for timer0 overflow. Calls checkNumPad function every 50 ms, 
- *  then resets timer0 to overflow 50 ms later. 50 ms delay used to 
+ *  Interrupt for timer0 overflow. Posts the keypad scan to the work queue
+ *  every 100 ms, then resets timer0 to overflow 100 ms later. The main loop
+ *  runs the scan while it refreshes the display.
  *
  *  returns:    none
  */
 ISR(TIMER0_OVF_vect) {
-	checkNumPad();	//check key pad and take input if a button is pressed
+	PROBE_SCOPE(PROBE_ISR_KEYPAD);
+	WORK_ISR_BEGIN();
+	wdBeats |= BEAT_KEYPAD;
+	work_post(WORK_HIGH, keypadWork, 0);	//check key pad from the main loop
 	TCNT0 = 65536 - (int)(0.1 * 16000000.0 / 256.0); //reset timer for 100 ms
+	WORK_ISR_END();
+	return;
+}
+
+/*
+ * ISR:  TIMER4_COMPA_vect
+ *  Interrupt every 10 ms (ZONE_TICK_MS). Runs the zone inputs, exit and 
+ *  entry delays, and beeper, and the watchdog supervisor.
+ *
+ *  returns:    none
+ */
+ISR(TIMER4_COMPA_vect) {
+	PROBE_SCOPE(PROBE_ISR_ZONES);
+	WORK_ISR_BEGIN();
+	zones_tick();
+	saveState();
+	wd_tick();
+	WORK_ISR_END();
 	return;
 }
 
@@ -139,6 +163,7 @@ ISR(TIMER0_OVF_vect) {
  *  returns:    none
  */
 ISR(TIMER1_OVF_vect) {
+	PROBE_SCOPE(PROBE_ISR_BLINK);
 	displayOff ^= 0x1;	//toggle whether the display is on or off
 	TCNT1 = 65536 - (int)((500.0 * 16000.0) / 256.0);   //set timer for 0.5 s
 	return;
@@ -151,6 +176,7 @@ ISR(TIMER1_OVF_vect) {
  *  returns:    none
  */
 ISR(TIMER3_OVF_vect) {
+	PROBE_SCOPE(PROBE_ISR_DELAY);
 	timer3Finish = 1;	//indicates timer 3 has ended
 	TCCR3B &= 0xF8;		//turns timer off
 	return;
@@ -158,15 +184,17 @@ ISR(TIMER3_OVF_vect) {
 
 /*
  * Function:  init
- *  Calls functions to initialize PORTs A, B, and C and timers 0, 1, and 3 and
- *  fill the displayNums array
+ *  Calls functions to initialize PORTs A, B, and C and timers 0, 1, 3, and 4
+ *  and the zones
  *
  *  returns:    none
  */
 void init(){
 	initializePorts();	//initialize PORTs A, B, and C
 	initializeTimers();	//initialize timers 0, 1, and 3
-	fillNumArray();		//fill display value array
+	probe_init();		//timer 5 cycle counter, if probes are built
+	zones_init(0xFF, ENTRY_ZONES, EXIT_DELAY, ENTRY_DELAY);
+	restoreState();		//carry on after a watchdog (or button) reset
 	
 	return;
 }
@@ -205,6 +233,11 @@ void initializeTimers(){
 	TCCR3A = 0x00;
 	TCCR3B &= 0xF8;		//turn timer3 off
 	
+	TCCR4A = 0x00;
+	TCCR4B = (1<<WGM42)|(1<<CS41)|(1<<CS40);	//timer4 CTC, 64 prescaler
+	OCR4A = (16000000 / 64 / 1000) * ZONE_TICK_MS - 1;	//zone tick period
+	TIMSK4 = (1 << OCIE4A);		//enable timer4 compare A interrupt
+	
 	sei();		//Enable global interrupts by setting global interrupt enable
 			//bit in SREG
 	
@@ -217,188 +250,6 @@ void initializeTimers(){
 	return;
 }
 
-/*
- * Function:  fillNumArray
- *  Fills displayNums array with values to be outputted to PORTA. Array values
- *  can be outputted to PORTA to display different characters on the seven 
- *  segment display. Display characters in order: 0 - 9, A, C, D, E, I, L, P,
- *  R, S, U, all segments, and no segments.
- *
- *  returns:    none
- */
-void fillNumArray(){
-	displayNums[0] = 0x7B;	//0
-	displayNums[1] = 0x0A;	//1
-	displayNums[2] = 0x3D;	//2
-	displayNums[3] = 0x1F;	//3
-	displayNums[4] = 0x4E;	//4
-	displayNums[5] = 0x57;	//5
-	displayNums[6] = 0x77;	//6
-	displayNums[7] = 0x1A;	//7
-	displayNums[8] = 0x7F;	//8
-	displayNums[9] = 0x5F;	//9
-	displayNums[10] = 0x7E;	//A
-	displayNums[11] = 0x71;	//C
-	displayNums[12] = 0x2F;	//D
-	displayNums[13] = 0x75;	//E
-	displayNums[14] = 0x60;	//I 
-	displayNums[15] = 0x61;	//L
-	displayNums[16] = 0x7C;	//P
-	displayNums[17] = 0x24;	//R
-	displayNums[18] = 0x57;	//S
-	displayNums[19] = 0x6B;	//U
-	displayNums[20] = 0xFF;	//all LEDs
-	displayNums[21] = 0x00;	//no LEDs
-	
-	return;
-}
-
-/*
- * Function:  decodeChar
- *  Outputs index value for displayNums that corresponds to the input 
- *  character c
- *	
- *  c	input character that corresponds to a character that displays when 
- *	displayNums[index] is outputted to PORTA
- *
- *  returns:    int		index value that corresponds to input char
- *		20		default case for unknown input
- */
-int decodeChar(char c){
-	switch(c){
-		case 'a':
-		case 'A':
-			return 10;
-		case 'c':
-		case 'C':
-			return 11;
-		case 'd':
-		case 'D':
-			return 12;
-		case 'e':
-		case 'E':
-			return 13;
-		case 'i':
-		case 'I':
-			return 14;
-		case 'l':
-		case 'L':
-			return 15;
-		case 'p':
-		case 'P':
-			return 16;
-		case 'r':
-		case 'R':
-			return 17;
-		case 's':
-		case 'S':
-			return 18;
-		case 'u':
-		case 'U':
-			return 19;
-		default:
-			return 20;
-		
-	}
-	return 20;
-}
-
-/*
- * Function:  setEnterCode
- *  Sets digits for seven segment display to display ECDE for enter code
- *
- *  returns:    none
- */
-void setEnterCode(){
-	digits[0] = decodeChar('e');	//E
-	digits[1] = decodeChar('c');	//C
-	digits[2] = decodeChar('d');	//D
-	digits[3] = decodeChar('e');	//E
-	return;
-}
-
-/*
- * Function:  setSuccess
- *  Sets digits for seven segment display to display SUCC for success
- *
- *  returns:    none
- */
-void setSuccess(){
-	digits[0] = decodeChar('s');	//S
-	digits[1] = decodeChar('u');	//U
-	digits[2] = decodeChar('c');	//C
-	digits[3] = decodeChar('c');	//C
-	return;
-}
-
-/*
- * Function:  setAlarm
- *  Sets digits for seven segment display to display ALAR for alarm
- *
- *  returns:    none
- */
-void setAlarm(){
-	digits[0] = decodeChar('a');	//A
-	digits[1] = decodeChar('l');	//L
-	digits[2] = decodeChar('a');	//A
-	digits[3] = decodeChar('r');	//R
-	return;
-}
-
-/*
- * Function:  setError
- *  Sets digits for seven segment display to display ERR for error
- *
- *  returns:    none
- */
-void setError(){
-	digits[0] = decodeChar('e');	//E
-	digits[1] = decodeChar('r');	//R
-	digits[2] = decodeChar('r');	//R
-	digits[3] = 21;			//no segments (blank)
-	return;
-}
-
-/*
- * Function:  setEnterPIN
- *  Sets digits for seven segment display to display ERPI for enter PIN
- *
- *  returns:    none
- */
-void setEnterPIN(){
-	digits[0] = decodeChar('e');	//E
-	digits[1] = decodeChar('r');	//R
-	digits[2] = decodeChar('p');	//P
-	digits[3] = decodeChar('i');	//I
-	return;
-}
-
-/*
- * Function:  setStart
- *  Sets digits for seven segment display to display all segments
- *
- *  returns:    none
- */
-void setStart(){
-	digits[0] = 20;		//all segments
-	digits[1] = 20;		//all segments
-	digits[2] = 20;		//all segments
-	digits[3] = 20;		//all segments
-}
-
-/*
- * Function:  setPIN
- *  Sets digits for seven segment display to the numbers stored as the pin
- *
- *  returns:    none
- */
-void setPIN(){
-	for(int i = 0; i < 4; i++){	//loop through each digit
-		digits[i] = pin[i];	//set digits number equal to pin number
-	}
-	return;
-}
-
 /*
  * Function:  setTimer3
  *  Enables timer3 and sets it to overflow after input t milliseconds. This
@@ -449,74 +300,42 @@ void enableTimer1Blink500(){
 }
 
 /*
- * Function:  err
- *  makes the display blink ERR on and off every second for five seconds
+ * Function:  updateDisplay
+ *  Runs deferred work and the stack and invariant checks, shows the current
+ *  view on the seven segment display and tells the watchdog supervisor the
+ *  main loop is running.
  *
  *  returns:    none
  */
-void err(){
-	setError();		//set digits to display ERR
-	displayOff = 0x0;	//turn display on
-	
-	for(int i = 0; i < 5; i++){		//loop through 5 times
-		setTimer3(500);			//set timer3Finish to become 1 after 0.5 s
-		while(timer3Finish == 0){	//display ERR for 0.5 s
-			updateDisplay();
-		}
-		
-		PORTC |= 0x0F;		//turn off all digits in display
-		_delay_ms(500);		//delay 0.5 s with display off
-	}
+void updateDisplay(){
+	PROBE_SCOPE(PROBE_DISPLAY);
+	wd_beat(BEAT_DISPLAY);	//every wait loop refreshes the display
+	work_run();		//keypad scan posted by the timer0 interrupt
+	stack_check();	//track the stack high water mark
+	core_check();	//alarm state invariants
+	seg_refresh();
 	return;
 }
 
 /*
- * Function:  updateDisplay
- *  toggle though each seven segment display digit and display the 
- *  corresponding digit stored in the digits array. Displays values from 
- *  digits array on seven segment display.
+ * Function:  keypadWork
+ *  Work queue item posted by the timer0 interrupt. Checks the key pad.
+ *
+ *  arg		unused
  *
  *  returns:    none
  */
-void updateDisplay(){
-	PORTA = 0x00;		//clear PORTA
-	
-	if(displayOff == 0x1){	//if display should be off, exit
-		PORTB |= 0x0F;	//set all digits high (turn off all digits)
-		return;
-	}
-	
-	//loop to turn off all digits, update the displayed number, and turn on
-	//the next digit
-	for(int i = 0; i < 4; i++){
-		PORTB |= 0x0F;			//set all digits high (turn off all digits)
-		
-		PORTA = displayNums[digits[i]];	//display stored digit for the current
-						//location
-		
-		//turn on current digit on display based on i value
-		switch(i){
-			case 0:
-			PORTB &= 0xFE;	//turn on first digit
-			break;
-			case 1:
-			PORTB &= 0xFD;	//turn on second digit
-			break;
-			case 2:
-			PORTB &= 0xFB;	//turn on third digit
-			break;
-			case 3:
-			PORTB &= 0xF7;	//turn on fourth digit
-			break;
-		}
-	}
+void keypadWork(uint8_t arg){
+	checkNumPad();	//check key pad and take input if a button is pressed
 	return;
 }
 
 /*
  * Function:  checkNumPad
  *  checks if any key has been pressed and calls readNumPad function if key is
- *  pressed. Exits if key has not been released to help with debouncing.
+ *  pressed. Exits if key has not been released to help with debouncing. A
+ *  contact that bounces open is only taken as released once the keypad has
+ *  read clear for KEY_CLEAR_SCANS scans.
  *
  *  returns:    none
  */
@@ -527,18 +346,23 @@ void checkNumPad(){
 	temp = PINC & 0xF0;	//temp value for input pins of PORTC
 	
 	if(keypadClear == 0){	//check if any keypad button is still pressed
-		if(temp == 0x00){	//exit if any button has not been released
+		if(temp != 0xF0){	//exit if any button has not been released
+			keyClearScans = 0;
 			return;
 		}
+		if(++keyClearScans < KEY_CLEAR_SCANS){	//exit while the contact may
+			return;								//still bounce
+		}
 	}
 			
 	keypadClear = 1;			//set keypadClear of keypad buttons are not 
 						//pressed
 	
 	if(temp != 0xF0){			//if new key is pressed, read the key
-		keypadClear = 0;		//keypadClear is set to 0 because key is 
-						//pressed
 		input = readNumPad();		//read pressed button and store in input var
+		keypadClear = (input == -1);	//keypadClear is set to 0 because key is
+						//pressed, unless it bounced open during the read
+		keyClearScans = 0;
 	}
 	return;
 }
@@ -550,7 +374,8 @@ void checkNumPad(){
  *  returns:    int		value of key pressed in keypad
  */
 int readNumPad(){
-	int keyPressed[4][4] = {	//2D array of keypad button values
+	PROBE_SCOPE(PROBE_KEYPAD_READ);
+	static const uint8_t keyPressed[4][4] = {	//keypad button values
 		{0x1, 0x2, 0x3, 0xA},
 		{0x4, 0x5, 0x6, 0xB},
 		{0x7, 0x8, 0x9, 0xC},
@@ -558,9 +383,9 @@ int readNumPad(){
 	};
 	
 	//row mask to ground different rows of keypad
-	int keyRowMask[4] = {0x07, 0x0B, 0x0D, 0x0E};
+	static const uint8_t keyRowMask[4] = {0x07, 0x0B, 0x0D, 0x0E};
 	//column mask to check the column of the pressed button	
-	int keyColMask[4] = {0x80, 0x40, 0x20, 0x10};
+	static const uint8_t keyColMask[4] = {0x80, 0x40, 0x20, 0x10};
 	
 	
 	for(int i = 0; i < 4; i++){	//loop to check each row
@@ -582,293 +407,201 @@ int readNumPad(){
 }
 
 /*
- * Function:  start
- *  blinks all segments in display to indicate no pin has been set. Calls
- *  enterCode function to set pin if "A" or "C" buttons are pressed.
+ * Function:  panelKey
+ *  Panel.h application function. Waits for a new key press while it keeps
+ *  the display and the countdown running. A key still held from before
+ *  has to be released first. Entry and setup screens blink while waiting.
  *
- *  returns:    none
+ *  returns:    int		value of key pressed, 0 - 9, 0xA - 0xD, 0xE #, 0xF *
  */
-void start(){
-	setStart();		//set display to show turn segments on
-	enableTimer1Blink500();	//turn on timer to make display blink every second
-
-	while(!((input == 0xA) || (input == 0xC))){	//loop to show display
-							//when "C" or "A" is pressed
-		updateDisplay();			//display digits on display
-	}
+int panelKey(){
+	int key;
+	int view = displayModel.view;
 	
+	if((view == VIEW_SETUP) || (view == VIEW_ENTER_CODE) ||
+	   (view == VIEW_ENTER_PIN)){
+		enableTimer1Blink500();	//blink display until a key is pressed
+	}
+	while(keypadClear == 0){	//key is still down, not a new press
+		updateDisplay();
+		panel_countdown();
+	}
+	input = -1;			//clear input
+	while(input == -1){	//wait for the keypad scan to read a key
+		updateDisplay();
+		panel_countdown();
+	}
+	key = input;
+	input = -1;
 	disableTimer1();	//turn off blinking timer
 	
-	enterCode(1);		//set pin number based on input from keypad
-	
-	return;
+	if(key == 0x10){	//0 key
+		return 0;
+	}
+	return key;
 }
 
 /*
- * Function:  enterCode
- *  sets pin or unlock pin based on input from keypad and value of input param
- *  changePIN
+ * Function:  panelError
+ *  Panel.h application function. Makes the display blink ERR on and off 
+ *  every second for five seconds.
  *
- *  changePIN	1 changes pin array
- *		0 changes unlockPIN array
+ *  msg		int	DISP_ERR_ message, all are shown as ERR
  *
- *  returns:    1 exit if called by disAlarm command
- *		0 exited normally
+ *  returns:    none
  */
-int enterCode(int changePIN){
-	int finish = 0;	//var for when pin or unlockPIN is set without error
-	int index;	//index value for fillPIN function
-	int next = 1;	//var for when PIN is ready for next input
-	int errr = 0;	//error flag
-	int strt = 1;	//var for first run through loop
+void panelError(int msg){
+	display_show(VIEW_ERROR, msg, 0);	//display ERR
+	displayOff = 0x0;	//turn display on
 	
-	while(finish != 1){	//loop that exits when pin or unlockPIN is set without
-				//error
-		errr = 0;	//set error to 0
-		input = -1;	//set input to be blank
-		
-		if(changePIN == 1)	//check if pin or unlockPIN is being set
-			setEnterCode();	//display enter code if pin is being set
-		else
-			setEnterPIN();	//display enter PIN of unlockPIN is being set
-			
-		if(strt == 1){	//check if this is the first run through the loop
-			index = -1;	//set index value to -1 if this is the first run 
-					//through loop
-			strt = 0;	//set strt to 0 to indicate first run through loop
-					//has happened
-		}
-		else{
-			index = 0;	//set index to 0 if not first run through loop
-		}
-		
-		enableTimer1Blink500();	//enable blinking display
-		
-		while(input != 0xE){	//loop for storing input from keypad in pin or
-					//unlockPIN. Exit when "#" is pressed
-			updateDisplay();//display digits on display
-			
-			if((keypadClear == 1)){	//if keypad buttons are not pressed, set
-						//next to 1 (indicating next pin/unlockPIN
-						//digit is ready to set)
-				next = 1;
-			}
-			
-			//if button is pressed on keypad and next digit in pin/unlockPIN
-			//is ready to be set
-			if((keypadClear == 0) && (next == 1)){
-				//set next to 0 to prevent multiple pin/unlockPIN digits set 
-				//to same input value
-				next = 0;	
-				//fill pin or unlockPIN digit based on index value and changePIN value
-				errr = fillPIN(index, changePIN);	
-				//increment index value
-				index++;
-			}
+	for(int i = 0; i < 5; i++){		//loop through 5 times
+		setTimer3(500);			//set timer3Finish to become 1 after 0.5 s
+		while(timer3Finish == 0){	//display ERR for 0.5 s
+			updateDisplay();
 		}
-		disableTimer1();//disable display blinking
 		
-		if(index != 5)	//error if wrong number of buttons were pressed
-			errr = 1;
-			
-		if(errr != 0){	//blink error 5 times if error has occurred, then 
-				//repeat loop
-			err();
-			if(changePIN == 0){
-				return 1;
-			}
-		}
-		else{
-			finish = 1;	//exit loop if no errors have occurred
-		}
+		PORTC |= 0x0F;		//turn off all digits in display
+		_delay_ms(500);		//delay 0.5 s with display off
 	}
-	succPIN();			//display successful pin set
-	return 0;
+	return;
 }
 
 /*
- * Function:  fillPIN
- *  sets pin or unlock pin digit based on input from keypad and value of input
- *  params changePIN and index
- *
- *  changePIN	1 changes pin array
- *		0 changes unlockPIN array
- *  index	sets which digit will be changed in pin/unlockPIN to the value
- *		input from the keypad
- *
- *  returns:    0	no errors
- *		1	index value too high
- *		2	input is not a number
+ * Function:  panelPause
+ *  Panel.h application function. Keeps the current view on the display.
+ *
+ *  ms		uint16_t	time to wait, up to 1048 ms
+ *
+ *  returns:    none
  */
-int fillPIN(int index, int changePIN){
-	if(input == -1)		//if input value is blank (represented as -1) then exit
-		return 0;
-		
-	if(index > 4)		//if index value exceeds 4 then exit with error
-		return 1;
-		
-	if(index > 3)		//if index value exceeds 3 then exit
-		return 0;
-	
-	
-	if((input > 0x9) && (input != 0x10))	//if button pressed is not a 
-		return 2;			//number then exit
-	
-	if(changePIN == 1){			//check if pin or unlockPIN should be changed
-		setEnterCode();			//set display to show enter code if pin should
-								//be changed
-		
-		if(input == 0x10)		//set pin digit to 0 if 0 is pressed
-			pin[index] = 0;
-		else
-			pin[index] = input;	//set pin to input value otherwise
-	}
-	else{					//code for if unlockPIN should be changed
-		setEnterPIN();			//set display to show enter PIN
-		if(input == 0x10)		//set unlockPIN digit to 0 if 0 is pressed
-			unlockPIN[index] = 0;
-		else
-			unlockPIN[index] = input;	//set unlockPIN to input value otherwise
+void panelPause(uint16_t ms){
+	setTimer3(ms);
+	while(timer3Finish == 0){
+		updateDisplay();
 	}
-	
-	return 0;	//no errors occurred
+	return;
 }
 
 /*
- * Function:  succPIN
- *  displays pin for two seconds, then blinks pin once, then displays success 
- *  for successful pin
+ * Function:  panelShowPIN
+ *  Panel.h application function. Shows the new pin for confirming. A pin
+ *  longer than 4 digits is scrolled across the display first, one digit 
+ *  every MARQUEE_STEP ms, and ends on the last 4 digits.
  *
  *  returns:    none
  */
-void succPIN(){
-	setPIN();		//display pin
+void panelShowPIN(){
 	displayOff = 0x0;	//turn display on
 	
-	for(int i = 0; i < 2; i++){	//loop to leave display on for 2 seconds
-		setTimer3(1000);	//set timer3 for 1 sec and loop twice
-					//display pin for 2 sec
-		while(timer3Finish == 0){	//display pin until timer3 has overflowed
-			updateDisplay();
-		}
-	}
-	PORTA = 0x00;		//turn off display
-	
-	_delay_ms(500);		//wait 0.5 sec with display off
-	
-	setTimer3(500);		//set timer3 for 0.5 sec
-				//blink pin for 0.5 sec
-	while(timer3Finish == 0){	//display pin until timer3 has overflowed
-		updateDisplay();
-	}
-	
-	PORTA = 0x00;		//turn off display
-	_delay_ms(500);		//wait 0.5 sec with display off
-	
-	setSuccess();		//set display to shou successful pin has been set
-	
-	while(keypadClear == 1){//display success until a button is pressed
-		updateDisplay();
+	for(int first = 0; first < PIN_LENGTH - 4; first++){
+		display_show(VIEW_PIN, first, 0);
+		panelPause(MARQUEE_STEP);
 	}
-	
-	PINset = 1;		//var to indicate PIN has been set
+	display_show(VIEW_PIN, PIN_LENGTH - 4, 0);	//display pin
 	return;
 }
 
 /*
- * Function:  enAlarm
- *  enables the alarm
+ * Function:  panelLocked
+ *  Panel.h application function. There is no lockout in this build.
+ *
+ *  returns:    0	PINs can be entered
+ */
+int panelLocked(){
+	return 0;
+}
+
+/*
+ * Function:  panelArmSystem
+ *  Panel.h application function. Arms the alarm.
+ *
+ *  returns:    int		as core_arm
+ */
+int panelArmSystem(){
+	return core_arm();
+}
+
+/*
+ * Function:  panelDisarmSystem
+ *  Panel.h application function. Disarms the alarm if code is the pin.
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *
+ *  returns:    int		as core_disarm
+ */
+int panelDisarmSystem(const int code[PIN_LENGTH]){
+	return core_disarm(code);
+}
+
+/*
+ * Function:  panelCheckPIN
+ *  Panel.h application function. Checks the current pin before it is 
+ *  changed.
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *
+ *  returns:    0	code is the stored pin
+ *		1	code is wrong
+ */
+int panelCheckPIN(const int code[PIN_LENGTH]){
+	return pinMatches(pin, code) ? 0 : 1;
+}
+
+/*
+ * Function:  panelPINChanged
+ *  Panel.h application function. The pin is kept through a watchdog reset
+ *  by saveState, so there is nothing to store here.
  *
  *  returns:    none
  */
-void enAlarm(){
-	if(PINset == 1){	//if PIN has been set, arm alarm system
-		alarmEnable = 1;//set alarm enable flag
-		setAlarm();	//set display to show alarm
-	}
-	else{			//if PIN has not been set, enter one
-		enterCode(1);	//enter PIN and enable system
-	}
+void panelPINChanged(){
 	return;
 }
 
 /*
- * Function:  disAlarm
- *  disables alarm if entered unlockPIN is the same as stored pin. Displays 
- *  error and returns to previous displayed message if alarm is not enabled or
- *  if entered unlockPIN does not match the stored pin.
+ * Function:  saveState
+ *  Keeps the PIN and alarm state in the watchdog reset record when they
+ *  change. Called from the timer 4 interrupt.
  *
  *  returns:    none
  */
-void disAlarm(){
-	int incorrectPIN = 0;	//var for if incorrect pin is entered
-	int ex = 0;
-	
-	if(alarmEnable == 0){	//if alarm is not enabled, error and return to 
-				//previous display
-		err();		//blink error for 5 seconds
-		setSuccess();	//display success (previous display)
-		return;
-	}
-	
-	ex = enterCode(0);	//enter code function to get unlockPIN from keypad input
-	
-	if(ex == 1){		//if exit is returned from enterCode, clear input and
-				//return to previous display state
-		setAlarm();	//display alarm (previous display state)
-		return;
+void saveState(){
+	uint8_t state[3 + PIN_LENGTH];
+	
+	state[0] = alarmEnable;
+	state[1] = PINset;
+	state[2] = zoneState;
+	for(int i = 0; i < PIN_LENGTH; i++){
+		state[3 + i] = pin[i];
 	}
-	
-	for(int i = 0; i < 4; i++){		//loop to check if pin matches unlockPIN
-		if(pin[i] != unlockPIN[i])	//check each pin digit
-			incorrectPIN = 1;	//indirectPIN = 1 if incorrect pin is 
-						//entered
-	}
-	
-	if(incorrectPIN == 1){	//if incorrect pin is entered, display error and
-				//display alarm (previous display state)
-		err();		//blink error for 5 seconds
-		setAlarm();	//display alarm (previous display)
-		return;
+	if(memcmp(state, wdRecord.state, sizeof(state)) != 0){
+		wd_save_state(state, sizeof(state));
 	}
-	
-	alarmEnable = 0;	//disable alarm
-	PINset = 0;		//pin is no longer set
 	return;
 }
 
 /*
- * Function:  selection
- *  calls start, enAlarm, and disAlarm functions based on current state of 
- *  system and input from keypad
+ * Function:  restoreState
+ *  Starts the watchdog and, if the reset record is valid, puts back the 
+ *  PIN and alarm state from before the reset so the setup flow is skipped.
  *
  *  returns:    none
  */
-void selection(){
-	if(PINset == 0){	//if pin is not set, call start function to indicate 
-				//no pin is set
-		start();
-		input = -1;	//clear input
+void restoreState(){
+	if(!wd_init(BEAT_KEYPAD | BEAT_DISPLAY) || (wdRecord.state[1] != 1)){
 		return;
 	}
-	
-	if(input == 0xC){	//if "C" is pressed, call enterCode to set the PIN
-		enterCode(1);
-		input = -1;	//clear input
-		return;
+	alarmEnable = wdRecord.state[0];
+	PINset = 1;
+	for(int i = 0; i < PIN_LENGTH; i++){
+		pin[i] = wdRecord.state[3 + i];
 	}
-	
-	if(input == 0xA){	//if "A" is pressed, call enAlarm to set the alarm
-		enAlarm();
-		input = -1;	//clear input
-		return;
+	if(alarmEnable){
+		zones_restore(wdRecord.state[2]);
+		display_show(VIEW_IDLE, 1, 0);
 	}
-	
-	if(input == 0xD){	//if "D" is pressed, call disAlarm to disable the alarm
-		disAlarm();
-		input = -1;	//clear input
-		return;
+	else{
+		display_show(VIEW_IDLE, 0, 0);	//display shown after a PIN is set
 	}
-	
-	return;	//return if no conditions are met
+	return;
 }
@@ -0,0 +1,325 @@
+/*
+ * Config.h
+ *
+ * Header file for the panel configuration (PIN, zones, delays) stored in 
+ * EEPROM. There are two slots. A new image is always written to the slot 
+ * that is not active, read back and checked against its CRC, and only then
+ * made active by rewriting the single active slot byte. If anything fails 
+ * the previous image stays active. At boot an image with a bad CRC is 
+ * skipped and the other slot is used.
+ *
+ * Images are streamed in by config_begin, config_put and config_end. Bytes
+ * are collected into two chunk buffers, and the EEPROM ready interrupt 
+ * writes one chunk while the next one is filled, so the caller only waits 
+ * if both chunks are still being written (3.3 ms per byte).
+ *
+ * Slot layout:	[length][image (length bytes)][CRC low][CRC high]
+ * The CRC is CRC-16/MODBUS over the image bytes only.
+ *
+ * Other EEPROM writes must call config_wait first, because the interrupt 
+ * owns the EEPROM address and data registers while a chunk is written.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with CRC16.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include "CRC16.h"
+#include "../Common/Probe.h"
+
+#define CONFIG_ACTIVE_ADDR 0x000	//active slot byte (0 or 1)
+#define CONFIG_SLOT_BASE 0x010		//first slot
+#define CONFIG_SLOT_SIZE 32			//bytes per slot
+#define CONFIG_MAX (CONFIG_SLOT_SIZE - 3)	//max image length
+#define CONFIG_CHUNK 8				//bytes per chunk buffer
+#define CONFIG_PIN_DIGITS 12		//room for the longest PIN
+#define CONFIG_SLOT_ADDR(s) (CONFIG_SLOT_BASE + (s) * CONFIG_SLOT_SIZE)
+
+//configuration image, new fields are added at the end
+typedef struct{
+	uint8_t pin[CONFIG_PIN_DIGITS];	//arming PIN digits, 0xFF after the last 
+							//digit and when no PIN is set
+	uint8_t zoneMask;		//zones that trip the alarm
+	uint8_t exitDelay;		//seconds to leave after arming
+	uint8_t entryDelay;		//seconds to disarm after an entry zone trips
+	uint8_t lockoutLimit;	//wrong PINs (all sources) before full lockout
+	uint8_t entryZones;		//zones with an entry delay
+}Config;
+
+int config_load(Config* cfg);
+int config_active();
+int config_check(int slot, uint16_t* crc);
+int config_begin(int len);
+void config_put(uint8_t b);
+void config_queue(uint8_t b);
+void config_flush();
+void config_wait();
+int config_end(uint16_t crc);
+int config_save(const Config* cfg);
+
+uint8_t cfgChunk[2][CONFIG_CHUNK];		//chunk buffers
+uint16_t cfgChunkAddr[2];				//EEPROM address of each chunk
+volatile uint8_t cfgChunkLen[2] = {0, 0};	//bytes to write, 0 when free
+volatile uint8_t cfgDrain = 0;			//chunk being written
+volatile uint8_t cfgDrainPos = 0;		//next byte in cfgDrain
+uint8_t cfgFill = 0;					//chunk being filled
+uint8_t cfgFillLen = 0;					//bytes in cfgFill
+uint16_t cfgAddr;						//EEPROM address of next byte
+int cfgSlot = -1;						//slot being written, -1 when idle
+int cfgLen;								//image length being written
+int cfgCount;							//image bytes received
+
+/*
+ * ISR(EE_READY_vect)
+ *  Writes the next byte of the chunk being drained. Turns itself off when 
+ *	both chunks are empty.
+ *
+ *  returns:    none
+ */
+ISR(EE_READY_vect){
+	PROBE_SCOPE(PROBE_ISR_EEPROM);
+	uint8_t n = cfgDrain;
+	
+	if(cfgChunkLen[n] == 0){		//nothing left to write
+		EECR &= ~(1<<EERIE);
+		return;
+	}
+	EEAR = cfgChunkAddr[n] + cfgDrainPos;
+	EEDR = cfgChunk[n][cfgDrainPos];
+	EECR |= (1<<EEMPE);				//EEPE must follow within 4 cycles
+	EECR |= (1<<EEPE);
+	
+	if(++cfgDrainPos >= cfgChunkLen[n]){	//chunk done, free it
+		cfgChunkLen[n] = 0;
+		cfgDrainPos = 0;
+		cfgDrain = n ^ 1;
+	}
+}
+
+/*
+ * Function:  config_active
+ *  Reads the active slot byte.
+ *
+ *  returns:    int		active slot (0 or 1)
+ */
+int config_active(){
+	return eeprom_read_byte((uint8_t*)CONFIG_ACTIVE_ADDR) == 1;
+}
+
+/*
+ * Function:  config_check
+ *  Checks the length and CRC of the image in a slot.
+ *
+ *	slot	int			slot to check
+ *	crc		uint16_t*	CRC of the image
+ *
+ *  returns:    int		image length, 0 if the slot is empty or corrupt
+ */
+int config_check(int slot, uint16_t* crc){
+	uint8_t* addr = (uint8_t*)CONFIG_SLOT_ADDR(slot);
+	int len = eeprom_read_byte(addr++);
+	uint16_t c = CRC16_INIT;
+	
+	if((len == 0) || (len > CONFIG_MAX)){	//erased (0xFF) or bad length
+		return 0;
+	}
+	for(int i = 0; i < len; i++){
+		c = crc16_update(c, eeprom_read_byte(addr++));
+	}
+	if(eeprom_read_word((uint16_t*)addr) != c){
+		return 0;
+	}
+	*crc = c;
+	return len;
+}
+
+/*
+ * Function:  config_load
+ *  Reads the active image, or the other one if the active image is corrupt.
+ *	An image shorter than Config only replaces its first fields, so cfg 
+ *	should hold the defaults.
+ *
+ *	cfg		Config*		configuration read from EEPROM
+ *
+ *  returns:    0	configuration was read
+ *		1	no valid image, cfg is unchanged
+ */
+int config_load(Config* cfg){
+	int slot = config_active();
+	uint16_t crc;
+	int len;
+	
+	len = config_check(slot, &crc);
+	if(len == 0){					//fall back to the previous image
+		slot ^= 1;
+		len = config_check(slot, &crc);
+	}
+	if(len == 0){
+		return 1;
+	}
+	if(len > sizeof(Config)){
+		len = sizeof(Config);
+	}
+	eeprom_read_block(cfg, (uint8_t*)CONFIG_SLOT_ADDR(slot) + 1, len);
+	return 0;
+}
+
+/*
+ * Function:  config_begin
+ *  Starts writing a new image into the slot that is not active.
+ *
+ *	len		int		image length
+ *
+ *  returns:    0	ready for config_put
+ *		1	length out of range
+ */
+int config_begin(int len){
+	if((len <= 0) || (len > CONFIG_MAX)){
+		return 1;
+	}
+	config_wait();					//finish any earlier upload
+	cfgSlot = config_active() ^ 1;
+	cfgLen = len;
+	cfgCount = 0;
+	cfgAddr = CONFIG_SLOT_ADDR(cfgSlot) + 1;	//length is written last
+	cfgFill = 0;
+	cfgFillLen = 0;
+	cfgDrain = 0;
+	cfgDrainPos = 0;
+	return 0;
+}
+
+/*
+ * Function:  config_put
+ *  Adds the next image byte. Bytes past the length given to config_begin 
+ *	are dropped.
+ *
+ *	b		uint8_t		image byte
+ *
+ *  returns:    none
+ */
+void config_put(uint8_t b){
+	if((cfgSlot < 0) || (cfgCount >= cfgLen)){
+		return;
+	}
+	config_queue(b);
+	cfgCount++;
+	return;
+}
+
+/*
+ * Function:  config_queue
+ *  Adds a byte for the next EEPROM address to the chunk being filled. Waits
+ *	only if both chunks are still being written.
+ *
+ *	b		uint8_t		byte to write at cfgAddr
+ *
+ *  returns:    none
+ */
+void config_queue(uint8_t b){
+	if(cfgFillLen == 0){			//starting a chunk, wait for it to be free
+		while(cfgChunkLen[cfgFill] != 0){}
+		cfgChunkAddr[cfgFill] = cfgAddr;
+	}
+	cfgChunk[cfgFill][cfgFillLen++] = b;
+	cfgAddr++;
+	if(cfgFillLen >= CONFIG_CHUNK){
+		config_flush();
+	}
+	return;
+}
+
+/*
+ * Function:  config_flush
+ *  Hands the chunk being filled to the EEPROM ready interrupt.
+ *
+ *  returns:    none
+ */
+void config_flush(){
+	if(cfgFillLen == 0){
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		cfgChunkLen[cfgFill] = cfgFillLen;
+		EECR |= (1<<EERIE);
+	}
+	cfgFill ^= 1;
+	cfgFillLen = 0;
+	return;
+}
+
+/*
+ * Function:  config_wait
+ *  Waits until both chunks have been written to EEPROM.
+ *
+ *  returns:    none
+ */
+void config_wait(){
+	config_flush();
+	while((cfgChunkLen[0] != 0) || (cfgChunkLen[1] != 0)){}
+	eeprom_busy_wait();
+	return;
+}
+
+/*
+ * Function:  config_end
+ *  Writes the length and CRC, reads the image back and makes it active if
+ *	it matches the expected CRC. The active image is unchanged on failure.
+ *
+ *	crc		uint16_t	expected CRC-16/MODBUS of the image
+ *
+ *  returns:    0	new image is active
+ *		1	no upload started or image is short
+ *		2	CRC does not match
+ */
+int config_end(uint16_t crc){
+	uint16_t check;
+	int slot = cfgSlot;
+	
+	if((slot < 0) || (cfgCount != cfgLen)){
+		cfgSlot = -1;
+		return 1;
+	}
+	config_queue(crc & 0xFF);		//CRC follows the image
+	config_queue(crc >> 8);
+	config_flush();
+	cfgAddr = CONFIG_SLOT_ADDR(slot);	//length goes in front of the image
+	config_queue(cfgLen);
+	config_flush();
+	cfgSlot = -1;
+	config_wait();
+	
+	if((config_check(slot, &check) == 0) || (check != crc)){
+		return 2;					//read back failed, keep the old image
+	}
+	eeprom_update_byte((uint8_t*)CONFIG_ACTIVE_ADDR, slot);	//activate
+	eeprom_busy_wait();
+	return 0;
+}
+
+/*
+ * Function:  config_save
+ *  Writes a configuration through the same two slot path as an upload.
+ *
+ *	cfg		Config*		configuration to store
+ *
+ *  returns:    0	configuration is stored and active
+ *		1	write or read back failed
+ */
+int config_save(const Config* cfg){
+	const uint8_t* b = (const uint8_t*)cfg;
+	
+	config_begin(sizeof(Config));
+	for(int i = 0; i < sizeof(Config); i++){
+		config_put(b[i]);
+	}
+	return (config_end(crc16(b, sizeof(Config))) == 0) ? 0 : 1;
+}
+
+#endif
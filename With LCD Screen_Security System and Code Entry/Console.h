@@ -0,0 +1,176 @@
+/*
+ * Console.h
+ *
+ * Header file for a line based command console on USART0. Received bytes
+ * are parsed as they arrive by console_poll, which never waits, so it can be
+ * called while the rest of the system is waiting for keypad input. Commands
+ * are looked up by binary search in a table stored in flash that is sorted 
+ * by command name.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with USART0.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "USART0.h"
+
+#define CONSOLE_LINE 32		//max characters in a command line
+#define CONSOLE_NAME 8		//max characters in a command name + 1
+
+//entry in the command table
+typedef struct{
+	char name[CONSOLE_NAME];		//command name
+	void (*handler)(char* args);	//called with the rest of the line
+}ConsoleCmd;
+
+void console_init(const ConsoleCmd* table, int count);
+void console_poll();
+void console_dispatch();
+const ConsoleCmd* console_find(const char* name);
+void console_prompt();
+
+const ConsoleCmd* consoleTable;	//command table in flash, sorted by name
+int consoleCount = 0;			//number of commands in consoleTable
+char consoleLine[CONSOLE_LINE + 1];	//command line being received
+int consoleLen = 0;				//characters in consoleLine
+int consoleOverflow = 0;		//1 if the current line was too long
+
+/*
+ * Function:  console_init
+ *  Sets the command table and prints a prompt.
+ *
+ *	table	ConsoleCmd*	command table in flash, sorted by name (strcmp)
+ *	count	int			number of commands in table
+ *
+ *  returns:    none
+ */
+void console_init(const ConsoleCmd* table, int count){
+	consoleTable = table;
+	consoleCount = count;
+	consoleLen = 0;
+	consoleOverflow = 0;
+	console_prompt();
+	return;
+}
+
+/*
+ * Function:  console_poll
+ *  Adds received characters to the command line and runs the command when
+ *	a line ending is received. Returns when no more characters are waiting.
+ *
+ *  returns:    none
+ */
+void console_poll(){
+	int c;
+	
+	while((c = USART0_rx_read()) != -1){
+		if((c == '\r') || (c == '\n')){		//end of line
+			if(consoleOverflow){
+				fputs_P(PSTR("\nline too long\n"), &USART0_OUT);
+				console_prompt();
+			}
+			else if(consoleLen > 0){
+				consoleLine[consoleLen] = '\0';
+				fputc('\n', &USART0_OUT);
+				console_dispatch();
+				console_prompt();
+			}
+			consoleLen = 0;
+			consoleOverflow = 0;
+		}
+		else if((c == '\b') || (c == 0x7F)){	//backspace
+			if(consoleLen > 0){
+				consoleLen--;
+				fputs_P(PSTR("\b \b"), &USART0_OUT);
+			}
+		}
+		else if(consoleLen < CONSOLE_LINE){
+			consoleLine[consoleLen++] = c;
+			fputc(c, &USART0_OUT);			//echo
+		}
+		else{
+			consoleOverflow = 1;
+		}
+	}
+	return;
+}
+
+/*
+ * Function:  console_dispatch
+ *  Splits the command line into a command name and arguments and calls the
+ *	command handler.
+ *
+ *  returns:    none
+ */
+void console_dispatch(){
+	char* args = consoleLine;
+	const ConsoleCmd* cmd;
+	void (*handler)(char* args);
+	
+	while((*args != '\0') && (*args != ' ')){	//find end of name
+		args++;
+	}
+	if(*args == ' '){					//split name from arguments
+		*args++ = '\0';
+		while(*args == ' '){
+			args++;
+		}
+	}
+	
+	cmd = console_find(consoleLine);
+	if(cmd == 0){
+		fprintf_P(&USART0_OUT, PSTR("unknown command: %s\n"), consoleLine);
+		return;
+	}
+	handler = (void (*)(char*))pgm_read_ptr(&cmd->handler);
+	handler(args);
+	return;
+}
+
+/*
+ * Function:  console_find
+ *  Binary searches the command table for a command name.
+ *
+ *	name	char*	command name
+ *
+ *  returns:    ConsoleCmd*	matching table entry (in flash)
+ *				NULL		no matching command
+ */
+const ConsoleCmd* console_find(const char* name){
+	int lo = 0;
+	int hi = consoleCount - 1;
+	int mid;
+	int cmp;
+	
+	while(lo <= hi){
+		mid = (lo + hi) / 2;
+		cmp = strcmp_P(name, consoleTable[mid].name);
+		if(cmp == 0){
+			return &consoleTable[mid];
+		}
+		if(cmp < 0){
+			hi = mid - 1;
+		}
+		else{
+			lo = mid + 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Function:  console_prompt
+ *  Prints the command prompt.
+ *
+ *  returns:    none
+ */
+void console_prompt(){
+	fputs_P(PSTR("> "), &USART0_OUT);
+	return;
+}
+
+#endif
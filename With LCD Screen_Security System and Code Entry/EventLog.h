@@ -0,0 +1,249 @@
+/*
+ * EventLog.h
+ *
+ * Header file for an audit log of alarm events kept in EEPROM. Records are
+ * written round a ring, so every record address is written once per lap
+ * and wear is spread over the whole log region.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with Config.h (Rev 1) and Telemetry.h (Rev 1) by Jace 
+ * Johnson
+ *
+ * Record format (4 bytes)
+ *	byte 0		bit 7 lap bit, bits 0 - 6 event type (TEL_ event types)
+ *	byte 1		argument (source for arm/disarm/wrong PIN, zone for trips)
+ *	bytes 2-3	seconds since the previous record (0xFFFF if longer), 
+ *				TEL_BOOT records start a new time base
+ *
+ * The lap bit flips each time the ring wraps, so records written in this 
+ * lap differ from older (or erased) records. The head is checkpointed every
+ * EVLOG_CHECKPOINT records into one of EVLOG_HEADERS header slots, used in
+ * turn. At boot the newest checkpoint is read and at most EVLOG_CHECKPOINT
+ * records are checked to find the head. It is then kept in SRAM, so 
+ * writing a record never searches the log.
+ */
+
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include <avr/eeprom.h>
+#include "Config.h"
+#include "Telemetry.h"
+#include "SysTick.h"
+
+#define EVLOG_HEADER_BASE 0x080		//checkpoint slots
+#define EVLOG_HEADERS 16			//checkpoint slots (4 bytes each)
+#define EVLOG_BASE 0x100			//first record
+#define EVLOG_RECORDS 960			//records in the ring (to end of EEPROM)
+#define EVLOG_CHECKPOINT 32			//records between checkpoints
+#define EVLOG_LAP 0x80				//lap bit in byte 0
+#define EVLOG_EMPTY 0x7F			//type of an erased record
+
+//sources for arm, disarm and wrong PIN events
+#define EVLOG_KEYPAD 0
+#define EVLOG_CONSOLE 1
+#define EVLOG_MODBUS 2
+
+//log record
+typedef struct{
+	uint8_t type;		//lap bit and event type
+	uint8_t arg;		//event argument
+	uint16_t delta;		//seconds since previous record
+}EventRecord;
+
+void evlog_init();
+int evlog_find_checkpoint(uint16_t* head, uint8_t* lap);
+void evlog_write(uint8_t type, uint8_t arg);
+void evlog_checkpoint();
+void evlog_read(uint16_t index, EventRecord* rec);
+void evlog_dump();
+
+uint16_t evlogHead;			//index of the next record to write
+uint8_t evlogLap;			//lap bit of records written this lap
+uint8_t evlogSeq;			//sequence number of the last checkpoint
+uint16_t evlogSinceCheckpoint;	//records written since the checkpoint
+unsigned long evlogLastTime;	//ms timestamp of the last record
+
+/*
+ * Function:  evlog_init
+ *  Finds the head of the log from the newest checkpoint and records a boot
+ *	event. Records found after the checkpoint count towards the next one, so
+ *	the head is never more than EVLOG_CHECKPOINT records past a checkpoint.
+ *
+ *  returns:    none
+ */
+void evlog_init(){
+	EventRecord rec;
+	int i;
+	
+	if(evlog_find_checkpoint(&evlogHead, &evlogLap) != 0){
+		evlogHead = 0;			//no checkpoint, new log
+		evlogLap = 0;			//erased records have the lap bit set
+		evlogSeq = 0xFF;		//first checkpoint goes in slot 0
+	}
+	
+	//records after the checkpoint that belong to this lap
+	for(i = 0; i < EVLOG_CHECKPOINT; i++){
+		evlog_read(evlogHead, &rec);
+		if((rec.type & EVLOG_LAP) != evlogLap){
+			break;
+		}
+		if(++evlogHead >= EVLOG_RECORDS){
+			evlogHead = 0;
+			evlogLap ^= EVLOG_LAP;
+		}
+	}
+	evlogSinceCheckpoint = i;	//they count towards the next checkpoint
+	evlogLastTime = getTicks();
+	evlog_write(TEL_BOOT, 0);
+	return;
+}
+
+/*
+ * Function:  evlog_find_checkpoint
+ *  Reads the checkpoint slots and returns the newest one. Slots are used in
+ *	sequence order, so the newest slot is the one whose next slot does not 
+ *	hold the next sequence number.
+ *
+ *	head	uint16_t*	checkpointed head index
+ *	lap		uint8_t*	checkpointed lap bit
+ *
+ *  returns:    0	checkpoint found
+ *		1	no valid checkpoint
+ */
+int evlog_find_checkpoint(uint16_t* head, uint8_t* lap){
+	uint8_t h[EVLOG_HEADERS][4];	//index low, index high, sequence, check
+	uint8_t valid[EVLOG_HEADERS];
+	int next;
+	
+	eeprom_read_block(h, (uint8_t*)EVLOG_HEADER_BASE, sizeof(h));
+	for(int i = 0; i < EVLOG_HEADERS; i++){
+		valid[i] = (h[i][3] == (uint8_t)(h[i][0] ^ h[i][1] ^ h[i][2] ^ 0xA5))
+			&& ((h[i][2] % EVLOG_HEADERS) == i);
+	}
+	for(int i = 0; i < EVLOG_HEADERS; i++){
+		next = (i + 1) % EVLOG_HEADERS;
+		if(valid[i] && 
+		   (!valid[next] || (h[next][2] != (uint8_t)(h[i][2] + 1)))){
+			*head = (h[i][0] | (h[i][1] << 8)) & 0x7FFF;
+			*lap = (h[i][1] & 0x80) ? EVLOG_LAP : 0;
+			evlogSeq = h[i][2];
+			if(*head >= EVLOG_RECORDS){
+				return 1;
+			}
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Function:  evlog_write
+ *  Writes a record at the head of the log and checkpoints the head every
+ *	EVLOG_CHECKPOINT records. Waits for any configuration write first and 
+ *	for the EEPROM (about 13 ms for a record).
+ *
+ *	type	uint8_t		event type (TEL_ event types)
+ *	arg		uint8_t		event argument
+ *
+ *  returns:    none
+ */
+void evlog_write(uint8_t type, uint8_t arg){
+	EventRecord rec;
+	unsigned long now = getTicks();
+	unsigned long delta = (now - evlogLastTime) / 1000;
+	
+	rec.type = (type & ~EVLOG_LAP) | evlogLap;
+	rec.arg = arg;
+	rec.delta = (delta > 0xFFFF) ? 0xFFFF : delta;
+	evlogLastTime += delta * 1000;	//keep the remainder for the next delta
+	
+	config_wait();
+	eeprom_update_block(&rec, 
+		(uint8_t*)(EVLOG_BASE + evlogHead * sizeof(EventRecord)), 
+		sizeof(EventRecord));
+	
+	if(++evlogHead >= EVLOG_RECORDS){
+		evlogHead = 0;
+		evlogLap ^= EVLOG_LAP;
+	}
+	if(++evlogSinceCheckpoint >= EVLOG_CHECKPOINT){
+		evlog_checkpoint();
+	}
+	return;
+}
+
+/*
+ * Function:  evlog_checkpoint
+ *  Writes the head and lap bit to the next checkpoint slot.
+ *
+ *  returns:    none
+ */
+void evlog_checkpoint(){
+	uint8_t h[4];
+	
+	evlogSeq++;
+	h[0] = evlogHead & 0xFF;
+	h[1] = (evlogHead >> 8) | (evlogLap ? 0x80 : 0);
+	h[2] = evlogSeq;
+	h[3] = h[0] ^ h[1] ^ h[2] ^ 0xA5;
+	config_wait();
+	eeprom_update_block(h, 
+		(uint8_t*)(EVLOG_HEADER_BASE + (evlogSeq % EVLOG_HEADERS) * 4), 4);
+	evlogSinceCheckpoint = 0;
+	return;
+}
+
+/*
+ * Function:  evlog_read
+ *  Reads a record.
+ *
+ *	index	uint16_t		record index
+ *	rec		EventRecord*	record read
+ *
+ *  returns:    none
+ */
+void evlog_read(uint16_t index, EventRecord* rec){
+	eeprom_read_block(rec, 
+		(uint8_t*)(EVLOG_BASE + index * sizeof(EventRecord)), 
+		sizeof(EventRecord));
+	return;
+}
+
+/*
+ * Function:  evlog_dump
+ *  Prints the log over USART0, oldest record first. Each line is the 
+ *	record number, the time since the boot record before it (s), the event
+ *	type and the argument. Printing waits only on the transmit buffer, so
+ *	the log is sent at the full line rate.
+ *
+ *  returns:    none
+ */
+void evlog_dump(){
+	EventRecord rec;
+	uint16_t index = evlogHead;		//oldest record of the previous lap
+	unsigned long t = 0;
+	int n = 0;
+	
+	config_wait();
+	for(int i = 0; i < EVLOG_RECORDS; i++){
+		evlog_read(index, &rec);
+		if(++index >= EVLOG_RECORDS){
+			index = 0;
+		}
+		if((rec.type & ~EVLOG_LAP) == EVLOG_EMPTY){		//never written
+			continue;
+		}
+		if((rec.type & ~EVLOG_LAP) == TEL_BOOT){
+			t = 0;
+		}
+		else{
+			t += rec.delta;
+		}
+		fprintf_P(&USART0_OUT, PSTR("%d %lu %u %u\n"), n++, t, 
+			rec.type & ~EVLOG_LAP, rec.arg);
+	}
+	return;
+}
+
+#endif
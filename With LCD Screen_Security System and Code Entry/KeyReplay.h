@@ -0,0 +1,248 @@
+/*
+ * KeyReplay.h
+ *
+ * Header file for replaying scripted keypresses on the target. A script is
+ * given on the serial console ("keys" command) and each key is handed to
+ * getNewKey as if it had been read from the keypad, one key each time the
+ * panel waits for input and no sooner than the gap after the last one.
+ * Every frame drawn while a script runs is printed with its time and the
+ * ms since the last key, and the screens expected by the script and a
+ * latency budget are checked.
+ *
+ * Script characters:
+ *	0-9 A-D * #		key
+ *	/ms				gap before each following key (default REPLAY_GAP_MS)
+ *	!ms				latency budget for the first frame after each key
+ *	>v				last frame drawn since the previous key must be view v
+ *	space			ignored
+ *
+ * e.g. "/200 C1234#>2 5678#>4 1>1" changes the PIN from 1234 to 5678.
+ * Keys go in after the debounce and keypad scan, so bounce and held keys
+ * are not replayed.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef KEYREPLAY_H_
+#define KEYREPLAY_H_
+
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include "SysTick.h"
+#include "USART0.h"
+#include "Keypad.h"
+#include "../Common/Display.h"
+
+#define REPLAY_STEPS 32			//max keys and expectations in a script
+#define REPLAY_GAP_MS 300		//default gap between keys
+#define REPLAY_BUDGET_MS 50		//default latency budget
+#define REPLAY_EXPECT 0x80		//step flag, step is an expected view
+
+int replay_start(const char* script);
+int replay_key(char c);
+void replay_poll();
+void replay_check(uint8_t step);
+void replay_frame(const DisplayModel* m);
+void replay_end();
+
+uint8_t replaySteps[REPLAY_STEPS];	//key codes, or REPLAY_EXPECT | view
+uint16_t replayGaps[REPLAY_STEPS];	//gap before each key
+uint8_t replayCount = 0;			//steps in the script
+uint8_t replayNext = 0;				//next step to run
+uint8_t replayActive = 0;			//1 while a script runs
+uint16_t replayBudget = REPLAY_BUDGET_MS;
+unsigned long replayKeyTime = 0;	//when the last key was handed over
+uint8_t replayFramed = 0;			//1 once the last key has been timed
+int replayView = -1;				//last view drawn since the last key
+uint16_t replayKeys = 0;			//keys handed over
+uint16_t replayFrames = 0;			//frames drawn
+uint16_t replayMaxLatency = 0;		//slowest first frame after a key, ms
+uint16_t replayFails = 0;			//missed expectations and budgets
+
+
+/*
+ * Function:  replay_start
+ *  Parses a script and starts replaying it. Frames are traced from now on.
+ *
+ *  script	const char*	keys, gaps, budget and expected views
+ *
+ *  returns:    0	script started
+ *		1	script is too long or has an unknown character
+ */
+int replay_start(const char* script){
+	uint16_t gap = REPLAY_GAP_MS;
+	uint16_t n;
+	char c;
+	int key;
+
+	replayCount = 0;
+	replayBudget = REPLAY_BUDGET_MS;
+	while((c = *script++) != '\0'){
+		if(c == ' '){
+			continue;
+		}
+		if((c == '/') || (c == '!') || (c == '>')){
+			n = 0;
+			while((*script >= '0') && (*script <= '9')){
+				n = n * 10 + (*script++ - '0');
+			}
+			if(c == '/'){
+				gap = n;
+				continue;
+			}
+			if(c == '!'){
+				replayBudget = n;
+				continue;
+			}
+			key = REPLAY_EXPECT | n;	//'>'
+		}
+		else if((key = replay_key(c)) < 0){
+			return 1;
+		}
+		if(replayCount >= REPLAY_STEPS){
+			return 1;
+		}
+		replaySteps[replayCount] = key;
+		replayGaps[replayCount] = gap;
+		replayCount++;
+	}
+
+	replayNext = 0;
+	replayKeys = 0;
+	replayFrames = 0;
+	replayMaxLatency = 0;
+	replayFails = 0;
+	replayView = -1;
+	replayFramed = 1;			//no key yet, nothing to time
+	replayKeyTime = getTicks();
+	displayTraceHook = replay_frame;
+	replayActive = 1;
+	return 0;
+}
+
+/*
+ * Function:  replay_key
+ *  Converts a script character to a keypad value (see readNumPad).
+ *
+ *  c		char	0-9, A-D, # or *
+ *
+ *  returns:    int	key value, -1 for other characters
+ */
+int replay_key(char c){
+	if((c >= '0') && (c <= '9')){
+		return c - '0';
+	}
+	if((c >= 'A') && (c <= 'D')){
+		return c - 'A' + 0xA;
+	}
+	if((c >= 'a') && (c <= 'd')){
+		return c - 'a' + 0xA;
+	}
+	if(c == '#'){
+		return 0xE;
+	}
+	if(c == '*'){
+		return 0xF;
+	}
+	return -1;
+}
+
+/*
+ * Function:  replay_poll
+ *  Keypad idle hook work. Checks expected views and hands over the next
+ *  key once its gap has passed. Only called while getNewKey is waiting, so
+ *  no key is lost to waitForKeypadClear.
+ *
+ *  returns:    none
+ */
+void replay_poll(){
+	if(!replayActive){
+		return;
+	}
+	while((replayNext < replayCount) &&
+		  (replaySteps[replayNext] & REPLAY_EXPECT)){
+		replay_check(replaySteps[replayNext]);
+		replayNext++;
+	}
+	if(replayNext >= replayCount){
+		replay_end();
+		return;
+	}
+	if(getTicks() - replayKeyTime < replayGaps[replayNext]){
+		return;
+	}
+	replayKeyTime = getTicks();
+	replayFramed = 0;
+	replayView = -1;
+	replayKeys++;
+	pressedKey = replaySteps[replayNext++];
+	newKeyInput = 1;
+	return;
+}
+
+/*
+ * Function:  replay_check
+ *  Checks an expect step against the last view drawn since the last key.
+ *  A failure is printed and counted.
+ *
+ *  step	uint8_t		REPLAY_EXPECT | view
+ *
+ *  returns:    none
+ */
+void replay_check(uint8_t step){
+	if(replayView != (step & ~REPLAY_EXPECT)){
+		fprintf_P(&USART0_OUT, PSTR("FAIL key %u: view %d, expected %u\n"),
+			replayKeys, replayView, step & ~REPLAY_EXPECT);
+		replayFails++;
+	}
+	return;
+}
+
+/*
+ * Function:  replay_frame
+ *  Display trace hook. Prints the frame and times the first one after
+ *  each key against the budget.
+ *
+ *  m		const DisplayModel*	render model just drawn
+ *
+ *  returns:    none
+ */
+void replay_frame(const DisplayModel* m){
+	unsigned long now = getTicks();
+	uint16_t latency = now - replayKeyTime;
+
+	replayFrames++;
+	replayView = m->view;
+	fprintf_P(&USART0_OUT, PSTR("frame %lu +%u view %u value %u\n"),
+		now, latency, m->view, m->value);
+	if(replayFramed){
+		return;
+	}
+	replayFramed = 1;
+	if(latency > replayMaxLatency){
+		replayMaxLatency = latency;
+	}
+	if(latency > replayBudget){
+		fprintf_P(&USART0_OUT, PSTR("FAIL key %u: %u ms, over budget\n"),
+			replayKeys, latency);
+		replayFails++;
+	}
+	return;
+}
+
+/*
+ * Function:  replay_end
+ *  Stops tracing and prints the result of the script.
+ *
+ *  returns:    none
+ */
+void replay_end(){
+	replayActive = 0;
+	displayTraceHook = 0;
+	fprintf_P(&USART0_OUT, PSTR("replay %S: %u keys %u frames max %u ms\n"),
+		replayFails ? PSTR("FAIL") : PSTR("pass"), replayKeys,
+		replayFrames, replayMaxLatency);
+	return;
+}
+
+#endif /* KEYREPLAY_H_ */
@@ -2,7 +2,9 @@
  * Keypad.h
  *
  * Header file for taking 4x4 keypad input using external interrupts.
- * Uses external interrupts 0 - 3.
+ * Uses external interrupts 0 - 3. An interrupt only masks the keypad 
+ * interrupts and starts a debounce count on the system tick. When it ends
+ * the keypad is scanned from the main loop through the work queue.
  * Author : Jace Johnson
  * Rev 1
  * Hardware:	ATMega 2560 operating at 16 MHz
@@ -32,8 +34,16 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include <avr/interrupt.h>
+#include "SysTick.h"
+#include "../Common/WorkQueue.h"
+#include "../Common/Probe.h"
+
+#define KEY_DEBOUNCE_MS 100	//delay from a key edge to reading the keypad
 
 void initKeypad();
+void keyEdge(int col);
+void keyTickHook();
+void keyScanWork(uint8_t col);
 void initExInterrupts();
 void readNumPad(int readCol);
 void waitForKeypadClear();
@@ -42,91 +52,120 @@ void getNewKey();
 
 int newKeyInput = 0;	//flag for if the input in pressedKey is new
 int pressedKey = -1;	//var for key that is currently pressed
+unsigned long keyPresses = 0;	//keys returned by getNewKey since reset
+void (*keyPressHook)(int key) = 0;	//called by getNewKey with each new key
+void (*keypadIdleHook)(void) = 0;	//called while getNewKey waits for a key
+volatile uint8_t keyDebounce = 0;	//ms left before the keypad is read
+volatile uint8_t keyCol;			//column of the last key edge
 
 /*
  * ISR(INT0_vect)
- *  Finds which key was pressed in the leftmost row (pin 4 of the keypad, 
- *	PORTD0). Sets pressedKey to this value and sets newKeyInput flag.
+ *  Key edge in the leftmost row (pin 4 of the keypad, PORTD0).
  *
  *  returns:    none
  */
 ISR(INT0_vect){
-	if(newKeyInput == 0){
-		_delay_ms(100);		//debounce delay
-		
-		int readCol = 0;	//read column 0
-		readNumPad(readCol);
-		
-		newKeyInput = 1;	//set new input flag
-	}
+	keyEdge(0);			//read column 0 after the debounce delay
 }
 
 /*
  * ISR(INT1_vect)
- *  Finds which key was pressed in the middle-left row (pin 3 of the keypad,
- *	PORTD1). Sets pressedKey to this value and sets newKeyInput flag.
+ *  Key edge in the middle-left row (pin 3 of the keypad, PORTD1).
  *
  *  returns:    none
  */
 ISR(INT1_vect){
-	if(newKeyInput == 0){
-		_delay_ms(100);		//debounce delay
-		
-		int readCol = 1;	//read column 1
-		readNumPad(readCol);
-		
-		newKeyInput = 1;	//set new input flag
-	}
+	keyEdge(1);			//read column 1 after the debounce delay
 }
 
 /*
  * ISR(INT2_vect)
- *  Finds which key was pressed in the middle-right row (pin 2 of the keypad,
- *	PORTD2). Sets pressedKey to this value and sets newKeyInput flag.
+ *  Key edge in the middle-right row (pin 2 of the keypad, PORTD2).
  *
  *  returns:    none
  */
 ISR(INT2_vect){
-	if(newKeyInput == 0){
-		_delay_ms(100);		//debounce delay
-		
-		int readCol = 2;	//read column 2
-		readNumPad(readCol);
-		
-		newKeyInput = 1;	//set new input flag
-	}
+	keyEdge(2);			//read column 2 after the debounce delay
 }
 
 /*
  * ISR(INT3_vect)
- *  Finds which key was pressed in the rightmost row (pin 1 of the keypad,
- *	PORTD3). Sets pressedKey to this value and sets newKeyInput flag.
+ *  Key edge in the rightmost row (pin 1 of the keypad, PORTD3).
  *
  *  returns:    none
  */
 ISR(INT3_vect){
-	if(newKeyInput == 0){
-		_delay_ms(100);		//debounce delay
-		
-		int readCol = 3;	//read column 3
-		readNumPad(readCol);
-		
-		newKeyInput = 1;	//set new input flag
-	}
+	keyEdge(3);			//read column 3 after the debounce delay
 }
 
 /*
  * Function:  initKeypad
- *  Calls functions to initialize external interrupt 0 - 3.
+ *  Calls functions to initialize external interrupt 0 - 3 and adds the 
+ *	debounce tick hook. The system tick must be running.
  *
  *  returns:    none
  */
 void initKeypad(){
 	initExInterrupts();	//initialize external interrupts
+	addTickHook(keyTickHook);
 	sei();				//enable global interrupts
 	return;
 }
 
+/*
+ * Function:  keyEdge
+ *  Called by the keypad interrupts. Masks them while the key bounces and
+ *	starts the debounce count. Ignored while the last key is unread.
+ *
+ *	col		int		keypad column that saw the edge
+ *
+ *  returns:    none
+ */
+void keyEdge(int col){
+	PROBE_SCOPE(PROBE_ISR_KEYPAD);
+	WORK_ISR_BEGIN();
+	if(newKeyInput == 0){
+		EIMSK &= ~((1<<INT0)|(1<<INT1)|(1<<INT2)|(1<<INT3));
+		keyCol = col;
+		keyDebounce = KEY_DEBOUNCE_MS;
+	}
+	WORK_ISR_END();
+	return;
+}
+
+/*
+ * Function:  keyTickHook
+ *  System tick hook. Counts down the debounce delay and then posts the 
+ *	keypad scan to the work queue.
+ *
+ *  returns:    none
+ */
+void keyTickHook(){
+	if((keyDebounce != 0) && (--keyDebounce == 0)){
+		work_post(WORK_HIGH, keyScanWork, keyCol);
+	}
+	return;
+}
+
+/*
+ * Function:  keyScanWork
+ *  Work queue item. Reads the key in the column that saw the edge and turns
+ *	the keypad interrupts back on. readNumPad sets newKeyInput only if a key
+ *	is still down, so a bounce or a release never hands getNewKey a -1.
+ *	Edges caused by the scan itself are cleared first.
+ *
+ *	col		uint8_t		keypad column to read
+ *
+ *  returns:    none
+ */
+void keyScanWork(uint8_t col){
+	readNumPad(col);	//sets newKeyInput if a key was read
+	
+	EIFR = (1<<INTF0)|(1<<INTF1)|(1<<INTF2)|(1<<INTF3);
+	EIMSK |= (1<<INT0)|(1<<INT1)|(1<<INT2)|(1<<INT3);
+	return;
+}
+
 /*
  * Function:  initExInterrupts
  *  Sets PORTC 0 - 3 as outputs and PORTD 0 - 3 as inputs. enables external 
@@ -144,7 +183,7 @@ void initExInterrupts(){
 	//set external interrupt to trigger on falling edge (pin state change from
 	//5V to GND) for external interrupt pins 0 - 3
 	EICRA |= (1<<ISC01)|(1<<ISC11)|(1<<ISC21)|(1<<ISC31);
-	EICRA &= !((1<<ISC00)|(1<<ISC10)|(1<<ISC20)|(1<<ISC30));
+	EICRA &= ~((1<<ISC00)|(1<<ISC10)|(1<<ISC20)|(1<<ISC30));
 	//enable external interrupts 0 - 3
 	EIMSK |= (1<<INT0)|(1<<INT1)|(1<<INT2)|(1<<INT3);
 	return;
@@ -165,11 +204,12 @@ void initExInterrupts(){
  *  returns:    none
  */
 void readNumPad(int readCol){
+	PROBE_SCOPE(PROBE_KEYPAD_READ);
 	if((readCol == -1)||(readCol > 3)){	//if column is invalid, return
 		return;
 	}
 	
-	int keyPressed[4][4] = {	//2D array of keypad button values
+	static const uint8_t keyPressed[4][4] = {	//keypad button values
 		{0X1, 0x2, 0x3, 0xA},
 		{0x4, 0x5, 0x6, 0xB},
 		{0x7, 0x8, 0x9, 0xC},
@@ -177,7 +217,7 @@ void readNumPad(int readCol){
 	};
 	
 	//row mask for different rows of keypad
-	int keyRowMask[4] = {0xF7, 0xFB, 0xFD, 0xFE};
+	static const uint8_t keyRowMask[4] = {0xF7, 0xFB, 0xFD, 0xFE};
 	
 	//loop to check each row
 	for(int row = 0; row < 4; row++){
@@ -232,8 +272,17 @@ void getNewKey(){
 	waitForKeypadClear();		//wait for keypad to clear
 	
 	while(pressedKey == -1){	//wait for new key to be pressed
+		work_run();				//keypad scan and other deferred work
+		if(keypadIdleHook != 0){	//do background work while waiting
+			keypadIdleHook();
+		}
 		_delay_us(1);			//short delay
 		}
+	
+	keyPresses++;
+	if(keyPressHook != 0){		//report new key
+		keyPressHook(pressedKey);
+	}
 	return;
 }
 
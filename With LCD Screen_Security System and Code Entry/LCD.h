@@ -19,14 +19,21 @@
  * | A5    27|---------|D5		|
  * | A4    26|---------|D4		|
  * |      	 |         |		|
- * | C1    52|---------|E		|
+ * | B1    52|---------|E		|
  * |		 |	  GND--|RW		|	10KOhm Potentiometer
- * | C0    53|---------|RS		|			POT
+ * | B0    53|---------|RS		|			POT
  * |      	 |         |		|		-----------
  * |		 |		   |	  V0|-------|W		5V|--5V
  * |	     |    5V---|VDD		|		|	   GND|--GND
  * |	  GND|---GND---|VSS		|		-----------
  * -----------		   ----------
+ *
+ * Build options (define before including LCD.h or pass with -D)
+ *  LCD_8BIT_BUS	D0 - D7 are wired to A0 - A7 and each byte is sent with a
+ *			single enable pulse instead of two nybbles
+ *  LCD_RW_WIRED	RW is wired to C5 instead of GND. The busy flag (D7) is
+ *			polled after each write instead of waiting a fixed worst
+ *			case delay
  */
 
 #ifndef LCD_H
@@ -36,6 +43,9 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include <avr/interrupt.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "../Common/Probe.h"
 
 //prototypes for functions provided by Dr. Randy Hoover
 void LCD_init(void);
@@ -44,6 +54,10 @@ void LCD_write_4bits(uint8_t Data);
 void LCD_write_instruction(uint8_t Instruction);
 void LCD_EnablePulse(void);
 void LCD_write_char(char Data);
+void LCD_write_byte(uint8_t Data);
+void LCD_wait_busy(void);
+void LCD_init_start(void);
+void LCD_init_step(void);
 
 #define MAX_INPUT 40
 
@@ -51,21 +65,35 @@ void LCD_write_char(char Data);
 #define LCD_Reset              0b00110000          // reset the LCD to put in 4-bit mode //
 #define LCD_4bit_enable        0b00100000          // 4-bit data - can't set the line display or fonts until this is set  //
 #define LCD_4bit_mode          0b00101000          // 2-line display, 5 x 8 font  //
+#define LCD_8bit_mode          0b00111000          // 8-bit data, 2-line display, 5 x 8 font  //
 #define LCD_4bit_displayOFF    0b00001000          // set display off  //
 #define LCD_4bit_displayON     0b00001100         // set display on - no blink //
 #define LCD_4bit_displayON_Bl  0b00001101         // set display on - with blink //
 #define LCD_4bit_displayCLEAR  0b00000001          // replace all chars with "space"  //
 #define LCD_4bit_entryMODE     0b00000110          // set curser to write/read from left -> right  //
 #define LCD_4bit_cursorSET     0b10000000          // set cursor position
+#define LCD_4bit_cgramSET      0b01000000          // set CGRAM address (custom character bitmaps)
 
 
 //  For two line mode  //
 #define LineOneStart 0x00
 #define LineTwoStart 0x40 //  must set DDRAM address in LCD controller for line two  //
+#define LCD_LineLength 16 //  visible characters on each line  //
+#define LCD_CursorCGRAM 0xFF //  address counter is pointing at CGRAM, not the screen  //
 
-//  Pin definitions for PORTC control lines  //
+//  Pin definitions for the control lines - E and RS on PORTB, RW on PORTC  //
 #define LCD_EnablePin 1
 #define LCD_RegisterSelectPin 0
+#define LCD_ReadWritePin 5
+
+//  Data lines on PORTA and function set for the selected bus width  //
+#ifdef LCD_8BIT_BUS
+#define LCD_DataMask 0xFF
+#define LCD_FunctionSet LCD_8bit_mode
+#else
+#define LCD_DataMask 0xF0
+#define LCD_FunctionSet LCD_4bit_mode
+#endif
 
 //Prototypes for functions provided by Jace Johnson
 void LCD_write_str(char arr[MAX_INPUT], int* LCDLine);
@@ -75,32 +103,141 @@ int checkClearInput(char input[MAX_INPUT]);
 int checkInputLen(char input[MAX_INPUT]);
 void outputLine(char input[MAX_INPUT], int* LCDLine, int changeLine);
 void printErr(int* LCDLine);
+uint8_t LCD_bus_enter(uint8_t ctx);
+void LCD_bus_leave(uint8_t* prev);
+void LCD_bus_reset();
+
+//caller contexts for the bus counters
+#define LCD_CTX_OTHER 0
+#define LCD_CTX_INIT 1
+#define LCD_CTX_SCROLL 2
+#define LCD_CTX_BLINK 3
+#define LCD_CTX_GLYPH 4
+#define LCD_CTX_VIEW 5		//plus the render model view (Display.h)
+#define LCD_CTX_VIEWS 10
+#define LCD_CTX_COUNT (LCD_CTX_VIEW + LCD_CTX_VIEWS)
+
+//count bus traffic against ctx for the rest of the enclosing scope
+#define LCD_BUS_SCOPE(ctx) uint8_t LCDBusPrev \
+	__attribute__((cleanup(LCD_bus_leave))) = LCD_bus_enter(ctx)
+
+//bus traffic of one caller context
+typedef struct{
+	uint32_t instructions;
+	uint32_t data;			//characters and CGRAM rows
+	uint32_t pulses;		//enable pulses, busy flag reads included
+}LCDBusCount;
+
+
+uint8_t LCDCursor = 0;	//DDRAM address the next character is written to
+char LCDShadow[2][LCD_LineLength];	//characters currently shown on each line
 
+volatile int LCDReady = 0;	//1 when the LCD has finished initializing, no
+				//other LCD functions can be used before this
+int LCDInitStep = 0;		//next step of the initialization sequence
+int LCDInitWait = 0;		//ms left before the next step can run
+volatile uint8_t LCDBusLock = 0;	//non zero while a write is on the bus, 
+					//interrupts must not write to the LCD then
+LCDBusCount LCDBusStats[LCD_CTX_COUNT];	//bus traffic by caller context
+uint8_t LCDBusCtx = LCD_CTX_OTHER;	//context bus traffic is counted against
+
+const char LCDBusNames[LCD_CTX_COUNT][8] PROGMEM = {
+	"other",
+	"init",
+	"scroll",
+	"blink",
+	"glyph",
+	"setup",
+	"idle",
+	"code",
+	"pin",
+	"showpin",
+	"armed",
+	"disarm",
+	"error",
+	"count",
+	"lockout"
+};
 
 
 //  Important notes in sequence from page 26 in the KS0066U datasheet - initialize the LCD in 4-bit two line mode //
 //  LCD is initially set to 8-bit mode - we need to reset the LCD controller to 4-bit mode before we can set anyting else //
+//  The sequence is split into steps that are run from a 1 ms timer tick (LCD_init_step) so the rest of the   //
+//  system is live while the LCD starts up. Each step waits the datasheet minimum rounded up to whole ms.      //
 void LCD_init(void)
 {
-	DDRC |= 0x23;	//setup pins in ports A and C as outputs for LCD screen
-	DDRA |= 0xF0;
-	
-    //  Wait for power up - more than 30ms for vdd to rise to 4.5V //
-    _delay_ms(100);
+    LCD_init_start();
     
+    //  run the same sequence with blocking delays  //
+    while(!LCDReady){
+        _delay_ms(1);
+        LCD_init_step();
+    }
+}
+
+//  Set up the LCD pins and restart the initialization sequence  //
+void LCD_init_start(void)
+{
+	DDRB |= 0x03;	//setup pins in ports A, B and C as outputs for LCD screen
+	DDRC |= 0x20;	//RW, driven with LCD_RW_WIRED
+	DDRA |= LCD_DataMask;
+	
     //  Note that we need to reset the controller to enable 4-bit mode //
     LCD_E_RS_init();  //  Set the E and RS pins active low for each LCD reset  //
     
-    //  Reset and wait for activation  //
-    LCD_write_4bits(LCD_Reset);
-    _delay_ms(10);
-    
-    //  Now we can set the LCD to 4-bit mode  //
-    LCD_write_4bits(LCD_4bit_enable);
-    _delay_us(80);  //  delay must be > 39us  //
-    
-    
+    //  Wait for power up - more than 30ms for vdd to rise to 4.5V //
+    LCDReady = 0;
+    LCDInitStep = 0;
+    LCDInitWait = 31;
+}
+
+//  Run the next step of the initialization sequence - call every 1 ms until LCDReady is set  //
+void LCD_init_step(void)
+{
+    LCD_BUS_SCOPE(LCD_CTX_INIT);
+    if(LCDReady){
+        return;
+    }
+    if(LCDInitWait > 0){  //  previous step has not finished yet  //
+        LCDInitWait--;
+        if(LCDInitWait > 0){
+            return;
+        }
+    }
     
+    switch(LCDInitStep++){
+#ifndef LCD_8BIT_BUS
+    //  Reset by instruction (HD44780 datasheet figure 24) - three 8-bit function sets put the controller  //
+    //  in 8-bit mode whatever mode it was left in, e.g. 4-bit after a reset of the AVR alone  //
+    case 0:
+        //  Reset and wait for activation  //
+        LCD_write_4bits(LCD_Reset);
+        LCDInitWait = 5;  //  delay must be > 4.1ms  //
+        break;
+        
+    case 1:
+        LCD_write_4bits(LCD_Reset);
+        LCDInitWait = 1;  //  delay must be > 100us  //
+        break;
+        
+    case 2:
+        LCD_write_4bits(LCD_Reset);
+        LCDInitWait = 1;  //  delay must be > 100us  //
+        break;
+        
+    case 3:
+        //  Now we can set the LCD to 4-bit mode  //
+        LCD_write_4bits(LCD_4bit_enable);
+        LCDInitWait = 1;  //  delay must be > 39us - busy flag can't be read yet  //
+        break;
+#else
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+        break;  //  every instruction is a full byte, no reset needed  //
+#endif
+        
     ////////////////  system reset is complete - set up LCD modes  ////////////////////
     //  At this point we are operating in 4-bit mode
     //  (which means we have to send the high-nibble and low-nibble separate)
@@ -108,32 +245,43 @@ void LCD_init(void)
     //  Notice:  we use the "LCD_wirte_4bits() when in 8-bit mode and the LCD_instruction() (this just
     //  makes use of two calls to the LCD_write_4bits() function )
     //  once we're in 4-bit mode.  The set of instructions are found in Table 7 of the datasheet.  //
-    LCD_write_instruction(LCD_4bit_mode);
-    _delay_us(80);  //  delay must be > 39us  //
-    
+    //  LCD_write_instruction() waits for the LCD to finish (> 39us) before returning  //
+    case 4:
+        LCD_write_instruction(LCD_FunctionSet);
+        break;
+        
     //  From page 26 (and Table 7) in the datasheet we need to:
     //  display = off, display = clear, and entry mode = set //
-    LCD_write_instruction(LCD_4bit_displayOFF);
-    _delay_us(80);  //  delay must be > 39us  //
-    
-    LCD_write_instruction(LCD_4bit_displayCLEAR);
-    _delay_ms(80);  //  delay must be > 1.53ms  //
-    
-    LCD_write_instruction(LCD_4bit_entryMODE);
-    _delay_us(80);  //  delay must be > 39us  //
-    
+    case 5:
+        LCD_write_instruction(LCD_4bit_displayOFF);
+        break;
+        
+    case 6:
+        LCD_write_instruction(LCD_4bit_displayCLEAR);
+        LCDInitWait = 2;  //  delay must be > 1.53ms  //
+        break;
+        
+    case 7:
+        LCD_write_instruction(LCD_4bit_entryMODE);
+        break;
+        
     //  The LCD should now be initialized to operate in 4-bit mode, 2 lines, 5 x 8 dot fonstsize  //
     //  Need to turn the display back on for use  //
-    LCD_write_instruction(LCD_4bit_displayON);
-    _delay_us(80);  //  delay must be > 39us  //
-
+    default:
+        LCD_write_instruction(LCD_4bit_displayON);
+        LCDReady = 1;
+        break;
+    }
 }
 
 void LCD_E_RS_init(void)
 {
     //  Set up the E and RS lines to active low for the reset function  //
-    PORTC &= ~(1<<LCD_EnablePin);
-    PORTC &= ~(1<<LCD_RegisterSelectPin);
+    PORTB &= ~(1<<LCD_EnablePin);
+    PORTB &= ~(1<<LCD_RegisterSelectPin);
+#ifdef LCD_RW_WIRED
+    PORTC &= ~(1<<LCD_ReadWritePin);  //  RW low for writing  //
+#endif
 }
 
 //  Send a byte of Data to the LCD module  //
@@ -151,37 +299,104 @@ void LCD_write_4bits(uint8_t Data)
 void LCD_write_instruction(uint8_t Instruction)
 {
     //  ensure RS is low  //
-    //PORTC &= ~(1<<LCD_RegisterSelectPin);
+    //PORTB &= ~(1<<LCD_RegisterSelectPin);
+    LCDBusLock++;
     LCD_E_RS_init();  //  Set the E and RS pins active low for each LCD reset  //
     
-    LCD_write_4bits(Instruction);  //  write the high nybble first  //
-    LCD_write_4bits(Instruction<<4);  //  write the low nybble  //
+    LCD_write_byte(Instruction);  //  write the instruction (high nybble first in 4-bit mode)  //
+    LCD_wait_busy();  //  need to wait > 39us (> 1.53ms for clear)  //
+    LCDBusStats[LCDBusCtx].instructions++;
+    LCDBusLock--;
     
+    //  keep track of the address counter so LCDShadow follows the screen  //
+    if(Instruction & LCD_4bit_cursorSET){
+        LCDCursor = Instruction & 0x7F;
+    }
+    else if(Instruction & LCD_4bit_cgramSET){
+        LCDCursor = LCD_CursorCGRAM;
+    }
+    else if(Instruction == LCD_4bit_displayCLEAR){
+        LCDCursor = 0;
+        memset(LCDShadow, ' ', sizeof(LCDShadow));
+    }
+}
+
+//  Put a byte on the data lines - one enable pulse in 8-bit mode, two in 4-bit mode  //
+void LCD_write_byte(uint8_t Data)
+{
+#ifdef LCD_8BIT_BUS
+    PORTA = Data;  //  all of PORTA is used for D0 - D7  //
+    LCD_EnablePulse();  //  Pulse the enable to write the data  //
+#else
+    LCD_write_4bits(Data & 0xF0);  //  write the high nybble first  //
+    LCD_write_4bits(Data<<4);  //  write the low nybble  //
+#endif
+}
+
+//  Wait until the LCD can take the next instruction or character  //
+//  With RW wired the busy flag (D7) is read back - most controllers finish in ~37us  //
+//  Without RW the worst case execution time has to be waited out  //
+void LCD_wait_busy(void)
+{
+#ifdef LCD_RW_WIRED
+    uint8_t busy;
     
+    DDRA &= (uint8_t)~LCD_DataMask;  //  data lines are inputs while reading  //
+    PORTA &= (uint8_t)~LCD_DataMask;  //  no pull ups on the data lines  //
+    PORTB &= ~(1<<LCD_RegisterSelectPin);  //  RS low and RW high to read the busy flag  //
+    PORTC |= (1<<LCD_ReadWritePin);
+    
+    do{
+        PORTB |= (1<<LCD_EnablePin);  //  busy flag is valid while enable is high  //
+        _delay_us(1);
+        busy = PINA & 0x80;  //  D7 is the busy flag  //
+        PORTB &= ~(1<<LCD_EnablePin);
+        LCDBusStats[LCDBusCtx].pulses++;
+        _delay_us(1);
+#ifndef LCD_8BIT_BUS
+        LCD_EnablePulse();  //  clock out the low nybble (address counter)  //
+#endif
+    }while(busy);
+    
+    PORTC &= ~(1<<LCD_ReadWritePin);  //  back to writing  //
+    DDRA |= LCD_DataMask;
+#else
+    _delay_us(80);  //  worst case execution time is > 43us  //
+#endif
 }
 
 //  Pulse the Enable pin on the LCD controller to write/read the data lines - should be at least 230ns pulse width //
 void LCD_EnablePulse(void)
 {
     //  Set the enable bit low -> high -> low  //
-    //PORTC &= ~(1<<LCD_EnablePin); // Set enable low //
+    //PORTB &= ~(1<<LCD_EnablePin); // Set enable low //
     //_delay_us(1);  //  wait to ensure the pin is low  //
-    PORTC |= (1<<LCD_EnablePin);  //  Set enable high  //
+    PORTB |= (1<<LCD_EnablePin);  //  Set enable high  //
     _delay_us(1);  //  wait to ensure the pin is high  //
-    PORTC &= ~(1<<LCD_EnablePin); // Set enable low //
+    PORTB &= ~(1<<LCD_EnablePin); // Set enable low //
     _delay_us(1);  //  wait to ensure the pin is low  //
+    LCDBusStats[LCDBusCtx].pulses++;
 }
 
 //  write a character to the display  //
 void LCD_write_char(char Data)
 {
+    LCDBusLock++;
     //  Set up the E and RS lines for data writing  //
-    PORTC |= (1<<LCD_RegisterSelectPin);  //  Ensure RS pin is set high //
-    PORTC &= ~(1<<LCD_EnablePin);  //  Ensure the enable pin is low  //
-    LCD_write_4bits(Data);  //  write the upper nybble  //
-    LCD_write_4bits(Data<<4);  //  write the lower nybble  //
-    _delay_us(80);  //  need to wait > 43us  //
+    PORTB |= (1<<LCD_RegisterSelectPin);  //  Ensure RS pin is set high //
+    PORTB &= ~(1<<LCD_EnablePin);  //  Ensure the enable pin is low  //
+    LCD_write_byte(Data);  //  write the upper nybble then the lower nybble  //
+    LCD_wait_busy();  //  need to wait > 43us  //
+    LCDBusStats[LCDBusCtx].data++;
+    LCDBusLock--;
     
+    //  record the character if it landed on a visible cell  //
+    if(LCDCursor != LCD_CursorCGRAM){
+        if((LCDCursor & 0x3F) < LCD_LineLength){
+            LCDShadow[LCDCursor >= LineTwoStart][LCDCursor & 0x3F] = Data;
+        }
+        LCDCursor++;
+    }
 }
 
 /*
@@ -197,6 +412,7 @@ void LCD_write_char(char Data)
  *  returns:  none
  */
 void LCD_write_str(char arr[MAX_INPUT], int* LCDLine){
+	PROBE_SCOPE(PROBE_LCD_WRITE);
 	int i = 0;		//array index counter
 	int count = 0;	//LCD line wrapping counter
 	
@@ -207,7 +423,6 @@ void LCD_write_str(char arr[MAX_INPUT], int* LCDLine){
 	else{				//write to line 2
 		LCD_write_instruction(LCD_4bit_cursorSET | LineTwoStart);
 	}
-	_delay_us(80);		//short delay for LCD to update
 	
 	//loop to write chars to line until null terminator is encountered
 	while(arr[i] != '\0'){
@@ -228,7 +443,6 @@ void LCD_write_str(char arr[MAX_INPUT], int* LCDLine){
 				else{				//select LDC line 2
 					LCD_write_instruction(LCD_4bit_cursorSET | LineTwoStart);
 				}
-				_delay_us(80);		//short delay for LCD to update
 			}
 		}
 	}
@@ -380,4 +594,51 @@ void printErr(int* LCDLine){
 	return;
 }
 
+/*
+ * Function:	LCD_bus_enter
+ *	Starts counting bus traffic against a caller context. Used by 
+ *	LCD_BUS_SCOPE, which puts the old context back when the scope is left.
+ *
+ *	ctx		uint8_t		LCD_CTX_ value
+ *
+ *  returns:	uint8_t		context that was active before
+ */
+uint8_t LCD_bus_enter(uint8_t ctx){
+	uint8_t prev = LCDBusCtx;
+	
+	if(ctx >= LCD_CTX_COUNT){
+		ctx = LCD_CTX_OTHER;
+	}
+	LCDBusCtx = ctx;
+	return prev;
+}
+
+/*
+ * Function:	LCD_bus_leave
+ *	Called when an LCD_BUS_SCOPE is left. Goes back to the context that was
+ *	active before it.
+ *
+ *	prev	uint8_t*	context saved by LCD_bus_enter
+ *
+ *  returns:	none
+ */
+void LCD_bus_leave(uint8_t* prev){
+	LCDBusCtx = *prev;
+	return;
+}
+
+/*
+ * Function:	LCD_bus_reset
+ *	Clears the bus counters of every context.
+ *
+ *  returns:	none
+ */
+void LCD_bus_reset(){
+	uint8_t sreg = SREG;	//save interrupt state
+	cli();
+	memset(LCDBusStats, 0, sizeof(LCDBusStats));
+	SREG = sreg;			//restore interrupt state
+	return;
+}
+
 #endif
@@ -0,0 +1,124 @@
+/*
+ * LCDBlink.h
+ *
+ * Header file to blink a message on the LCD screen without repainting it.
+ * The message is written once, then the display is switched off and on from
+ * the 1 ms system tick (one instruction per phase). Blinking runs in the 
+ * background and can be cancelled by a flag, e.g. a new keypress.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with LCD.h (Rev 1) and SysTick.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef LCDBLINK_H_
+#define LCDBLINK_H_
+
+#include "LCD.h"
+#include "SysTick.h"
+
+void LCD_blink_start(char str[], int blinks, volatile int* cancel);
+void LCD_blink_stop();
+int LCD_blink_active();
+void LCD_blink_tick();
+
+#define BLINK_PHASE_MS 500	//time the message is shown or hidden
+
+volatile int blinkPhases = 0;	//display on/off phases left
+volatile int blinkCounter = 0;	//ms left in current phase
+volatile int* blinkCancel = 0;	//blinking stops when this is non zero
+
+/*
+ * Function:  LCD_blink_start
+ *  Clears the LCD, writes the message once, and starts blinking it. Returns
+ *	immediately, the blinking is done by the system tick.
+ *
+ *	str		char[]	message to blink (wraps to the second line)
+ *	blinks	int		number of times to blink (on 0.5 s, off 0.5 s)
+ *	cancel	int*	blinking stops early when the value this points to 
+ *					becomes non zero. NULL to always blink to the end
+ *
+ *  returns:    none
+ */
+void LCD_blink_start(char str[], int blinks, volatile int* cancel){
+	int line;
+	
+	LCD_blink_stop();		//stop any previous blink
+	
+	line = 1;				//clear both lines and write message once
+	LCD_clear_line(&line);
+	line = 0;
+	LCD_clear_line(&line);
+	LCD_write_str(str, &line);
+	
+	blinkCancel = cancel;
+	blinkCounter = BLINK_PHASE_MS;
+	blinkPhases = blinks * 2;
+	addTickHook(LCD_blink_tick);
+	return;
+}
+
+/*
+ * Function:  LCD_blink_stop
+ *  Stops blinking and leaves the display on.
+ *
+ *  returns:    none
+ */
+void LCD_blink_stop(){
+	LCD_BUS_SCOPE(LCD_CTX_BLINK);
+	removeTickHook(LCD_blink_tick);
+	if(blinkPhases != 0){
+		blinkPhases = 0;
+		LCD_write_instruction(LCD_4bit_displayON);
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_blink_active
+ *  Checks if a message is still blinking.
+ *
+ *  returns:    1	message is blinking
+ *				0	blinking has finished or was cancelled
+ */
+int LCD_blink_active(){
+	return blinkPhases != 0;
+}
+
+/*
+ * Function:  LCD_blink_tick
+ *  Tick hook. Toggles the display at the end of each phase. If a write is in
+ *	progress on the LCD bus, the toggle is retried on the next tick.
+ *
+ *  returns:    none
+ */
+void LCD_blink_tick(){
+	LCD_BUS_SCOPE(LCD_CTX_BLINK);
+	if(blinkPhases == 0){
+		return;
+	}
+	if((blinkCancel != 0) && (*blinkCancel != 0)){	//cancelled, finish 
+		blinkPhases = 1;							//with display on
+		blinkCounter = 0;
+	}
+	if(blinkCounter > 0){
+		blinkCounter--;
+	}
+	if((blinkCounter > 0) || (LCDBusLock != 0)){	//wait for end of phase and
+		return;										//a free bus
+	}
+	
+	blinkPhases--;
+	blinkCounter = BLINK_PHASE_MS;
+	
+	//odd phases left means the message was just shown, so hide it. Even
+	//phases left (including the last one) show it again
+	if(blinkPhases & 0x01){
+		LCD_write_instruction(LCD_4bit_displayOFF);
+	}
+	else{
+		LCD_write_instruction(LCD_4bit_displayON);
+	}
+	return;
+}
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * LCDEdit.h
+ *
+ * Header file for a one line text entry field on the LCD, used to echo PIN
+ * digits. The field keeps its own cursor, so a new character is one data
+ * write (plus a cursor set only if something else moved the LCD cursor)
+ * instead of rewriting the line. Backspace is one cursor set and one data
+ * write. The last character typed is shown for EDIT_REVEAL_MS and then
+ * masked with a bullet; typing the next character masks it at once, so
+ * only one character is ever readable.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with LCD.h (Rev 1) and LCDGlyph.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef LCDEDIT_H_
+#define LCDEDIT_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "LCD.h"
+#include "LCDGlyph.h"
+#include "SysTick.h"
+#include "../Common/WorkQueue.h"
+
+#define EDIT_REVEAL_MS 700	//time a typed character is shown before masking
+
+void LCD_edit_init();
+void LCD_edit_begin(int line, int col, int max);
+void LCD_edit_end();
+void LCD_edit_put(char c);
+void LCD_edit_back();
+void LCD_edit_mask();
+void LCD_edit_write(int pos, char c);
+void LCD_edit_tick();
+void LCD_edit_mask_work(uint8_t arg);
+
+
+uint8_t editAddr = 0;		//DDRAM address of the first character
+int editMax = 0;			//characters that fit in the field, 0 when inactive
+int editLen = 0;			//characters in the field
+int editShown = -1;			//position of the unmasked character, -1 if none
+volatile uint16_t editReveal = 0;	//ms until the character is masked
+
+
+/*
+ * Function:  LCD_edit_init
+ *  Adds the reveal time tick hook. The system tick must be running.
+ *
+ *  returns:    none
+ */
+void LCD_edit_init(){
+	addTickHook(LCD_edit_tick);
+	return;
+}
+
+/*
+ * Function:  LCD_edit_begin
+ *  Starts an empty field. The cells it covers should already be blank.
+ *
+ *	line	int		LCD line (0 or 1)
+ *	col		int		first column of the field
+ *	max		int		characters in the field
+ *
+ *  returns:    none
+ */
+void LCD_edit_begin(int line, int col, int max){
+	LCD_edit_end();
+	editAddr = ((line == 0) ? LineOneStart : LineTwoStart) + col;
+	editMax = max;
+	editLen = 0;
+	return;
+}
+
+/*
+ * Function:  LCD_edit_end
+ *  Stops the field. A pending mask is dropped, so the screen after the
+ *	field is never written to.
+ *
+ *  returns:    none
+ */
+void LCD_edit_end(){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		editReveal = 0;
+	}
+	editShown = -1;
+	editMax = 0;
+	return;
+}
+
+/*
+ * Function:  LCD_edit_put
+ *  Adds a character to the end of the field. A character is shown until
+ *	the reveal time runs out; '\0' adds a bullet straight away.
+ *
+ *	c		char	character to show, or '\0' for a masked character
+ *
+ *  returns:    none
+ */
+void LCD_edit_put(char c){
+	if(editLen >= editMax){
+		return;
+	}
+	LCD_edit_mask();			//only one character is readable at a time
+	if(c == '\0'){
+		LCD_edit_write(editLen, 0);
+	}
+	else{
+		LCD_edit_write(editLen, c);
+		editShown = editLen;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+			editReveal = EDIT_REVEAL_MS;
+		}
+	}
+	editLen++;
+	return;
+}
+
+/*
+ * Function:  LCD_edit_back
+ *  Removes the last character of the field.
+ *
+ *  returns:    none
+ */
+void LCD_edit_back(){
+	if(editLen == 0){
+		return;
+	}
+	editLen--;
+	if(editShown == editLen){	//removing the readable character
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+			editReveal = 0;
+		}
+		editShown = -1;
+	}
+	LCD_edit_write(editLen, ' ');
+	return;
+}
+
+/*
+ * Function:  LCD_edit_mask
+ *  Replaces the readable character, if there is one, with a bullet.
+ *
+ *  returns:    none
+ */
+void LCD_edit_mask(){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		editReveal = 0;
+	}
+	if(editShown < 0){
+		return;
+	}
+	LCD_edit_write(editShown, 0);
+	editShown = -1;
+	return;
+}
+
+/*
+ * Function:  LCD_edit_write
+ *  Writes one cell of the field. The cursor is only set when the LCD
+ *	cursor is not already there.
+ *
+ *	pos		int		position in the field
+ *	c		char	character to write, 0 for a bullet
+ *
+ *  returns:    none
+ */
+void LCD_edit_write(int pos, char c){
+	uint8_t addr = editAddr + pos;
+	int bullet;
+
+	if(c == 0){
+		bullet = LCD_glyph_get(GLYPH_BULLET);	//may upload, keeps the cursor
+		c = (bullet == -1) ? '*' : bullet;		//'*' if no CGRAM slot is free
+	}
+	if(LCDCursor != addr){
+		LCD_write_instruction(LCD_4bit_cursorSET | addr);
+	}
+	LCD_write_char(c);
+	return;
+}
+
+/*
+ * Function:  LCD_edit_tick
+ *  Tick hook. Counts down the reveal time and posts the mask to the work
+ *	queue when it runs out.
+ *
+ *  returns:    none
+ */
+void LCD_edit_tick(){
+	if((editReveal != 0) && (--editReveal == 0)){
+		work_post(WORK_NORMAL, LCD_edit_mask_work, 0);
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_edit_mask_work
+ *  Work queue item. Masks the readable character if the field is still
+ *	active and no newer character has restarted the reveal time.
+ *
+ *	arg		uint8_t		unused
+ *
+ *  returns:    none
+ */
+void LCD_edit_mask_work(uint8_t arg){
+	if((editMax != 0) && (editReveal == 0)){
+		LCD_edit_mask();
+	}
+	return;
+}
+
+#endif /* LCDEDIT_H_ */
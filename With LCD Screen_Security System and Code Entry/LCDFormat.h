@@ -0,0 +1,271 @@
+/*
+ * LCDFormat.h
+ *
+ * Header file to compose LCD text from segments (flash strings, digits,
+ * masked digits, numbers, glyphs) directly into a line framebuffer. Every
+ * segment is bounded by the line length so text can never overrun a buffer,
+ * and string literals are checked against the line length at compile time.
+ * Only characters that differ from the screen are sent to the LCD.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with LCD.h (Rev 1) and LCDGlyph.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef LCDFORMAT_H_
+#define LCDFORMAT_H_
+
+#include <avr/pgmspace.h>
+#include "LCD.h"
+#include "LCDGlyph.h"
+
+void LCD_fmt_begin(int line);
+void LCD_fmt_begin_buf(char* buf, int size);
+void LCD_fmt_begin_at(int line, int col);
+void LCD_fmt_char(char c);
+void LCD_fmt_P(const char* str);
+void LCD_fmt_digit(int d);
+void LCD_fmt_digits(int digits[], int n);
+void LCD_fmt_mask(int n);
+void LCD_fmt_num(unsigned int n);
+void LCD_fmt_glyph(int glyph);
+void LCD_fmt_at(int col);
+void LCD_fmt_end();
+void LCD_flush_line(int line);
+
+/*
+ * Macro:  LCD_FMT_STR
+ *  Adds a string literal (stored in flash) to the text being composed. Fails
+ *	to compile if the literal is longer than an LCD line.
+ */
+#define LCD_FMT_STR(s) do{ \
+	_Static_assert(sizeof(s) - 1 <= LCD_LineLength, \
+		"LCD_FMT_STR: text is longer than an LCD line"); \
+	LCD_fmt_P(PSTR(s)); \
+}while(0)
+
+char LCDFrame[2][LCD_LineLength];	//text to show on each line of the LCD
+
+char* fmtBuf;		//buffer text is being composed into
+int fmtSize = 0;	//characters that fit in fmtBuf
+int fmtCol = 0;		//next position in fmtBuf
+int fmtLine = -1;	//LCD line being composed, -1 for a plain buffer
+
+/*
+ * Function:  LCD_fmt_begin
+ *  Starts composing the text for one line of the LCD.
+ *
+ *	line	int		LCD line (0 or 1)
+ *
+ *  returns:    none
+ */
+void LCD_fmt_begin(int line){
+	fmtLine = line & 0x01;
+	fmtBuf = LCDFrame[fmtLine];
+	fmtSize = LCD_LineLength;
+	fmtCol = 0;
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_begin_at
+ *  Starts composing the end of a line from col, keeping what is on the 
+ *	screen before it (e.g. a countdown next to text written by other code).
+ *
+ *	line	int		LCD line (0 or 1)
+ *	col		int		first column to compose
+ *
+ *  returns:    none
+ */
+void LCD_fmt_begin_at(int line, int col){
+	LCD_fmt_begin(line);
+	memcpy(LCDFrame[fmtLine], LCDShadow[fmtLine], LCD_LineLength);
+	fmtCol = col;
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_begin_buf
+ *  Starts composing text into a plain string buffer instead of the LCD, e.g.
+ *	for scrolling text that is longer than a line.
+ *
+ *	buf		char*	buffer to compose into
+ *	size	int		size of buf including the null terminator
+ *
+ *  returns:    none
+ */
+void LCD_fmt_begin_buf(char* buf, int size){
+	fmtLine = -1;
+	fmtBuf = buf;
+	fmtSize = size - 1;	//leave room for null terminator
+	fmtCol = 0;
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_char
+ *  Adds a character. Characters past the end of the line are dropped.
+ *
+ *	c	char	character to add
+ *
+ *  returns:    none
+ */
+void LCD_fmt_char(char c){
+	if(fmtCol < fmtSize){
+		fmtBuf[fmtCol++] = c;
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_P
+ *  Adds a string stored in flash. Use LCD_FMT_STR for string literals.
+ *
+ *	str		const char*	string in flash (PSTR)
+ *
+ *  returns:    none
+ */
+void LCD_fmt_P(const char* str){
+	char c;
+	while((c = pgm_read_byte(str++)) != '\0'){
+		LCD_fmt_char(c);
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_digit
+ *  Adds a single digit (0 - 9).
+ *
+ *	d	int		digit to add
+ *
+ *  returns:    none
+ */
+void LCD_fmt_digit(int d){
+	LCD_fmt_char(d + '0');
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_digits
+ *  Adds a digit array, e.g. a PIN.
+ *
+ *	digits	int[]	digits to add
+ *	n		int		number of digits
+ *
+ *  returns:    none
+ */
+void LCD_fmt_digits(int digits[], int n){
+	for(int i = 0; i < n; i++){
+		LCD_fmt_digit(digits[i]);
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_mask
+ *  Adds masked digits ('*') in place of a PIN.
+ *
+ *	n	int		number of digits to mask
+ *
+ *  returns:    none
+ */
+void LCD_fmt_mask(int n){
+	for(int i = 0; i < n; i++){
+		LCD_fmt_char('*');
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_num
+ *  Adds an unsigned number in decimal without leading zeros.
+ *
+ *	n	unsigned int	number to add
+ *
+ *  returns:    none
+ */
+void LCD_fmt_num(unsigned int n){
+	unsigned int div = 10000;	//largest power of 10 for 16 bits
+	
+	while((div > 1) && (div > n)){	//skip leading zeros
+		div /= 10;
+	}
+	while(div > 0){
+		LCD_fmt_digit((n / div) % 10);
+		div /= 10;
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_glyph
+ *  Adds a custom character. A space is added if the glyph can't be loaded.
+ *
+ *	glyph	int		glyph ID from LCDGlyph.h
+ *
+ *  returns:    none
+ */
+void LCD_fmt_glyph(int glyph){
+	int c = LCD_glyph_get(glyph);
+	LCD_fmt_char((c == -1) ? ' ' : c);
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_at
+ *  Pads with spaces up to a column so the next segment starts there.
+ *
+ *	col		int		column for the next segment
+ *
+ *  returns:    none
+ */
+void LCD_fmt_at(int col){
+	while((fmtCol < col) && (fmtCol < fmtSize)){
+		fmtBuf[fmtCol++] = ' ';
+	}
+	return;
+}
+
+/*
+ * Function:  LCD_fmt_end
+ *  Finishes the text. LCD lines are padded with spaces and the changed 
+ *	characters are written to the LCD. Plain buffers are null terminated.
+ *
+ *  returns:    none
+ */
+void LCD_fmt_end(){
+	if(fmtLine == -1){
+		fmtBuf[fmtCol] = '\0';
+		return;
+	}
+	LCD_fmt_at(LCD_LineLength);
+	LCD_flush_line(fmtLine);
+	return;
+}
+
+/*
+ * Function:  LCD_flush_line
+ *  Writes the characters in a framebuffer line that differ from what is on
+ *	the LCD. The cursor is only moved when the changed characters are not 
+ *	next to each other.
+ *
+ *	line	int		LCD line (0 or 1)
+ *
+ *  returns:    none
+ */
+void LCD_flush_line(int line){
+	uint8_t addr = (line == 0) ? LineOneStart : LineTwoStart;
+	
+	for(int col = 0; col < LCD_LineLength; col++, addr++){
+		if(LCDFrame[line][col] == LCDShadow[line][col]){
+			continue;		//already on the screen
+		}
+		if(LCDCursor != addr){
+			LCD_write_instruction(LCD_4bit_cursorSET | addr);
+		}
+		LCD_write_char(LCDFrame[line][col]);
+	}
+	return;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * LCDGlyph.h
+ *
+ * Header file to show custom characters (icons) on the LCD screen.
+ * The KS0066U only has 8 CGRAM slots and reprogramming one costs 9 bus 
+ * writes, so glyph bitmaps are kept in flash and only uploaded to a slot when
+ * the glyph is not already loaded (least recently used slot is replaced).
+ * A slot is never replaced while one of its characters is on the screen.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with LCD.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef LCDGLYPH_H_
+#define LCDGLYPH_H_
+
+#include <avr/pgmspace.h>
+#include "LCD.h"
+
+void LCD_glyph_init();
+int LCD_glyph_get(int glyph);
+int LCD_glyph_write(int glyph, int line, int col);
+int LCD_glyph_on_screen(int slot);
+void LCD_glyph_upload(int glyph, int slot);
+
+//glyph IDs
+#define GLYPH_LOCKED	0	//padlock closed (armed)
+#define GLYPH_UNLOCKED	1	//padlock open (disarmed)
+#define GLYPH_BELL		2	//zone bell
+#define GLYPH_BATTERY	3	//battery
+#define GLYPH_BULLET	4	//masked PIN digit
+#define GLYPH_BAR1		5	//progress bar segments, 1 - 5 columns filled
+#define GLYPH_BAR2		6
+#define GLYPH_BAR3		7
+#define GLYPH_BAR4		8
+#define GLYPH_BAR5		9
+#define GLYPH_COUNT		10
+
+#define GLYPH_SLOTS		8	//CGRAM slots in the LCD controller
+#define GLYPH_CHAR		0x08	//character codes 8 - 15 mirror slots 0 - 7
+					//so glyphs can be placed in strings
+
+//5 x 8 bitmaps for each glyph, one row per byte
+const uint8_t glyphBitmaps[GLYPH_COUNT][8] PROGMEM = {
+	{0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00},	//locked
+	{0x0E, 0x10, 0x10, 0x1F, 0x1B, 0x1B, 0x1F, 0x00},	//unlocked
+	{0x04, 0x0E, 0x0E, 0x0E, 0x1F, 0x00, 0x04, 0x00},	//bell
+	{0x0E, 0x1B, 0x11, 0x11, 0x1F, 0x1F, 0x1F, 0x00},	//battery
+	{0x00, 0x00, 0x0E, 0x0E, 0x0E, 0x00, 0x00, 0x00},	//bullet
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00},	//bar 1
+	{0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00},	//bar 2
+	{0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x00},	//bar 3
+	{0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x00},	//bar 4
+	{0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x00}	//bar 5
+};
+
+int glyphSlot[GLYPH_SLOTS];	//glyph loaded in each CGRAM slot (-1 if empty)
+int glyphLRU[GLYPH_SLOTS];	//CGRAM slots from most to least recently used
+unsigned int glyphHits = 0;	//glyph was already loaded in CGRAM
+unsigned int glyphMisses = 0;	//glyph had to be uploaded to CGRAM
+
+/*
+ * Function:  LCD_glyph_init
+ *  Marks all CGRAM slots as empty and resets the hit and miss counters.
+ *
+ *  returns:    none
+ */
+void LCD_glyph_init(){
+	for(int i = 0; i < GLYPH_SLOTS; i++){
+		glyphSlot[i] = -1;	//nothing loaded
+		glyphLRU[i] = i;
+	}
+	glyphHits = 0;
+	glyphMisses = 0;
+	return;
+}
+
+/*
+ * Function:  LCD_glyph_get
+ *  Gets the character code for a glyph. Uploads the glyph bitmap to the least
+ *	recently used CGRAM slot that is not shown on the screen if the glyph is 
+ *	not loaded.
+ *
+ *	glyph	int		glyph ID
+ *
+ *  returns:    int		character code (8 - 15) to write to the LCD
+ *				-1		invalid glyph or every slot is on the screen
+ */
+int LCD_glyph_get(int glyph){
+	int pos;		//position of the slot in glyphLRU
+	int slot = -1;	//CGRAM slot for the glyph
+	
+	if((glyph < 0) || (glyph >= GLYPH_COUNT)){	//invalid glyph
+		return -1;
+	}
+	
+	//look for the glyph in CGRAM
+	for(pos = 0; pos < GLYPH_SLOTS; pos++){
+		if(glyphSlot[glyphLRU[pos]] == glyph){
+			slot = glyphLRU[pos];
+			glyphHits++;
+			break;
+		}
+	}
+	
+	//miss, replace the least recently used slot that is not on the screen
+	if(slot == -1){
+		for(pos = GLYPH_SLOTS - 1; pos >= 0; pos--){
+			if(!LCD_glyph_on_screen(glyphLRU[pos])){
+				slot = glyphLRU[pos];
+				break;
+			}
+		}
+		if(slot == -1){		//all slots are visible, nothing can be replaced
+			return -1;
+		}
+		LCD_glyph_upload(glyph, slot);
+		glyphMisses++;
+	}
+	
+	//move slot to the front of the LRU list
+	for(; pos > 0; pos--){
+		glyphLRU[pos] = glyphLRU[pos - 1];
+	}
+	glyphLRU[0] = slot;
+	
+	return slot | GLYPH_CHAR;
+}
+
+/*
+ * Function:  LCD_glyph_write
+ *  Writes a glyph to a cell of the LCD screen.
+ *
+ *	glyph	int		glyph ID
+ *	line	int		LCD line (0 or 1)
+ *	col		int		LCD column (0 - 15)
+ *
+ *  returns:    0	glyph was written
+ *				-1	glyph could not be loaded
+ */
+int LCD_glyph_write(int glyph, int line, int col){
+	int c = LCD_glyph_get(glyph);	//character code for glyph
+	
+	if(c == -1){
+		return -1;
+	}
+	
+	LCD_write_instruction(LCD_4bit_cursorSET | 
+		((line == 0) ? LineOneStart : LineTwoStart) | col);
+	LCD_write_char(c);
+	return 0;
+}
+
+/*
+ * Function:  LCD_glyph_on_screen
+ *  Checks if a character from a CGRAM slot is shown on the screen.
+ *
+ *	slot	int		CGRAM slot
+ *
+ *  returns:    1	slot is referenced by a visible cell
+ *				0	slot is not on the screen
+ */
+int LCD_glyph_on_screen(int slot){
+	for(int line = 0; line < 2; line++){
+		for(int col = 0; col < LCD_LineLength; col++){
+			//codes 0 - 7 and 8 - 15 both show the slot
+			if((uint8_t)LCDShadow[line][col] < 16 && 
+			   (LCDShadow[line][col] & 0x07) == slot){
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * Function:  LCD_glyph_upload
+ *  Writes a glyph bitmap from flash to a CGRAM slot (1 address write and 8
+ *	data writes), then points the LCD back at the previous screen position.
+ *
+ *	glyph	int		glyph ID
+ *	slot	int		CGRAM slot
+ *
+ *  returns:    none
+ */
+void LCD_glyph_upload(int glyph, int slot){
+	LCD_BUS_SCOPE(LCD_CTX_GLYPH);
+	uint8_t cursor = LCDCursor;	//screen position to return to
+	
+	LCD_write_instruction(LCD_4bit_cgramSET | (slot << 3));
+	for(int row = 0; row < 8; row++){
+		LCD_write_char(pgm_read_byte(&glyphBitmaps[glyph][row]));
+	}
+	LCD_write_instruction(LCD_4bit_cursorSET | cursor);
+	
+	glyphSlot[slot] = glyph;
+	return;
+}
+
+#endif
@@ -13,11 +13,15 @@
 
 #include <string.h>
 #include "LCD.h"
+#include "../Common/WorkQueue.h"
+#include "../Common/Probe.h"
 
 void initScrollStr();
 void updateScrollStr();
+void scrollWork(uint8_t arg);
 void startScrollStr(char str[]);
 void stopScrollStr();
+int scrollActive();
 
 
 char scrollStr[38];		//string for scrolling text
@@ -25,18 +29,21 @@ int scrollCounter = 0;	//counter for scrolling text
 
 /*
  * ISR(TIMER3_OVF_vect)
- *  ISR to call a function to update the LCD with the next segment of the 
- *	scrolling text and update the scroll counter. Sets timer 3 so the ISR 
- *	repeats in 500 ms.
+ *  ISR to post the next step of the scrolling text to the work queue, so 
+ *	the LCD is written from the main loop. Sets timer 3 so the ISR repeats
+ *	in 500 ms.
  *
  *  returns:    none
  */
 ISR(TIMER3_OVF_vect){
+	PROBE_SCOPE(PROBE_ISR_SCROLL);
+	WORK_ISR_BEGIN();
 	//update scrolling text and increment scroll counter
-	updateScrollStr();
+	work_post(WORK_LOW, scrollWork, 0);
 	
 	//set timer 3 to overflow in 500 ms
 	TCNT3 = 65536 - (int)((500 * 16000000.0) / 256.0);
+	WORK_ISR_END();
 }
 
 /*
@@ -62,6 +69,8 @@ void initScrollStr(){
  *  returns:    none
  */
 void updateScrollStr(){
+	PROBE_SCOPE(PROBE_SCROLL);
+	LCD_BUS_SCOPE(LCD_CTX_SCROLL);
 	char message[17];
 	int line;
 	line = 0;		//top line of LCD
@@ -91,6 +100,22 @@ void updateScrollStr(){
 	return;
 }
 
+/*
+ * Function:  scrollWork
+ *  Work queue item. Scrolls the text one step unless scrolling was stopped
+ *	after the step was posted.
+ *
+ *	arg		uint8_t		unused
+ *
+ *  returns:    none
+ */
+void scrollWork(uint8_t arg){
+	if(scrollActive()){
+		updateScrollStr();
+	}
+	return;
+}
+
 /*
  * Function:  startScrollStr
  *  Sets the string to be scrolled on the LCD screen, starts timer 3 and makes
@@ -100,7 +125,9 @@ void updateScrollStr(){
  *  returns:    none
  */
 void startScrollStr(char str[]){
-	strcpy(scrollStr, str);	//set scrolling text
+	if(str != scrollStr){		//text may already be composed in scrollStr
+		strcpy(scrollStr, str);	//set scrolling text
+	}
 	
 	TCCR3B = (1<<CS32);		//start timer 3 with 256 prescaler
 	
@@ -122,8 +149,19 @@ void stopScrollStr(){
 	TCCR3B &= !((1<<CS32)|(1<<CS31)|(1<<CS30));
 	
 	scrollCounter = 0;		//reset counter
-	_delay_ms(10);			//short delay
 	return;
 }
 
+/*
+ * Function:  scrollActive
+ *  Checks if text is scrolling. Scrolling owns the top line, so other
+ *	writers should wait until it is stopped.
+ *
+ *  returns:    1 text is scrolling
+ *		0 timer 3 is stopped
+ */
+int scrollActive(){
+	return (TCCR3B & ((1<<CS32)|(1<<CS31)|(1<<CS30))) != 0;
+}
+
 #endif
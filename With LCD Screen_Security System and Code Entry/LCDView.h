@@ -0,0 +1,190 @@
+/*
+ * LCDView.h
+ *
+ * Header file for the LCD driver of the render model (Display.h). Draws
+ * each view on the 16x2 LCD with LCDFormat.h, so only changed characters
+ * are sent. Error messages blink in the background (LCDBlink.h) and the
+ * setup and PIN confirmation messages scroll (LCDScroll.h).
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with LCD.h (Rev 1) by Jace Johnson
+ */
+
+#ifndef LCDVIEW_H_
+#define LCDVIEW_H_
+
+#include "../Common/Display.h"
+#include "../Common/AlarmCore.h"
+#include "LCDFormat.h"
+#include "LCDGlyph.h"
+#include "LCDScroll.h"
+#include "LCDBlink.h"
+#include "LCDEdit.h"
+#include "Keypad.h"
+
+void lcd_render(const DisplayModel* m);
+void lcd_render_countdown(const DisplayModel* m);
+void lcd_render_entry(const DisplayModel* m);
+
+_Static_assert(LCD_CTX_VIEWS == VIEW_COUNT,
+	"LCDView.h: one LCD bus context per view");
+
+char lcdErrorMsg[3][17] = {	//VIEW_ERROR messages, by DISP_ERR_ value
+	"Error",
+	"System not armed",
+	"Wrong PIN"
+};
+
+
+/*
+ * Function:  lcd_render
+ *  Draws a view of the render model on the LCD
+ *
+ *  m		const DisplayModel*	render model
+ *
+ *  returns:    none
+ */
+void lcd_render(const DisplayModel* m){
+	LCD_BUS_SCOPE(LCD_CTX_VIEW + m->view);
+	if((m->view != VIEW_ENTER_CODE) && (m->view != VIEW_ENTER_PIN)){
+		LCD_edit_end();			//PIN entry is over
+	}
+	if((m->view != VIEW_SETUP) && (m->view != VIEW_PIN) && scrollActive()){
+		stopScrollStr();		//scrolling message is over
+	}
+	switch(m->view){
+		case VIEW_SETUP:			//scrolling startup message
+			startScrollStr("System Setup    ");
+			break;
+		case VIEW_IDLE:				//menu of alarm system options
+			LCD_fmt_begin(0);
+			LCD_FMT_STR("A:Arm  D:Disarm");
+			LCD_fmt_end();
+			LCD_fmt_begin(1);
+			if(m->value){			//leave room for the exit/entry countdown
+				LCD_FMT_STR("C:PIN");
+			}
+			else{
+				LCD_FMT_STR("C:Change Pin Num");
+			}
+			LCD_fmt_end();
+			break;
+		case VIEW_ENTER_CODE:
+		case VIEW_ENTER_PIN:		//prompt, then one bullet per digit
+			if(m->value == 0){		//new entry, or all digits deleted
+				LCD_fmt_begin(0);
+				LCD_FMT_STR("Enter PIN:");
+				LCD_fmt_end();
+				LCD_fmt_begin(1);	//clear bottom line
+				LCD_fmt_end();
+				LCD_edit_begin(1, 0, LCD_LineLength);
+			}
+			lcd_render_entry(m);
+			break;
+		case VIEW_PIN:				//scrolling PIN and confirm options
+			LCD_fmt_begin_buf(scrollStr, sizeof(scrollStr));
+			LCD_FMT_STR("You entered: ");
+			LCD_fmt_digits(newPIN, PIN_LENGTH);
+			LCD_FMT_STR("  ");
+			LCD_fmt_end();
+			startScrollStr(scrollStr);
+			LCD_fmt_begin(1);
+			LCD_FMT_STR("1=OK, 2=New Pin");
+			LCD_fmt_end();
+			break;
+		case VIEW_ARMED:
+			LCD_fmt_begin(0);
+			LCD_FMT_STR("System Armed");
+			LCD_fmt_at(15);
+			LCD_fmt_glyph(GLYPH_LOCKED);	//armed padlock icon
+			LCD_fmt_end();
+			LCD_fmt_begin(1);		//clear bottom line
+			LCD_fmt_end();
+			break;
+		case VIEW_DISARMED:
+			LCD_fmt_begin(0);
+			LCD_FMT_STR("Success");
+			LCD_fmt_at(15);
+			LCD_fmt_glyph(GLYPH_UNLOCKED);	//disarmed padlock icon
+			LCD_fmt_end();
+			LCD_fmt_begin(1);		//clear bottom line
+			LCD_fmt_end();
+			break;
+		case VIEW_ERROR:			//blinks for 3 s or until a keypress
+			LCD_blink_start(lcdErrorMsg[m->value], 3, &newKeyInput);
+			break;
+		case VIEW_COUNTDOWN:
+			lcd_render_countdown(m);
+			break;
+		case VIEW_LOCKOUT:
+			LCD_fmt_begin(0);
+			LCD_FMT_STR("Locked out");
+			LCD_fmt_end();
+			LCD_fmt_begin(1);
+			LCD_FMT_STR("Retry in ");
+			LCD_fmt_num(m->value);
+			LCD_FMT_STR(" s");
+			LCD_fmt_end();
+			break;
+	}
+	return;
+}
+
+/*
+ * Function:  lcd_render_entry
+ *  Brings the PIN entry field up to the number of digits in the render
+ *  model. Only the cells that change are written: a new digit is shown
+ *  for a moment and then masked, a removed one is blanked. Digits past
+ *  PIN_LENGTH are not stored, so they are masked straight away.
+ *
+ *  m		const DisplayModel*	render model (VIEW_ENTER_CODE or _PIN)
+ *
+ *  returns:    none
+ */
+void lcd_render_entry(const DisplayModel* m){
+	const int* code = (m->view == VIEW_ENTER_CODE) ? newPIN : unlockPIN;
+
+	while(editLen > m->value){
+		LCD_edit_back();
+	}
+	while((editLen < m->value) && (editLen < editMax)){
+		if(editLen < PIN_LENGTH){
+			LCD_edit_put('0' + code[editLen]);
+		}
+		else{
+			LCD_edit_put('\0');
+		}
+	}
+	return;
+}
+
+/*
+ * Function:  lcd_render_countdown
+ *  Draws the exit or entry delay on the end of the bottom line, next to the
+ *  short menu, or ALARM once a zone has set off the alarm. A value of 0
+ *  clears it.
+ *
+ *  m		const DisplayModel*	render model
+ *
+ *  returns:    none
+ */
+void lcd_render_countdown(const DisplayModel* m){
+	LCD_fmt_begin_at(1, 7);
+	if(m->value == DISP_COUNTDOWN_ALARM){
+		LCD_fmt_at(11);
+		LCD_FMT_STR("ALARM");
+	}
+	else if(m->value > 0){
+		if(m->entry){
+			LCD_FMT_STR("Entry ");
+		}
+		else{
+			LCD_FMT_STR(" Exit ");
+		}
+		LCD_fmt_num(m->value);
+	}
+	LCD_fmt_end();
+	return;
+}
+
+#endif /* LCDVIEW_H_ */
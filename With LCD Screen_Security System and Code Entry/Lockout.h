@@ -0,0 +1,186 @@
+/*
+ * Lockout.h
+ *
+ * Header file to slow down PIN guessing. Each source (keypad, console, 
+ * Modbus) gets LOCKOUT_FREE wrong PINs, after which every wrong PIN locks
+ * that source for a window that doubles each time. When the wrong PINs from
+ * all sources reach the lockout limit, every source is locked for 
+ * LOCKOUT_FULL_S on each further wrong PIN. A correct PIN clears the 
+ * counters.
+ *
+ * Windows are deadlines on the system tick, so nothing waits for them to 
+ * end. The counters are kept in EEPROM. After a reset the windows they 
+ * call for start again, so a reset never shortens a lockout.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with SysTick.h (Rev 1) and Config.h (Rev 1) by Jace 
+ * Johnson
+ */
+
+#ifndef LOCKOUT_H_
+#define LOCKOUT_H_
+
+#include <avr/eeprom.h>
+#include "SysTick.h"
+#include "Config.h"
+
+#define LOCKOUT_SOURCES 3		//PIN sources with their own counter
+#define LOCKOUT_FREE 3			//wrong PINs per source before backoff
+#define LOCKOUT_BASE_S 2		//first backoff window (s)
+#define LOCKOUT_MAX_S 256		//longest backoff window (s)
+#define LOCKOUT_FULL_S 900		//window for all sources past the limit (s)
+#define LOCKOUT_ADDR 0x060		//counters in EEPROM (between config and log)
+
+void lockout_init(uint8_t limit);
+void lockout_fail(int source);
+void lockout_clear(int source);
+unsigned long lockout_remaining(int source);
+void lockout_start(int source);
+void lockout_save();
+
+uint8_t lockFails[LOCKOUT_SOURCES];			//wrong PINs from each source
+uint8_t lockGlobalFails;					//wrong PINs from all sources
+uint8_t lockLimit;							//global wrong PINs before full lockout
+unsigned long lockUntil[LOCKOUT_SOURCES];	//tick each source is locked until
+unsigned long lockAllUntil;					//tick all sources are locked until
+
+/*
+ * Function:  lockout_init
+ *  Reads the counters from EEPROM and restarts any windows they call for.
+ *
+ *	limit	uint8_t		wrong PINs from all sources before full lockout
+ *
+ *  returns:    none
+ */
+void lockout_init(uint8_t limit){
+	uint8_t b[LOCKOUT_SOURCES + 2];	//counters, global counter, check
+	uint8_t check = 0x5A;
+	
+	lockLimit = limit;
+	eeprom_read_block(b, (uint8_t*)LOCKOUT_ADDR, sizeof(b));
+	for(int i = 0; i < LOCKOUT_SOURCES + 1; i++){
+		check ^= b[i];
+	}
+	if(check != b[LOCKOUT_SOURCES + 1]){	//erased or corrupt, start clean
+		for(int i = 0; i < LOCKOUT_SOURCES + 1; i++){
+			b[i] = 0;
+		}
+	}
+	for(int i = 0; i < LOCKOUT_SOURCES; i++){
+		lockFails[i] = b[i];
+	}
+	lockGlobalFails = b[LOCKOUT_SOURCES];
+	
+	lockAllUntil = getTicks();
+	for(int i = 0; i < LOCKOUT_SOURCES; i++){
+		lockUntil[i] = lockAllUntil;
+		lockout_start(i);
+	}
+	return;
+}
+
+/*
+ * Function:  lockout_fail
+ *  Counts a wrong PIN and starts the window it calls for.
+ *
+ *	source	int		source of the wrong PIN
+ *
+ *  returns:    none
+ */
+void lockout_fail(int source){
+	if(lockFails[source] < 0xFF){
+		lockFails[source]++;
+	}
+	if(lockGlobalFails < 0xFF){
+		lockGlobalFails++;
+	}
+	lockout_start(source);
+	lockout_save();
+	return;
+}
+
+/*
+ * Function:  lockout_clear
+ *  Clears the counters after a correct PIN.
+ *
+ *	source	int		source of the correct PIN
+ *
+ *  returns:    none
+ */
+void lockout_clear(int source){
+	if((lockFails[source] == 0) && (lockGlobalFails == 0)){
+		return;					//nothing to write
+	}
+	lockFails[source] = 0;
+	lockGlobalFails = 0;
+	lockout_save();
+	return;
+}
+
+/*
+ * Function:  lockout_remaining
+ *  Time left before a source may try a PIN again.
+ *
+ *	source	int		PIN source
+ *
+ *  returns:    unsigned long	ms left, 0 if not locked
+ */
+unsigned long lockout_remaining(int source){
+	unsigned long now = getTicks();
+	long left = lockUntil[source] - now;
+	long leftAll = lockAllUntil - now;
+	
+	if(leftAll > left){
+		left = leftAll;
+	}
+	return (left > 0) ? left : 0;
+}
+
+/*
+ * Function:  lockout_start
+ *  Starts the window for the current counters.
+ *
+ *	source	int		source whose window is started
+ *
+ *  returns:    none
+ */
+void lockout_start(int source){
+	unsigned long now = getTicks();
+	unsigned long window;
+	int shift;
+	
+	if(lockFails[source] >= LOCKOUT_FREE){	//doubling window
+		shift = lockFails[source] - LOCKOUT_FREE;
+		window = (shift >= 7) ? LOCKOUT_MAX_S : (LOCKOUT_BASE_S << shift);
+		lockUntil[source] = now + window * 1000;
+	}
+	if((lockLimit > 0) && (lockGlobalFails >= lockLimit)){	//full lockout
+		lockAllUntil = now + LOCKOUT_FULL_S * 1000UL;
+	}
+	return;
+}
+
+/*
+ * Function:  lockout_save
+ *  Writes the counters to EEPROM.
+ *
+ *  returns:    none
+ */
+void lockout_save(){
+	uint8_t b[LOCKOUT_SOURCES + 2];
+	uint8_t check = 0x5A;
+	
+	for(int i = 0; i < LOCKOUT_SOURCES; i++){
+		b[i] = lockFails[i];
+	}
+	b[LOCKOUT_SOURCES] = lockGlobalFails;
+	for(int i = 0; i < LOCKOUT_SOURCES + 1; i++){
+		check ^= b[i];
+	}
+	b[LOCKOUT_SOURCES + 1] = check;
+	config_wait();
+	eeprom_update_block(b, (uint8_t*)LOCKOUT_ADDR, sizeof(b));
+	return;
+}
+
+#endif
@@ -0,0 +1,383 @@
+/*
+ * Modbus.h
+ *
+ * Header file for a Modbus RTU slave on an RS-485 bus for building 
+ * management systems. Uses USART2 and timer 5.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with CRC16.h (Rev 1) by Jace Johnson
+ * Hardware:	ATMega 2560 operating at 16 MHz
+ *				RS-485 transceiver (MAX485 or similar)
+ * Configuration shown below
+ *
+ * ATMega 2560
+ *  PORT   pin		   MAX485
+ * -----------         ----------
+ * | H0    17|---------|RO		|
+ * | H1    16|---------|DI		|
+ * | H2     -|----+----|DE		|
+ * |		 |    +----|RE		|
+ * -----------		   ----------
+ *
+ * A frame ends when the bus has been silent for 3.5 characters. Timer 5 is 
+ * restarted by every received byte and its compare interrupt handles the 
+ * frame, so the reply starts as soon as the silence is detected. The reply
+ * is sent from the transmit interrupts and DE is released when the last 
+ * byte has left the shift register.
+ *
+ * Supported functions: 01 read coils, 03 read holding registers, 04 read 
+ * input registers, 05 write single coil, 06 write single register. The 
+ * application defines modbusReadCoil, modbusWriteCoil, modbusReadHolding,
+ * modbusWriteHolding and modbusReadInput for its register map. They are 
+ * called from interrupt context.
+ */
+
+#ifndef MODBUS_H_
+#define MODBUS_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "CRC16.h"
+#include "../Common/Probe.h"
+
+#ifndef MODBUS_ADDRESS
+#define MODBUS_ADDRESS 1		//slave address of this panel
+#endif
+#ifndef MODBUS_BAUDRATE
+#define MODBUS_BAUDRATE 19200	//bus baud rate (8 data bits, even parity)
+#endif
+
+#define MODBUS_UBRR ((F_CPU + MODBUS_BAUDRATE * 8UL) / (MODBUS_BAUDRATE * 16UL) - 1)
+
+//3.5 character silence (11 bit characters), fixed at 1750 us above 19200 baud
+#if MODBUS_BAUDRATE > 19200
+#define MODBUS_T35_US 1750UL
+#else
+#define MODBUS_T35_US (38500000UL / MODBUS_BAUDRATE)
+#endif
+#define MODBUS_T35_TICKS (MODBUS_T35_US / 4)	//timer 5 ticks (64 prescaler)
+
+#define MODBUS_DE_PIN PH2		//driver enable on PORTH
+#define MODBUS_BUF 64			//max frame size (requests and replies)
+#define MODBUS_REQ_LEN 8		//request size of every supported function
+#define MODBUS_MAX_BITS 2000	//most coils in one read (Modbus spec)
+#define MODBUS_MAX_REGS 125		//most registers in one read (Modbus spec)
+
+//exception codes
+#define MB_ILLEGAL_FUNCTION	0x01
+#define MB_ILLEGAL_ADDRESS	0x02
+#define MB_ILLEGAL_VALUE	0x03
+
+void initModbus();
+void modbus_handle_frame();
+void modbus_reply(int len);
+int modbus_exception(uint8_t code);
+int modbus_read_bits(uint16_t start, uint16_t count);
+int modbus_read_regs(uint16_t start, uint16_t count, int input);
+
+//register map, defined by the application
+int modbusReadCoil(uint16_t addr);
+int modbusWriteCoil(uint16_t addr, int on);
+int modbusReadHolding(uint16_t addr, uint16_t* value);
+int modbusWriteHolding(uint16_t addr, uint16_t value);
+int modbusReadInput(uint16_t addr, uint16_t* value);
+
+uint8_t modbusBuf[MODBUS_BUF];	//frame being received or sent
+volatile int modbusLen = 0;		//bytes received or bytes to send
+volatile int modbusPos = 0;		//next byte to send
+volatile int modbusSending = 0;	//1 while a reply is on the bus
+volatile int modbusOverflow = 0;	//1 if the frame did not fit in modbusBuf
+unsigned int modbusFrames = 0;		//frames handled for this address
+unsigned int modbusCRCErrors = 0;	//frames dropped for a bad CRC
+
+/*
+ * ISR(USART2_RX_vect)
+ *  Stores the received byte and restarts the 3.5 character silence timer.
+ *
+ *  returns:    none
+ */
+ISR(USART2_RX_vect){
+	PROBE_SCOPE(PROBE_ISR_MB_RX);
+	uint8_t status = UCSR2A;	//error flags must be read before the data
+	uint8_t c = UDR2;
+	
+	if(modbusSending){			//ignore bus while replying
+		return;
+	}
+	if(status & ((1<<FE2)|(1<<DOR2)|(1<<UPE2))){	//bad character, drop frame
+		modbusOverflow = 1;
+	}
+	if(modbusLen < MODBUS_BUF){
+		modbusBuf[modbusLen++] = c;
+	}
+	else{
+		modbusOverflow = 1;
+	}
+	
+	TCNT5 = 0;					//restart silence timer
+	TIFR5 = (1<<OCF5A);
+	TCCR5B = (1<<WGM52)|(1<<CS51)|(1<<CS50);	//CTC, 64 prescaler
+}
+
+/*
+ * ISR(TIMER5_COMPA_vect)
+ *  The bus has been silent for 3.5 characters, so the frame is complete.
+ *
+ *  returns:    none
+ */
+ISR(TIMER5_COMPA_vect){
+	PROBE_SCOPE(PROBE_ISR_MB_T35);
+	TCCR5B = 0x00;				//stop silence timer
+	
+	if(!modbusOverflow && (modbusLen >= 4)){
+		modbus_handle_frame();
+	}
+	if(!modbusSending){			//ready for next request
+		modbusLen = 0;
+	}
+	modbusOverflow = 0;
+}
+
+/*
+ * ISR(USART2_UDRE_vect)
+ *  Sends the next byte of the reply. Waits for the transmit complete 
+ *	interrupt after the last byte.
+ *
+ *  returns:    none
+ */
+ISR(USART2_UDRE_vect){
+	PROBE_SCOPE(PROBE_ISR_MB_TX);
+	UDR2 = modbusBuf[modbusPos++];
+	if(modbusPos >= modbusLen){
+		UCSR2B &= ~(1<<UDRIE2);
+		UCSR2A = (1<<TXC2);		//clear old transmit complete flag
+		UCSR2B |= (1<<TXCIE2);
+	}
+}
+
+/*
+ * ISR(USART2_TX_vect)
+ *  Last byte of the reply has been sent, release the bus.
+ *
+ *  returns:    none
+ */
+ISR(USART2_TX_vect){
+	PROBE_SCOPE(PROBE_ISR_MB_TX);
+	UCSR2B &= ~(1<<TXCIE2);
+	PORTH &= ~(1<<MODBUS_DE_PIN);	//receive mode
+	modbusLen = 0;
+	modbusSending = 0;
+}
+
+/*
+ * Function:  initModbus
+ *  Sets up USART2 for Modbus RTU (8 data bits, even parity, 1 stop bit), 
+ *	the driver enable pin, and timer 5 for the silence detector.
+ *
+ *  returns:    none
+ */
+void initModbus(){
+	DDRH |= (1<<MODBUS_DE_PIN);		//DE output, start in receive mode
+	PORTH &= ~(1<<MODBUS_DE_PIN);
+	
+	UBRR2 = MODBUS_UBRR;
+	UCSR2A = 0x00;
+	UCSR2C = (1<<UPM21)|(1<<UCSZ21)|(1<<UCSZ20);	//8E1
+	UCSR2B = (1<<RXEN2)|(1<<TXEN2)|(1<<RXCIE2);
+	
+	TCCR5A = 0x00;
+	TCCR5B = 0x00;					//stopped until a byte is received
+	OCR5A = MODBUS_T35_TICKS;
+	TIMSK5 |= (1<<OCIE5A);
+	return;
+}
+
+/*
+ * Function:  modbus_handle_frame
+ *  Checks the CRC and address of a received frame and builds the reply in
+ *	modbusBuf. A request of a supported function that is not MODBUS_REQ_LEN
+ *	bytes gets an illegal value exception. Broadcasts (address 0) are 
+ *	handled but not answered.
+ *
+ *  returns:    none
+ */
+void modbus_handle_frame(){
+	uint16_t crc;
+	uint16_t start;		//first coil or register
+	uint16_t value;		//count or value to write
+	uint8_t fn;			//function code
+	int len = 0;		//reply length without CRC
+	
+	crc = crc16(modbusBuf, modbusLen - 2);
+	if((modbusBuf[modbusLen - 2] != (crc & 0xFF)) || 
+	   (modbusBuf[modbusLen - 1] != (crc >> 8))){
+		modbusCRCErrors++;
+		return;
+	}
+	if((modbusBuf[0] != MODBUS_ADDRESS) && (modbusBuf[0] != 0)){
+		return;				//frame is for another slave
+	}
+	modbusFrames++;
+	
+	fn = modbusBuf[1];
+	if(modbusLen != MODBUS_REQ_LEN){	//every supported request is 8 bytes
+		if((fn == 0x01) || ((fn >= 0x03) && (fn <= 0x06))){
+			len = modbus_exception(MB_ILLEGAL_VALUE);
+		}
+		else{
+			len = modbus_exception(MB_ILLEGAL_FUNCTION);
+		}
+	}
+	else{
+		start = (modbusBuf[2] << 8) | modbusBuf[3];
+		value = (modbusBuf[4] << 8) | modbusBuf[5];
+		
+		switch(fn){
+			case 0x01:			//read coils
+				len = modbus_read_bits(start, value);
+				break;
+			case 0x03:			//read holding registers
+				len = modbus_read_regs(start, value, 0);
+				break;
+			case 0x04:			//read input registers
+				len = modbus_read_regs(start, value, 1);
+				break;
+			case 0x05:			//write single coil, reply echoes request
+				if((value != 0xFF00) && (value != 0x0000)){
+					len = modbus_exception(MB_ILLEGAL_VALUE);
+				}
+				else if(modbusWriteCoil(start, value == 0xFF00) != 0){
+					len = modbus_exception(MB_ILLEGAL_ADDRESS);
+				}
+				else{
+					len = 6;
+				}
+				break;
+			case 0x06:			//write single register, reply echoes request
+				if(modbusWriteHolding(start, value) != 0){
+					len = modbus_exception(MB_ILLEGAL_ADDRESS);
+				}
+				else{
+					len = 6;
+				}
+				break;
+			default:
+				len = modbus_exception(MB_ILLEGAL_FUNCTION);
+				break;
+		}
+	}
+	
+	if(modbusBuf[0] != 0){	//no reply to broadcasts
+		modbus_reply(len);
+	}
+	return;
+}
+
+/*
+ * Function:  modbus_reply
+ *  Adds the CRC to the reply in modbusBuf and starts sending it.
+ *
+ *	len		int		reply length without CRC
+ *
+ *  returns:    none
+ */
+void modbus_reply(int len){
+	uint16_t crc = crc16(modbusBuf, len);
+	
+	modbusBuf[len++] = crc & 0xFF;
+	modbusBuf[len++] = crc >> 8;
+	modbusLen = len;
+	modbusPos = 0;
+	modbusSending = 1;
+	
+	PORTH |= (1<<MODBUS_DE_PIN);	//drive the bus
+	UCSR2B |= (1<<UDRIE2);			//start sending
+	return;
+}
+
+/*
+ * Function:  modbus_exception
+ *  Builds an exception reply.
+ *
+ *	code	uint8_t		exception code
+ *
+ *  returns:    int		reply length without CRC
+ */
+int modbus_exception(uint8_t code){
+	modbusBuf[1] |= 0x80;
+	modbusBuf[2] = code;
+	return 3;
+}
+
+/*
+ * Function:  modbus_read_bits
+ *  Builds a read coils reply.
+ *
+ *	start	uint16_t	first coil
+ *	count	uint16_t	number of coils
+ *
+ *  returns:    int		reply length without CRC
+ */
+int modbus_read_bits(uint16_t start, uint16_t count){
+	int bytes;
+	int bit;
+	
+	if((count == 0) || (count > MODBUS_MAX_BITS)){	//before count + 7 can wrap
+		return modbus_exception(MB_ILLEGAL_VALUE);
+	}
+	bytes = (count + 7) / 8;
+	if(3 + bytes + 2 > MODBUS_BUF){
+		return modbus_exception(MB_ILLEGAL_VALUE);
+	}
+	for(int i = 0; i < bytes; i++){
+		modbusBuf[3 + i] = 0;
+	}
+	for(uint16_t i = 0; i < count; i++){
+		bit = modbusReadCoil(start + i);
+		if(bit < 0){
+			return modbus_exception(MB_ILLEGAL_ADDRESS);
+		}
+		if(bit){
+			modbusBuf[3 + i / 8] |= (1 << (i % 8));
+		}
+	}
+	modbusBuf[2] = bytes;
+	return 3 + bytes;
+}
+
+/*
+ * Function:  modbus_read_regs
+ *  Builds a read holding or input registers reply.
+ *
+ *	start	uint16_t	first register
+ *	count	uint16_t	number of registers
+ *	input	int			1 for input registers, 0 for holding registers
+ *
+ *  returns:    int		reply length without CRC
+ */
+int modbus_read_regs(uint16_t start, uint16_t count, int input){
+	uint16_t value;
+	int err;
+	
+	if((count == 0) || (count > MODBUS_MAX_REGS) ||	//before count * 2 can wrap
+	   (3 + count * 2 + 2 > MODBUS_BUF)){
+		return modbus_exception(MB_ILLEGAL_VALUE);
+	}
+	for(uint16_t i = 0; i < count; i++){
+		if(input){
+			err = modbusReadInput(start + i, &value);
+		}
+		else{
+			err = modbusReadHolding(start + i, &value);
+		}
+		if(err != 0){
+			return modbus_exception(MB_ILLEGAL_ADDRESS);
+		}
+		modbusBuf[3 + i * 2] = value >> 8;
+		modbusBuf[4 + i * 2] = value & 0xFF;
+	}
+	modbusBuf[2] = count * 2;
+	return 3 + count * 2;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Siren.h
+ *
+ * Header file for a siren and chime on timer 1. The timer runs in CTC mode
+ * and toggles OC1A at each compare match, so the tone itself costs no CPU
+ * time. Patterns are tables of steps in flash. The compare interrupt counts
+ * the half periods of each step and loads the next step when the step time
+ * is up, so a pattern plays to the end (or forever) with no help from the 
+ * main loop.
+ * Author : Jace Johnson
+ * Rev 1
+ * Hardware:	ATMega 2560 operating at 16 MHz
+ *				piezo siren with driver (or speaker with amplifier)
+ * Configuration shown below
+ *
+ * ATMega 2560
+ *  PORT   pin
+ * -----------
+ * | B5 (OC1A) 11|---siren driver
+ * -----------
+ *
+ * Step format (2 bytes)
+ *	note	frequency / 20 Hz (1 - 255 = 20 Hz - 5100 Hz), 0 for silence
+ *	time	step time in 10 ms units, 0 ends the pattern
+ * A step with time 0 and note SIREN_REPEAT starts the pattern again, any 
+ * other note stops the siren.
+ *
+ * Interrupt cost: about 30 cycles for a half period and about 250 cycles to
+ * load a step, so a 1400 Hz tone takes 2800 * 30 = 84000 cycles/s (0.5 % of
+ * the CPU) and delays other interrupts by 2 us at most.
+ */
+
+#ifndef SIREN_H_
+#define SIREN_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+#include "../Common/Probe.h"
+
+#define SIREN_PIN PB5			//OC1A
+#define SIREN_REPEAT 0xFF		//note of a repeat step
+#define SIREN_REST_NOTE 50		//timer rate used for silent steps (1 kHz)
+
+//timer 1 compare value for a note (8 prescaler, toggle on compare match)
+#define SIREN_OCR(note) (((F_CPU / 16) / 20) / (note) - 1)
+
+//pattern step
+typedef struct{
+	uint8_t note;		//frequency / 20 Hz, 0 for silence
+	uint8_t time;		//step time in 10 ms units, 0 ends the pattern
+}SirenStep;
+
+void siren_play(const SirenStep* pattern);
+void siren_stop();
+int siren_active();
+void siren_step();
+
+//burglary alarm: 1 s rising sweep 600 - 1400 Hz, then three 1400 Hz pulses
+const SirenStep sirenAlarm[] PROGMEM = {
+	{30, 10}, {34, 10}, {38, 10}, {42, 10}, {46, 10},
+	{50, 10}, {54, 10}, {58, 10}, {62, 10}, {66, 10},
+	{70, 15}, {0, 15}, {70, 15}, {0, 15}, {70, 15}, {0, 15},
+	{SIREN_REPEAT, 0}
+};
+
+//door chime: two falling tones, played once
+const SirenStep sirenChime[] PROGMEM = {
+	{66, 30},			//1320 Hz
+	{52, 50},			//1040 Hz
+	{0, 0}
+};
+
+const SirenStep* sirenPattern = 0;	//pattern playing, 0 when off
+volatile uint8_t sirenPos = 0;		//next step in sirenPattern
+volatile uint16_t sirenCount = 0;	//compare matches left in this step
+
+/*
+ * ISR(TIMER1_COMPA_vect)
+ *  Counts the half periods of the current step and loads the next step
+ *	when it is done.
+ *
+ *  returns:    none
+ */
+ISR(TIMER1_COMPA_vect){
+	PROBE_SCOPE(PROBE_ISR_SIREN);
+	if(--sirenCount == 0){
+		siren_step();
+	}
+}
+
+/*
+ * Function:  siren_play
+ *  Starts a pattern, replacing any pattern that is playing.
+ *
+ *	pattern		SirenStep*	pattern in flash
+ *
+ *  returns:    none
+ */
+void siren_play(const SirenStep* pattern){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		DDRB |= (1<<SIREN_PIN);
+		sirenPattern = pattern;
+		sirenPos = 0;
+		TCNT1 = 0;
+		TCCR1B = (1<<WGM12)|(1<<CS11);	//CTC, 8 prescaler
+		TIMSK1 |= (1<<OCIE1A);
+		siren_step();
+	}
+	return;
+}
+
+/*
+ * Function:  siren_stop
+ *  Stops the timer and turns the siren output off.
+ *
+ *  returns:    none
+ */
+void siren_stop(){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		TCCR1B = 0x00;
+		TCCR1A = 0x00;					//disconnect OC1A
+		TIMSK1 &= ~(1<<OCIE1A);
+		PORTB &= ~(1<<SIREN_PIN);
+		sirenPattern = 0;
+	}
+	return;
+}
+
+/*
+ * Function:  siren_active
+ *  Checks if a pattern is playing.
+ *
+ *  returns:    1 pattern is playing
+ *		0 siren is off
+ */
+int siren_active(){
+	return sirenPattern != 0;
+}
+
+/*
+ * Function:  siren_step
+ *  Loads the next step of the pattern. Called with interrupts off.
+ *
+ *  returns:    none
+ */
+void siren_step(){
+	uint8_t note = pgm_read_byte(&sirenPattern[sirenPos].note);
+	uint8_t time = pgm_read_byte(&sirenPattern[sirenPos].time);
+	uint16_t count;
+	
+	if(time == 0){					//end of pattern
+		if((note != SIREN_REPEAT) || (sirenPos == 0)){
+			siren_stop();			//keeps interrupts off in the ISR
+			return;
+		}
+		sirenPos = 0;
+		note = pgm_read_byte(&sirenPattern[0].note);
+		time = pgm_read_byte(&sirenPattern[0].time);
+	}
+	sirenPos++;
+	
+	if(note == 0){					//silence, keep counting at 1 kHz
+		TCCR1A = 0x00;
+		PORTB &= ~(1<<SIREN_PIN);
+		note = SIREN_REST_NOTE;
+	}
+	else{
+		TCCR1A = (1<<COM1A0);		//toggle OC1A on compare match
+	}
+	OCR1A = SIREN_OCR(note);
+	
+	count = (uint32_t)time * note * 2 / 5;	//half periods in time * 10 ms
+	sirenCount = (count > 0) ? count : 1;
+	return;
+}
+
+#endif
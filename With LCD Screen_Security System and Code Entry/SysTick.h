@@ -0,0 +1,124 @@
+/*
+ * SysTick.h
+ *
+ * Header file for a 1 ms system tick. Counts milliseconds since reset and 
+ * calls registered tick hooks from the timer interrupt.
+ * Uses timer 0.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "../Common/WorkQueue.h"
+#include "../Common/Probe.h"
+
+void initSysTick();
+int addTickHook(void (*hook)(void));
+void removeTickHook(void (*hook)(void));
+unsigned long getTicks();
+
+#define TICK_HOOKS 8	//max number of tick hooks
+
+volatile unsigned long sysTicks = 0;		//ms since reset
+void (*tickHooks[TICK_HOOKS])(void);	//functions called every tick
+
+/*
+ * ISR(TIMER0_COMPA_vect)
+ *  Runs every 1 ms. Increments the tick counter and calls each tick hook.
+ *	Tick hooks run in interrupt context and must be short, longer work is
+ *	posted to the work queue. The time taken is kept in the work queue
+ *	statistics.
+ *
+ *  returns:    none
+ */
+ISR(TIMER0_COMPA_vect){
+	PROBE_SCOPE(PROBE_ISR_TICK);
+	WORK_ISR_BEGIN();
+	sysTicks++;
+	
+	for(int i = 0; i < TICK_HOOKS; i++){
+		if(tickHooks[i] != 0){
+			tickHooks[i]();
+		}
+	}
+	WORK_ISR_END();
+}
+
+/*
+ * Function:  initSysTick
+ *  Sets up timer 0 in CTC mode to interrupt every 1 ms (16 MHz / 64 / 250).
+ *	Global interrupts must be enabled separately.
+ *
+ *  returns:    none
+ */
+void initSysTick(){
+	TCCR0A = (1<<WGM01);			//CTC mode, TOP = OCR0A
+	TCCR0B = (1<<CS01)|(1<<CS00);	//64 prescaler
+	OCR0A = 249;					//250 counts per ms
+	TCNT0 = 0;
+	TIMSK0 |= (1<<OCIE0A);			//enable compare A interrupt
+	return;
+}
+
+/*
+ * Function:  addTickHook
+ *  Adds a function to be called every 1 ms from the tick interrupt.
+ *
+ *	hook	void(*)(void)	function to call
+ *
+ *  returns:	0	hook added
+ *				-1	no free hook slots
+ */
+int addTickHook(void (*hook)(void)){
+	for(int i = 0; i < TICK_HOOKS; i++){
+		if(tickHooks[i] == 0){
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+				tickHooks[i] = hook;
+			}
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Function:  removeTickHook
+ *  Stops a function from being called from the tick interrupt.
+ *
+ *	hook	void(*)(void)	function to remove
+ *
+ *  returns:    none
+ */
+void removeTickHook(void (*hook)(void)){
+	uint8_t sreg = SREG;	//save interrupt state
+	cli();
+	for(int i = 0; i < TICK_HOOKS; i++){
+		if(tickHooks[i] == hook){
+			tickHooks[i] = 0;
+		}
+	}
+	SREG = sreg;			//restore interrupt state
+	return;
+}
+
+/*
+ * Function:  getTicks
+ *  Reads the tick counter without being interrupted part way through.
+ *
+ *  returns:    unsigned long	ms since reset
+ */
+unsigned long getTicks(){
+	unsigned long t;
+	uint8_t sreg = SREG;	//save interrupt state
+	cli();
+	t = sysTicks;
+	SREG = sreg;			//restore interrupt state
+	return t;
+}
+
+#endif
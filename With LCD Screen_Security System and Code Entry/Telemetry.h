@@ -0,0 +1,208 @@
+/*
+ * Telemetry.h
+ *
+ * Header file to send machine readable events over USART0 for a monitoring
+ * station. Events are sent as binary frames that are encoded straight into 
+ * the USART0 transmit buffer, so no frame buffer is needed.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with USART0.h (Rev 1) and CRC16.h (Rev 1) by Jace Johnson
+ *
+ * Frame format (before COBS encoding)
+ *	byte 0		event type (TEL_ defines below)
+ *	byte 1		sequence number, increments for each frame (gaps mean frames 
+ *				were lost)
+ *	bytes 2..n	payload for the event type, multi byte values are little 
+ *				endian
+ *	last 2		CRC-16/MODBUS (poly 0xA001, init 0xFFFF) of bytes 0..n, low
+ *				byte first
+ *
+ * The frame is COBS (consistent overhead byte stuffing) encoded so it has no
+ * 0x00 bytes and is followed by a 0x00 delimiter. A decoder reads up to each
+ * 0x00, COBS decodes, and drops the frame if the CRC does not match (this 
+ * also drops any plain text printed to USART0 between frames).
+ *
+ * Payloads
+ *	TEL_BOOT		uint16 boot time ms
+ *	TEL_KEYPRESS	uint8 key (0 - 9, 0xA - 0xD, 0xE = #, 0xF = *)
+ *	TEL_ARM			none
+ *	TEL_DISARM		none
+ *	TEL_WRONG_PIN	none
+ *	TEL_ZONE_TRIP	uint8 zone
+ *	TEL_STATS		uint32 uptime ms, uint16 boot time ms, uint16 glyph cache
+ *					hits, uint16 glyph cache misses
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "CRC16.h"
+#include "USART0.h"
+
+void tel_begin(uint8_t type);
+void tel_put(uint8_t b);
+void tel_put16(uint16_t w);
+void tel_put32(uint32_t d);
+void tel_end();
+void tel_cobs_put(uint8_t b);
+void tel_event(uint8_t type);
+void tel_event8(uint8_t type, uint8_t value);
+
+//event types
+#define TEL_BOOT		0x01
+#define TEL_KEYPRESS	0x02
+#define TEL_ARM			0x03
+#define TEL_DISARM		0x04
+#define TEL_WRONG_PIN	0x05
+#define TEL_ZONE_TRIP	0x06
+#define TEL_STATS		0x07
+
+uint8_t telSeq = 0;		//sequence number of next frame
+uint16_t telCRC;		//CRC of the frame so far
+uint8_t telPos;			//next position in txBuf for the frame
+uint8_t telCodePos;		//position of the current COBS code byte
+uint8_t telCode;		//current COBS code (distance to next zero)
+
+/*
+ * Function:  tel_begin
+ *  Starts a frame in the transmit buffer. Bytes are not transmitted until 
+ *	tel_end is called, so the COBS code bytes can be filled in as the frame
+ *	is encoded.
+ *
+ *	type	uint8_t		event type
+ *
+ *  returns:    none
+ */
+void tel_begin(uint8_t type){
+	telPos = txHead;
+	telCodePos = telPos;		//reserve first code byte
+	USART0_tx_wait(telPos);
+	telPos = (telPos + 1) & TX_MASK;
+	telCode = 1;
+	telCRC = CRC16_INIT;
+	
+	tel_put(type);
+	tel_put(telSeq++);
+	return;
+}
+
+/*
+ * Function:  tel_put
+ *  Adds a payload byte to the frame.
+ *
+ *	b	uint8_t		byte to add
+ *
+ *  returns:    none
+ */
+void tel_put(uint8_t b){
+	telCRC = crc16_update(telCRC, b);
+	tel_cobs_put(b);
+	return;
+}
+
+/*
+ * Function:  tel_put16
+ *  Adds a 16 bit payload value to the frame (little endian).
+ *
+ *	w	uint16_t	value to add
+ *
+ *  returns:    none
+ */
+void tel_put16(uint16_t w){
+	tel_put(w & 0xFF);
+	tel_put(w >> 8);
+	return;
+}
+
+/*
+ * Function:  tel_put32
+ *  Adds a 32 bit payload value to the frame (little endian).
+ *
+ *	d	uint32_t	value to add
+ *
+ *  returns:    none
+ */
+void tel_put32(uint32_t d){
+	tel_put16(d & 0xFFFF);
+	tel_put16(d >> 16);
+	return;
+}
+
+/*
+ * Function:  tel_end
+ *  Adds the CRC, finishes the COBS encoding, adds the 0x00 delimiter and 
+ *	starts transmitting the frame.
+ *
+ *  returns:    none
+ */
+void tel_end(){
+	uint16_t crc = telCRC;
+	
+	tel_cobs_put(crc & 0xFF);
+	tel_cobs_put(crc >> 8);
+	txBuf[telCodePos] = telCode;	//fill in last code byte
+	
+	USART0_tx_wait(telPos);			//frame delimiter
+	txBuf[telPos] = 0x00;
+	USART0_tx_publish((telPos + 1) & TX_MASK);
+	return;
+}
+
+/*
+ * Function:  tel_cobs_put
+ *  COBS encodes a byte into the frame. A zero byte (or a run of 254 non zero
+ *	bytes) closes the current block by filling in its code byte and reserves
+ *	the code byte for the next block.
+ *
+ *	b	uint8_t		byte to encode
+ *
+ *  returns:    none
+ */
+void tel_cobs_put(uint8_t b){
+	if(b != 0){
+		USART0_tx_wait(telPos);
+		txBuf[telPos] = b;
+		telPos = (telPos + 1) & TX_MASK;
+		telCode++;
+	}
+	if((b == 0) || (telCode == 0xFF)){
+		txBuf[telCodePos] = telCode;	//close block
+		USART0_tx_wait(telPos);
+		telCodePos = telPos;			//reserve next code byte
+		telPos = (telPos + 1) & TX_MASK;
+		telCode = 1;
+	}
+	return;
+}
+
+/*
+ * Function:  tel_event
+ *  Sends an event with no payload.
+ *
+ *	type	uint8_t		event type
+ *
+ *  returns:    none
+ */
+void tel_event(uint8_t type){
+	tel_begin(type);
+	tel_end();
+	return;
+}
+
+/*
+ * Function:  tel_event8
+ *  Sends an event with a single byte payload.
+ *
+ *	type	uint8_t		event type
+ *	value	uint8_t		payload
+ *
+ *  returns:    none
+ */
+void tel_event8(uint8_t type, uint8_t value){
+	tel_begin(type);
+	tel_put(value);
+	tel_end();
+	return;
+}
+
+#endif
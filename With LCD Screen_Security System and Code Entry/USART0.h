@@ -11,6 +11,22 @@
  * tested with USB ports on micro controller and a computer connected via USB 
  * male A to USB male B chord. Communication done using an SSH client (PuTTY)
  * on computer
+ *
+ * Transmitting is interrupt driven. Characters are put in a ring buffer and
+ * sent from the data register empty interrupt, so printing only waits when
+ * the buffer is full. Only write to USART0 from one context (not from ISRs).
+ * Received characters are put in a ring buffer by the receive interrupt.
+ *
+ * Build options (define before including USART0.h or pass with -D)
+ *  USART_BAUDRATE	baud rate, default 57600. The UBRR value and normal or
+ *			double speed (U2X) mode are picked at compile time for the
+ *			lowest error. The build fails if the error is more than 
+ *			USART_MAX_ERROR. 250000, 500000 and 1000000 are exact at 
+ *			16 MHz
+ *  USART_MAX_ERROR	max baud rate error in tenths of a percent, default 20
+ *  USART0_AUTOBAUD	adds USART0_autobaud() to measure the baud rate from a
+ *			'U' (0x55) sync byte. RX0 must also be wired to ICP4 (L0, 
+ *			pin 49). Uses timer 4 while measuring
  */
 
 #ifndef USART0_H
@@ -19,13 +35,68 @@
 #include <stdio.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "../Common/Probe.h"
 
+#ifndef USART_BAUDRATE
 #define USART_BAUDRATE 57600	//set baud rate
-#define BAUD_PRESCALE F_CPU / (USART_BAUDRATE * 16UL) - 1
+#endif
+#ifndef USART_MAX_ERROR
+#define USART_MAX_ERROR 20		//max baud rate error (2.0%)
+#endif
+
+//UBRR values rounded to nearest for normal (16x) and double speed (8x) mode
+#define UBRR_16X ((F_CPU + USART_BAUDRATE * 8UL) / (USART_BAUDRATE * 16UL) - 1)
+#define UBRR_8X ((F_CPU + USART_BAUDRATE * 4UL) / (USART_BAUDRATE * 8UL) - 1)
+
+//actual baud rates and their error in tenths of a percent
+#define BAUD_16X (F_CPU / (16UL * (UBRR_16X + 1)))
+#define BAUD_8X (F_CPU / (8UL * (UBRR_8X + 1)))
+#define BAUD_ERROR(actual) ((((actual) > USART_BAUDRATE) ? \
+	((actual) - USART_BAUDRATE) : (USART_BAUDRATE - (actual))) * 1000UL / \
+	USART_BAUDRATE)
+
+//use normal mode unless double speed is more accurate (normal mode samples
+//each bit more times so it is more tolerant of noise)
+#if (UBRR_16X <= 4095) && (BAUD_ERROR(BAUD_16X) <= BAUD_ERROR(BAUD_8X))
+#define USART_U2X 0
+#define BAUD_PRESCALE UBRR_16X
+#define BAUD_ACTUAL_ERROR BAUD_ERROR(BAUD_16X)
+#else
+#define USART_U2X 1
+#define BAUD_PRESCALE UBRR_8X
+#define BAUD_ACTUAL_ERROR BAUD_ERROR(BAUD_8X)
+#endif
+
+#if BAUD_PRESCALE > 4095
+#error "USART_BAUDRATE is too low for F_CPU"
+#endif
+#if BAUD_ACTUAL_ERROR > USART_MAX_ERROR
+#error "USART_BAUDRATE can't be generated from F_CPU within USART_MAX_ERROR"
+#endif
 
 //function prototypes for file pointers
 int uart_putchar0(char c, FILE* stream);
 int uart_getchar0(void);
+void USART0_tx_wait(uint8_t pos);
+void USART0_tx_publish(uint8_t pos);
+int USART0_rx_available(void);
+int USART0_rx_read(void);
+long USART0_autobaud(int timeout);
+
+#define TX_BUF_SIZE 128			//transmit ring buffer size (power of 2)
+#define TX_MASK (TX_BUF_SIZE - 1)
+
+volatile uint8_t txBuf[TX_BUF_SIZE];	//bytes waiting to be transmitted
+volatile uint8_t txHead = 0;	//next free position, bytes before it can be sent
+volatile uint8_t txTail = 0;	//next byte to transmit
+
+#define RX_BUF_SIZE 64			//receive ring buffer size (power of 2)
+#define RX_MASK (RX_BUF_SIZE - 1)
+
+volatile uint8_t rxBuf[RX_BUF_SIZE];	//received bytes not read yet
+volatile uint8_t rxHead = 0;	//next free position
+volatile uint8_t rxTail = 0;	//next byte to read
+volatile unsigned int rxOverruns = 0;	//bytes dropped because rxBuf was full
 
 static FILE USART0_OUT = FDEV_SETUP_STREAM(uart_putchar0, NULL,
 _FDEV_SETUP_WRITE);
@@ -45,12 +116,64 @@ _FDEV_SETUP_READ);
 int uart_putchar0(char c, FILE* stream){
 	if(c == '\n') uart_putchar0('\r', stream);	//change newlines to return 
 												//carriage
-	loop_until_bit_is_set(UCSR0A, UDRE0);		//wait until transmitter is 
-												//ready for new data
-	UDR0 = c;									//transmit next character
+	USART0_tx_wait(txHead);						//wait for room in buffer
+	txBuf[txHead] = c;							//queue next character
+	USART0_tx_publish((txHead + 1) & TX_MASK);	//let ISR transmit it
 	return 0;
 }
 
+/*
+ * ISR(USART0_UDRE_vect)
+ *  Sends the next byte from the transmit buffer. Disables itself when the 
+ *	buffer is empty.
+ *
+ *  returns:	none
+ */
+ISR(USART0_UDRE_vect){
+	PROBE_SCOPE(PROBE_ISR_TX0);
+	if(txTail == txHead){			//nothing left to send
+		UCSR0B &= ~(1<<UDRIE0);
+		return;
+	}
+	UDR0 = txBuf[txTail];
+	txTail = (txTail + 1) & TX_MASK;
+}
+
+/*
+ * Function:	USART0_tx_wait
+ *	Waits until a byte can be written at a position in the transmit buffer.
+ *	If interrupts are disabled, the oldest bytes are sent by polling instead.
+ *
+ *	pos		uint8_t	buffer position that will be written
+ *
+ *  returns:	none
+ */
+void USART0_tx_wait(uint8_t pos){
+	while(((pos + 1) & TX_MASK) == txTail){	//buffer is full
+		if(!(SREG & 0x80)){					//interrupts are off, send by 
+			loop_until_bit_is_set(UCSR0A, UDRE0);	//polling
+			UDR0 = txBuf[txTail];
+			txTail = (txTail + 1) & TX_MASK;
+		}
+	}
+	return;
+}
+
+/*
+ * Function:	USART0_tx_publish
+ *	Makes all bytes before a position in the transmit buffer available to
+ *	the transmit interrupt and starts transmitting.
+ *
+ *	pos		uint8_t	new head of the buffer
+ *
+ *  returns:	none
+ */
+void USART0_tx_publish(uint8_t pos){
+	txHead = pos;
+	UCSR0B |= (1<<UDRIE0);	//start transmitting
+	return;
+}
+
 /*
  * Function:	uart_getchar0
  *	Function to get chars from USART0. Used to setup USART0_IN as a file 
@@ -59,12 +182,59 @@ int uart_putchar0(char c, FILE* stream){
  *  returns:	int	value recieved from serial communication port, USART0
  */
 int uart_getchar0(void){
-	uint8_t temp;
-	while(!(UCSR0A & (1 << RXC0)));	//wait for serial value to enter UDR
-	temp = UDR0;					//get value from UDR and return it
+	int temp;
+	while((temp = USART0_rx_read()) == -1);	//wait for serial value
 	return temp;
 }
 
+/*
+ * ISR(USART0_RX_vect)
+ *  Moves the received byte into the receive buffer. The byte is dropped if
+ *	the buffer is full.
+ *
+ *  returns:	none
+ */
+ISR(USART0_RX_vect){
+	PROBE_SCOPE(PROBE_ISR_RX0);
+	uint8_t c = UDR0;
+	uint8_t next = (rxHead + 1) & RX_MASK;
+	
+	if(next == rxTail){			//buffer full
+		rxOverruns++;
+		return;
+	}
+	rxBuf[rxHead] = c;
+	rxHead = next;
+}
+
+/*
+ * Function:	USART0_rx_available
+ *	Checks if there are received bytes to read.
+ *
+ *  returns:	int	number of bytes in the receive buffer
+ */
+int USART0_rx_available(void){
+	return (rxHead - rxTail) & RX_MASK;
+}
+
+/*
+ * Function:	USART0_rx_read
+ *	Reads the next received byte without waiting.
+ *
+ *  returns:	int	received byte
+ *				-1	no bytes received
+ */
+int USART0_rx_read(void){
+	uint8_t c;
+	
+	if(rxTail == rxHead){
+		return -1;
+	}
+	c = rxBuf[rxTail];
+	rxTail = (rxTail + 1) & RX_MASK;
+	return c;
+}
+
 /*
  * Function:	InitUSART0
  *	Sets up USART0 to use a baudrate equal to the global constant 
@@ -74,12 +244,89 @@ int uart_getchar0(void){
  */
 void initUSART0(){
 	UCSR0B |= 0x18;	//Enable RX and TX
+	UCSR0B |= (1<<RXCIE0);	//Enable receive interrupt
 	UCSR0C |= 0x06;	//Use 8 bit character frames in async mode
 	
-	//set baud rate (upper 4 bits should be zero)
+	//set baud rate (upper 4 bits should be zero) and speed mode
+#if USART_U2X
+	UCSR0A |= (1<<U2X0);
+#else
+	UCSR0A &= ~(1<<U2X0);
+#endif
 	UBRR0L = BAUD_PRESCALE;
 	UBRR0H = (BAUD_PRESCALE >> 8);
 	return;
 }
 
+#ifdef USART0_AUTOBAUD
+/*
+ * Function:	USART0_autobaud
+ *	Measures the baud rate of a 'U' (0x55) sync byte sent by the other device
+ *	and sets USART0 to match (double speed mode). 0x55 has an edge at every
+ *	bit, so the time from the start bit falling edge to the stop bit rising
+ *	edge is 9 bit times. Edges are timed with timer 4 input capture (ICP4)
+ *	at the full clock rate. The byte may run across one timer overflow (the
+ *	16 bit difference still holds) as long as it is shorter than 65536 
+ *	cycles, i.e. above 2200 baud. The capture edge is switched by polling,
+ *	which takes tens of cycles per edge, so faster rates miss edges. The
+ *	supported range is 2400 to 115200 baud (139 cycles a bit). Timer 4 is
+ *	stopped afterwards.
+ *
+ *	timeout	int		number of timer 4 overflows (4.1 ms each) to wait for
+ *					the sync byte
+ *
+ *  returns:	long	measured baud rate
+ *				-1		no sync byte was received
+ */
+long USART0_autobaud(int timeout){
+	uint16_t start = 0;		//capture time of start bit
+	uint16_t now;
+	int edges = 0;			//edges captured so far
+	int wraps = 0;			//overflows since the start bit
+	unsigned long cycles;	//clock cycles for 9 bits
+	
+	DDRL &= ~(1<<PL0);		//ICP4 input
+	TCCR4A = 0x00;			//normal mode
+	TCCR4B = (1<<CS40);		//no prescaler, capture falling edge first
+	TIFR4 = (1<<ICF4)|(1<<TOV4);	//clear old flags
+	
+	while(edges < 10){
+		if(TIFR4 & (1<<TOV4)){	//count down timeout on each overflow
+			TIFR4 = (1<<TOV4);
+			if(edges == 0){
+				if(--timeout <= 0){
+					TCCR4B = 0x00;
+					return -1;
+				}
+			}
+			else if(++wraps > 1){	//sync byte can't take more than one
+				edges = 0;			//overflow, wait for the next one
+				wraps = 0;
+				TCCR4B &= ~(1<<ICES4);
+			}
+		}
+		if(TIFR4 & (1<<ICF4)){
+			now = ICR4;
+			TCCR4B ^= (1<<ICES4);		//capture the opposite edge next
+			TIFR4 = (1<<ICF4);
+			if(edges == 0){
+				start = now;
+				wraps = 0;
+			}
+			edges++;
+		}
+	}
+	TCCR4B = 0x00;			//stop timer 4
+	
+	cycles = (uint16_t)(now - start);
+	
+	//UBRR = F_CPU / (8 * baud) - 1 = cycles per bit / 8 - 1, rounded
+	UCSR0A |= (1<<U2X0);
+	UBRR0 = (cycles + 36) / 72 - 1;
+	
+	rxTail = rxHead;		//drop the sync byte received at the old rate
+	return (F_CPU * 9UL) / cycles;
+}
+#endif
+
 #endif
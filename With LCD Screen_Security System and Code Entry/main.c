@@ -14,6 +14,9 @@
  *		LCD screen
  *		10KOhm Potentiometer (POT)
  *		4x4 keypad module
+ *		RS-485 transceiver (wiring in Modbus.h)
+ *		zone contacts and beeper (wiring in Zones.h)
+ *		siren (wiring in Siren.h)
  *		jumper wires
  * Configuration shown below
  *
@@ -53,30 +56,123 @@
 
 #define F_CPU 16000000
 
+#define DISPLAY_LCD		//render on the LCD (Display.h), build with 
+						//-DDISPLAY_SEG to mirror on a 7 segment display
+#define PIN_GROUPS ((PIN_LENGTH + 3) / 4)	//Modbus registers for a PIN
+#define PIN_GROUPS_ALL ((1 << PIN_GROUPS) - 1)	//bit for each PIN register
+
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
+#include <stdlib.h>
+#include "SysTick.h"
+#include "USART0.h"
+#include "Telemetry.h"
+#include "Console.h"
+#include "Modbus.h"
+#include "Config.h"
+#include "EventLog.h"
+#include "Lockout.h"
+#include "../Common/Zones.h"
+#include "Siren.h"
+#include "../Common/Watchdog.h"
+#include "../Common/StackPaint.h"
+#include "../Common/AlarmCore.h"
 #include "LCD.h"
 #include "LCDScroll.h"
+#include "LCDGlyph.h"
+#include "LCDBlink.h"
+#include "LCDFormat.h"
 #include "Keypad.h"
+#include "LCDView.h"
+#include "KeyReplay.h"
+#include "../Common/Panel.h"
+#ifdef DISPLAY_SEG			//mirror display on ports the LCD build leaves free
+#define SEG_PORT PORTF
+#define SEG_DDR DDRF
+#define SEG_DIGIT_PORT PORTJ
+#define SEG_DIGIT_DDR DDRJ
+#include "../Common/SevenSeg.h"
+#endif
+
+void showLockout();
+void sendKeyEvent(int key);
+void sendStats();
+int armSystem(int source);
+int disarmSystem(const int code[PIN_LENGTH], int source);
+int checkPIN(const int code[PIN_LENGTH], int source);
+int parsePIN(char** str, int code[PIN_LENGTH]);
+void cmdArm(char* args);
+void cmdBus(char* args);
+void cmdConfig(char* args);
+void cmdDisarm(char* args);
+void cmdKeys(char* args);
+void cmdLog(char* args);
+void cmdProbe(char* args);
+void cmdRam(char* args);
+void cmdScreen(char* args);
+void cmdSetpin(char* args);
+void cmdStats(char* args);
+void cmdStatus(char* args);
+void backgroundTasks();
+void supervisorTickHook();
+void restoreState();
+void zonesTickHook();
+void reportZones();
+void modbusService();
+void loadConfig();
+void applyConfig();
+void saveConfig();
+int parseHex(char** str, int digits, uint16_t* value);
+
 
-void blinkMsg(char str[40]);
-void err();
-void start();
-int enterCode(int changePIN);
-int succPIN();
-void enAlarm();
-void disAlarm();
-void selection();
-void displayMenu();
-void displayStart();
+unsigned long bootTime;	//ms from reset until the LCD is ready
+Config config = {		//defaults used until a configuration is stored
+	{0xFF},					//no PIN
+	0xFF,					//all zones
+	30,						//exit delay (s)
+	30,						//entry delay (s)
+	10,						//wrong PINs (all sources) before full lockout
+	0x01					//entry delay on zone 0 (front door)
+};
+unsigned int wrongPINCount = 0;	//failed disarm attempts since reset
 
+int zoneTickCount = 0;		//ms since the last zones_tick
+uint8_t chimeZones = 0;		//open entry zones the chime has played for
 
-int pin[4] = {-1, 0, 0, 0};		//stored pin number for arming system
-int unlockPIN[4] = {-2, 0, 0, 0};	//unlock pin number for unlocking system
+volatile int modbusArmRequest = 0;	//1 when the bus has asked to arm
+volatile int modbusDisarmRequest = 0;	//1 when the bus has written a PIN
+volatile uint16_t modbusPIN[PIN_GROUPS];	//PIN written by the bus, 4 digits
+					//per register
+volatile uint8_t modbusPINWritten = 0;	//bit for each register written since
+					//the last disarm attempt
 
-int alarmEnable = 0;	//1 when alarm is enabled
-int PINset = 0;		//1 when pin has been set
+//heartbeats the watchdog supervisor needs
+#define BEAT_KEYPAD 0x01	//main loop waiting for keys
+#define BEAT_DISPLAY 0x02	//LCD bus not stuck in a write
+#define BEAT_COMMS 0x04		//USART0 transmit ring draining
+
+int restored = 0;			//1 if the arm state was kept through a reset
+uint8_t savedZoneState = ZONES_DISARMED;	//zone state in the reset record
+uint8_t supervisorTail = 0;	//USART0 transmit tail at the last tick
+
+//serial console commands, must be sorted by name
+const ConsoleCmd commands[] PROGMEM = {
+	{"arm",		cmdArm},
+	{"bus",		cmdBus},
+	{"config",	cmdConfig},
+	{"disarm",	cmdDisarm},
+	{"keys",	cmdKeys},
+	{"log",		cmdLog},
+#ifdef PROBE_ENABLE
+	{"probe",	cmdProbe},
+#endif
+	{"ram",		cmdRam},
+	{"screen",	cmdScreen},
+	{"setpin",	cmdSetpin},
+	{"stats",	cmdStats},
+	{"status",	cmdStatus}
+};
 
 /*
  * Function:  main
@@ -88,367 +184,1098 @@ int PINset = 0;		//1 when pin has been set
  */
 int main(void)
 {	
-	LCD_init();		//initialize LCD screen
+	initSysTick();		//start 1 ms system tick
+	probe_init();		//timer 4 cycle counter, if probes are built
+	LCD_init_start();	//start LCD initialization, stepped by the tick
+	addTickHook(LCD_init_step);
+	initKeypad();		//initialize keypad module (enables interrupts)
+	initUSART0();		//initialize serial port for status messages
+	initModbus();		//initialize RS-485 port for building management
 	initScrollStr();	//initialize scrolling text for LCD screen
-	initKeypad();		//initialize keypad module
-	displayStart();		//scroll starting message
+	LCD_glyph_init();	//initialize custom character cache
+	LCD_edit_init();	//PIN entry field masking
+#ifdef DISPLAY_SEG
+	seg_init();			//mirror display, one digit per tick
+	addTickHook(seg_tick);
+#endif
+	loadConfig();		//read PIN and settings from EEPROM
+	restoreState();		//carry on after a watchdog (or button) reset
+	addTickHook(supervisorTickHook);	//kick watchdog while tasks beat
+	evlog_init();		//find end of event log and log the boot
+	lockout_init(config.lockoutLimit);	//restore wrong PIN counters
+	addTickHook(zonesTickHook);	//zone inputs, delays and beeper
 	
-	//forever loop
+	while(!LCDReady){}	//keypad is live, wait for LCD before writing
+	removeTickHook(LCD_init_step);
+	bootTime = getTicks();
+	fprintf(&USART0_OUT, "Boot: %lu ms\n", bootTime);
+	fprintf_P(&USART0_OUT, PSTR("Reset %02X, last task %u, missing %02X\n"),
+		wdResetFlags, wdRecord.lastTask, wdRecord.missing);
+	if(restored){
+		fputs_P(PSTR("Alarm state restored\n"), &USART0_OUT);
+	}
+	tel_begin(TEL_BOOT);	//report boot time to monitoring station
+	tel_put16(bootTime);
+	tel_end();
+	keyPressHook = sendKeyEvent;	//report each keypress
+	console_init(commands, sizeof(commands) / sizeof(commands[0]));
+	keypadIdleHook = backgroundTasks;	//run serial commands while waiting
+	
+	//forever loop, sets the first PIN if none is stored or kept
 	while(1){
-		selection();
+		panel_select();
 	}
 	return 0;
 }
 
 /*
- * Function:  blinkMsg
- *  Blinks the input string on the LCD screen for 3 seconds. Each second, the 
- *  LCD screen shows message for 0.5 seconds, then shows a blank screen for 
- *  0.5 seconds.
+ * Function:  panelKey
+ *  Panel.h application function. Waits for a new key. Serial commands,
+ *  Modbus requests and the countdown keep running while it waits.
+ *
+ *  returns:    int		key that was pressed (see readNumPad)
+ */
+int panelKey(){
+	getNewKey();		//runs backgroundTasks while it waits
+	return pressedKey;
+}
+
+/*
+ * Function:  panelError
+ *  Panel.h application function. Blinks an error message on the LCD screen
+ *  for 3 seconds. Each second, the LCD screen shows message for 0.5 
+ *  seconds, then shows a blank screen for 0.5 seconds. The message is 
+ *  written once and the display is switched on and off in the background.
+ *  Pressing a key ends the message early.
  *
- *  str		char[40]	input string to be displayed
+ *  msg		int	message to be displayed (DISP_ERR_ value)
  *
  *  returns:    none
  */
-void blinkMsg(char str[40]){
-	int line;
+void panelError(int msg){
+	waitForKeypadClear();			//only a new keypress cancels the message
+	display_show(VIEW_ERROR, msg, 0);
 	
-	//blink message each second for 3 seconds
-	for(int i = 0; i < 3; i++){
-		//clear both lines of LCD screen and display message on first line for
-		//0.5 sec (wrapping long text to the second line)
-		line = 1;
-		LCD_clear_line(&line);
-		line = 0;
-		LCD_clear_line(&line);
-		LCD_write_str(str, &line);
-		
-		_delay_ms(500);
-		
-		//clear both lines of LCD screen for 0.5 sec
-		line = 1;
-		LCD_clear_line(&line);
-		line = 0;
-		LCD_clear_line(&line);
-		
-		_delay_ms(500);
+	while(LCD_blink_active()){		//next screen would overwrite the message
+		work_run();					//keypad scan can cancel the message
 	}
+	LCD_blink_stop();
 	return;
 }
 
 /*
- * Function:  err
- *  Displays blinking error message. Used as a General error message.
+ * Function:  panelPause
+ *  Panel.h application function. Keeps the current screen for a while.
+ *  LCD writes posted to the work queue still run.
+ *
+ *  ms		uint16_t	time to wait
  *
  *  returns:    none
  */
-void err(){
-	char str[6] = "Error";
-	blinkMsg(str);
+void panelPause(uint16_t ms){
+	unsigned long start = getTicks();
+	
+	while(getTicks() - start < ms){
+		work_run();
+	}
 	return;
 }
 
 /*
- * Function:  start
- *  blinks all segments in display to indicate no pin has been set. Calls
- *  enterCode function to set pin if "A" or "C" buttons are pressed.
+ * Function:  panelShowPIN
+ *  Panel.h application function. Scrolls the new PIN on the top line with
+ *  the confirm options below it.
  *
  *  returns:    none
  */
-void start(){
-	int confirm = 1;	//User PIN confirmation flag
-	
-	//wait for A or C to be pressed
-	while(!((pressedKey == 0xA) || (pressedKey == 0xC))){
-		getNewKey();	//wait for new key from keypad
+void panelShowPIN(){
+	display_show(VIEW_PIN, 0, 0);
+	return;
+}
+
+/*
+ * Function:  panelLocked
+ *  Panel.h application function. Shows the time left if the keypad is 
+ *  locked out after wrong PINs.
+ *
+ *  returns:    1	keypad is locked out
+ *		0	PINs can be entered
+ */
+int panelLocked(){
+	if(lockout_remaining(EVLOG_KEYPAD) == 0){
+		return 0;
 	}
-	stopScrollStr();	//stop scrolling start message
+	showLockout();
+	return 1;
+}
+
+/*
+ * Function:  panelArmSystem
+ *  Panel.h application function. Arms from the keypad (armSystem).
+ *
+ *  returns:    int		as armSystem
+ */
+int panelArmSystem(){
+	return armSystem(EVLOG_KEYPAD);
+}
+
+/*
+ * Function:  panelDisarmSystem
+ *  Panel.h application function. Disarms from the keypad (disarmSystem).
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *
+ *  returns:    int		as disarmSystem
+ */
+int panelDisarmSystem(const int code[PIN_LENGTH]){
+	return disarmSystem(code, EVLOG_KEYPAD);
+}
+
+/*
+ * Function:  panelCheckPIN
+ *  Panel.h application function. Checks the current PIN before it is 
+ *  changed from the keypad (checkPIN).
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *
+ *  returns:    int		as checkPIN
+ */
+int panelCheckPIN(const int code[PIN_LENGTH]){
+	return checkPIN(code, EVLOG_KEYPAD);
+}
+
+/*
+ * Function:  panelPINChanged
+ *  Panel.h application function. Keeps the new PIN across resets.
+ *
+ *  returns:    none
+ */
+void panelPINChanged(){
+	saveConfig();
+	return;
+}
+
+/*
+ * Function:  showLockout
+ *  Shows the time left in a keypad lockout, counting down each second, 
+ *  until it ends or a key is pressed. Serial commands keep running.
+ *
+ *  returns:    none
+ */
+void showLockout(){
+	unsigned long left;		//ms left in the lockout
+	unsigned long shown = 0;	//seconds on the screen, 0 for none yet
 	
-	while(confirm != 0){		//loop until pin is confirmed by user
-		if(enterCode(1) == 0){	//get acceptable PIN
-			confirm = succPIN();	//confirm PIN with user
-			PINset = 1;		//PIN has been set
-		}
-		else{				//if pin is unsuccsessful, display error
-			err();
+	waitForKeypadClear();	//key that opened the menu is not a cancel
+	
+	while(((left = lockout_remaining(EVLOG_KEYPAD)) > 0) && !newKeyInput){
+		left = (left + 999) / 1000;
+		if(left != shown){	//draw once a second
+			display_show(VIEW_LOCKOUT, left, 0);
+			shown = left;
 		}
+		backgroundTasks();
 	}
 	return;
 }
 
 /*
- * Function:  enterCode
- *  sets pin or unlock pin based on input from keypad and value of input param
- *  changePIN.
+ * Function:  sendKeyEvent
+ *  Keypad hook. Reports each new keypress to the monitoring station.
+ *
+ *  key		int		key that was pressed
  *
- *  changePIN	0 changes the pin to unlock the system (unlockPIN)
- *		1 changes the stored pin (pin)
+ *  returns:    none
+ */
+void sendKeyEvent(int key){
+	tel_event8(TEL_KEYPRESS, key);
+	return;
+}
+
+/*
+ * Function:  sendStats
+ *  Reports uptime, boot time and glyph cache counters to the monitoring 
+ *  station.
  *
- *  returns:    0 entered pin is acceptable
- *		1 entered pin is unacceptable
+ *  returns:    none
  */
-int enterCode(int changePIN){
-	int newKey = 0;		//next key pressed on keypad
-	int errr = 1;		//set error flag true
-	int LCDline;		//line on LCD
-	char dispPIN[17];	//string to display the pin
-	
+void sendStats(){
+	tel_begin(TEL_STATS);
+	tel_put32(getTicks());
+	tel_put16(bootTime);
+	tel_put16(glyphHits);
+	tel_put16(glyphMisses);
+	tel_end();
+	return;
+}
+
+/*
+ * Function:  armSystem
+ *  Arms the alarm if a PIN has been set. Used by the keypad (Panel.h) and the
+ *  serial console so both arm the same way. Nothing is reported if the
+ *  alarm was already armed.
+ *
+ *  source	int	where the request came from (EVLOG_ sources)
+ *
+ *  returns:    0	alarm is armed
+ *		1	no PIN has been set
+ *		2	alarm was already armed
+ */
+int armSystem(int source){
+	int result = core_arm();
 	
-	LCDline = 0;		//write message to top line of LCD
-	LCD_clear_line(&LCDline);
-	LCD_write_str("Enter PIN:", &LCDline);
+	if(result != 0){	//no PIN has been set, or already armed
+		return result;
+	}
+	tel_event(TEL_ARM);	//report arming to monitoring station
+	evlog_write(TEL_ARM, source);
+	sendStats();
+	return 0;
+}
+
+/*
+ * Function:  disarmSystem
+ *  Disarms the alarm if the code matches the stored pin. Used by the keypad
+ *  (Panel.h) and the serial console so both disarm the same way.
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *  source	int	where the code came from (EVLOG_ sources)
+ *
+ *  returns:    0	alarm is disarmed
+ *		1	code does not match the stored pin
+ *		2	alarm is not armed
+ *		3	source is locked out after wrong PINs
+ */
+int disarmSystem(const int code[PIN_LENGTH], int source){
+	if(alarmEnable == 0){
+		return 2;
+	}
+	if(lockout_remaining(source) > 0){	//code is not checked while locked
+		return 3;
+	}
+	if(core_disarm(code) != 0){
+		wrongPINCount++;
+		tel_event(TEL_WRONG_PIN);	//report failed attempt
+		evlog_write(TEL_WRONG_PIN, source);
+		lockout_fail(source);
+		return 1;
+	}
+	siren_stop();
+	lockout_clear(source);
+	tel_event(TEL_DISARM);		//report disarming to monitoring station
+	evlog_write(TEL_DISARM, source);
+	sendStats();
+	return 0;
+}
+
+/*
+ * Function:  checkPIN
+ *  Checks a code against the stored pin before the pin is changed. Used by
+ *  the keypad (Panel.h) and the serial console so a wrong pin is logged
+ *  and counted towards the lockout the same way from both.
+ *
+ *  code	int[]	entered code (PIN_LENGTH digits)
+ *  source	int	where the code came from (EVLOG_ sources)
+ *
+ *  returns:    0	code matches the stored pin
+ *		1	code does not match the stored pin
+ *		3	source is locked out after wrong PINs
+ */
+int checkPIN(const int code[PIN_LENGTH], int source){
+	if(lockout_remaining(source) > 0){	//code is not checked while locked
+		return 3;
+	}
+	if(!pinMatches(pin, code)){
+		tel_event(TEL_WRONG_PIN);	//report failed attempt
+		evlog_write(TEL_WRONG_PIN, source);
+		lockout_fail(source);
+		return 1;
+	}
+	lockout_clear(source);
+	return 0;
+}
+
+/*
+ * Function:  parsePIN
+ *  Reads a PIN_LENGTH digit PIN from a console argument string and moves 
+ *  the string pointer past it and any following spaces.
+ *
+ *  str		char**	argument string
+ *  code	int[]	digits read from the string (PIN_LENGTH digits)
+ *
+ *  returns:    0	PIN was read
+ *		1	argument is not a PIN_LENGTH digit PIN
+ */
+int parsePIN(char** str, int code[PIN_LENGTH]){
+	char* s = *str;
 	
-	LCDline = 1;		//set to bottom line of LCD and clear it
-	LCD_clear_line(&LCDline);
+	for(int i = 0; i < PIN_LENGTH; i++){
+		if((s[i] < '0') || (s[i] > '9')){
+			return 1;
+		}
+		code[i] = s[i] - '0';
+	}
+	s += PIN_LENGTH;
+	if((*s != ' ') && (*s != '\0')){	//too many digits
+		return 1;
+	}
+	while(*s == ' '){
+		s++;
+	}
+	*str = s;
+	return 0;
+}
+
+/*
+ * Function:  cmdArm
+ *  Console command "arm". Arms the alarm.
+ *
+ *  args	char*	unused
+ *
+ *  returns:    none
+ */
+void cmdArm(char* args){
+	switch(armSystem(EVLOG_CONSOLE)){
+		case 0:
+			fputs_P(PSTR("armed\n"), &USART0_OUT);
+			break;
+		case 1:
+			fputs_P(PSTR("no PIN set\n"), &USART0_OUT);
+			break;
+		default:
+			fputs_P(PSTR("already armed\n"), &USART0_OUT);
+			break;
+	}
+	return;
+}
+
+/*
+ * Function:  cmdBus
+ *  Console command "bus". Prints the LCD instructions, data bytes and 
+ *  enable pulses sent by each caller context (one per screen, plus 
+ *  scrolling, blinking, glyph uploads and start up). "bus reset" clears 
+ *  them, e.g. before going through a screen to check it against a budget.
+ *
+ *  args	char*	"reset" or empty
+ *
+ *  returns:    none
+ */
+void cmdBus(char* args){
+	LCDBusCount c;
 	
+	if(strcmp_P(args, PSTR("reset")) == 0){
+		LCD_bus_reset();
+		return;
+	}
+	fputs_P(PSTR("context instructions data pulses\n"), &USART0_OUT);
+	for(int i = 0; i < LCD_CTX_COUNT; i++){
+		cli();				//copy while no interrupt can change it
+		c = LCDBusStats[i];
+		sei();
+		if(c.pulses == 0){
+			continue;
+		}
+		fprintf_P(&USART0_OUT, PSTR("%S %lu %lu %lu\n"), LCDBusNames[i],
+			c.instructions, c.data, c.pulses);
+	}
+	return;
+}
+
+/*
+ * Function:  cmdConfig
+ *  Console command "config". Uploads a configuration image in pieces so a 
+ *  host can send one line at a time. The image holds the PIN, so once a 
+ *  PIN has been set it must be given to start an upload:
+ *	config begin <len> [pin]	start an image of len bytes
+ *	config data <hex>		up to 8 image bytes as hex
+ *	config end <crc>		check the CRC-16 (hex) and activate the image
+ *	config show				print the active settings
+ *
+ *  args	char*	subcommand and its argument
+ *
+ *  returns:    none
+ */
+void cmdConfig(char* args){
+	int code[PIN_LENGTH];
+	uint16_t value;
 	
-	//loop to get each new value and exit if pin cant fit on a line of the LCD
-	for(int i = 0; i < 17; i++){
-		getNewKey();	//get next key that's pressed
-		newKey = pressedKey;
-		
-		if(newKey == 0xE){	//if # is pressed, exit the loop
-			if(i == 4){		//successful pin condition
-				errr = 0;	//reset error flag if entered pin is 4 digits
-			}
-			break;			//exit loop early
+	if(strncmp_P(args, PSTR("begin "), 6) == 0){
+		args += 6;
+		value = atoi(args);
+		while((*args >= '0') && (*args <= '9')){
+			args++;
 		}
-		
-		if(newKey > 9){		//if pressed key is not a number, exit
-			break;
+		while(*args == ' '){
+			args++;
 		}
-		
-		//store the pressed key in the 4 digit pin or unlockPIN array
-		if(i < 4){
-			//if changePIN is true, store the new key in the pin array
-			if(changePIN == 1){
-				pin[i] = newKey;
+		if(PINset == 1){
+			if((parsePIN(&args, code) != 0) || (*args != '\0')){
+				fputs_P(PSTR("usage: config begin <len> <pin>\n"), 
+					&USART0_OUT);
+				return;
 			}
-			//if changePIN is true, store the new key in the unlockPIN array
-			else{
-				unlockPIN[i] = newKey;
+			switch(checkPIN(code, EVLOG_CONSOLE)){
+				case 0:
+					break;
+				case 1:
+					fputs_P(PSTR("wrong PIN\n"), &USART0_OUT);
+					return;
+				default:
+					fprintf_P(&USART0_OUT, 
+						PSTR("locked out, retry in %lu s\n"), 
+						(lockout_remaining(EVLOG_CONSOLE) + 999) / 1000);
+					return;
 			}
 		}
-		
-		//convert newKey to char and store in dispPIN
-		dispPIN[i] = newKey + 0x30;
-		dispPIN[i + 1] = '\0';
-		
-		//write display pin to bottom line of LCD
-		LCDline = 1;
-		LCD_write_str(dispPIN, &LCDline);
+		if(config_begin(value) != 0){
+			fprintf_P(&USART0_OUT, PSTR("length 1 - %d\n"), CONFIG_MAX);
+			return;
+		}
+		fputs_P(PSTR("ok\n"), &USART0_OUT);
+	}
+	else if(strncmp_P(args, PSTR("data "), 5) == 0){
+		args += 5;
+		while(parseHex(&args, 2, &value) == 0){
+			config_put(value);
+		}
+		if(*args != '\0'){
+			fputs_P(PSTR("bad hex\n"), &USART0_OUT);
+			return;
+		}
+		fputs_P(PSTR("ok\n"), &USART0_OUT);
+	}
+	else if(strncmp_P(args, PSTR("end "), 4) == 0){
+		args += 4;
+		if(parseHex(&args, 4, &value) != 0){
+			fputs_P(PSTR("usage: config end <crc>\n"), &USART0_OUT);
+			return;
+		}
+		switch(config_end(value)){
+			case 0:
+				loadConfig();
+				fputs_P(PSTR("config active\n"), &USART0_OUT);
+				break;
+			case 1:
+				fputs_P(PSTR("image incomplete, kept old config\n"), 
+					&USART0_OUT);
+				break;
+			default:
+				fputs_P(PSTR("CRC error, kept old config\n"), &USART0_OUT);
+				break;
+		}
+	}
+	else if(strcmp_P(args, PSTR("show")) == 0){
+		fprintf_P(&USART0_OUT, PSTR("slot %d\nzones %02X\n"), 
+			config_active(), config.zoneMask);
+		fprintf_P(&USART0_OUT, PSTR("exit %u s\nentry %u s\nlockout %u\n"),
+			config.exitDelay, config.entryDelay, config.lockoutLimit);
+	}
+	else{
+		fputs_P(PSTR("usage: config begin|data|end|show\n"), &USART0_OUT);
 	}
-	return errr;	//return error state
+	return;
 }
 
 /*
- * Function:  succPIN
- *  Displays a message showing the entered pin and prompts the user to confirm
- *  their pin or chose to enter a new one. This function recursively calls 
- *  itself on invalid input from keypad
+ * Function:  cmdDisarm
+ *  Console command "disarm <pin>". Disarms the alarm.
+ *
+ *  args	char*	PIN
  *
- *  returns:    0	pin confirmed by user
- *		1	user would like to enter a different pin	
+ *  returns:    none
  */
-int succPIN(){
-	int LCDline;
-	int confirm = 0;
+void cmdDisarm(char* args){
+	int code[PIN_LENGTH];
 	
-	//confirmation message top line
-	char message[18] = "You entered: ";
-	//add PIN to message
-	message[13] = pin[0] + 0x30;
-	message[14] = pin[1] + 0x30;
-	message[15] = pin[2] + 0x30;
-	message[16] = pin[3] + 0x30;
-	message[17] = ' ';
-	message[18] = ' ';
-	message[19] = '\0';
-	
-	//print first line (scrolling)
-	startScrollStr(message);
-	//LCDline = 0;
-	//LCD_write_str(message, &LCDline);
-	
-	//print second line
-	strcpy(message, "1=OK, 2=New Pin");
-	LCDline = 1;
-	LCD_write_str(message, &LCDline);
-	
-	getNewKey();		//wait for user option
-	confirm = pressedKey;	//get user option
+	if(parsePIN(&args, code) != 0){
+		fputs_P(PSTR("usage: disarm <pin>\n"), &USART0_OUT);
+		return;
+	}
+	switch(disarmSystem(code, EVLOG_CONSOLE)){
+		case 0:
+			fputs_P(PSTR("disarmed\n"), &USART0_OUT);
+			break;
+		case 1:
+			fputs_P(PSTR("wrong PIN\n"), &USART0_OUT);
+			break;
+		case 3:
+			fprintf_P(&USART0_OUT, PSTR("locked out, retry in %lu s\n"), 
+				(lockout_remaining(EVLOG_CONSOLE) + 999) / 1000);
+			break;
+		default:
+			fputs_P(PSTR("not armed\n"), &USART0_OUT);
+			break;
+	}
+	return;
+}
+
+/*
+ * Function:  parseHex
+ *  Reads a fixed number of hex digits from a console argument string and 
+ *  moves the string pointer past them and any following spaces.
+ *
+ *  str		char**		argument string
+ *  digits	int			number of hex digits to read
+ *  value	uint16_t*	value read from the string
+ *
+ *  returns:    0	value was read
+ *		1	string does not start with enough hex digits
+ */
+int parseHex(char** str, int digits, uint16_t* value){
+	char* s = *str;
+	uint16_t v = 0;
+	char c;
 	
-	//if invalid key, error and call recursively call function
-	if((confirm < 1)|(confirm > 2)){
-		err();
-		return succPIN();	//call function until input is valid, then return
+	for(int i = 0; i < digits; i++){
+		c = s[i];
+		if((c >= '0') && (c <= '9')){
+			c -= '0';
+		}
+		else if((c >= 'A') && (c <= 'F')){
+			c -= 'A' - 10;
+		}
+		else if((c >= 'a') && (c <= 'f')){
+			c -= 'a' - 10;
+		}
+		else{
+			return 1;
+		}
+		v = (v << 4) | c;
 	}
-	//stop scrolling text
-	stopScrollStr();
-	//deprecate option for 0 = OK 1 = new pin and return the value
-	return confirm - 1;
+	s += digits;
+	while(*s == ' '){
+		s++;
+	}
+	*value = v;
+	*str = s;
+	return 0;
 }
 
 /*
- * Function:  enAlarm
- *  Checks that the pin has been set and enables the alarm.
+ * Function:  cmdKeys
+ *  Console command "keys <script>". Replays keypresses and traces the
+ *  frames drawn (KeyReplay.h). The result is printed when the script ends.
+ *
+ *  args	char*	script of keys, gaps, budget and expected views
  *
  *  returns:    none
  */
-void enAlarm(){
-	if(PINset == 1){		//if PIN has been set, arm alarm system
-		alarmEnable = 1;	//set alarm enable flag
-		
-		int line;
-		char msg[13] = "System Armed";	//message for LCD
-		
-		line = 1;			//clear LCD lines
-		LCD_clear_line(&line);
-		line = 0;
-		LCD_clear_line(&line);
-		
-		LCD_write_str(msg, &line);	//send message to LCD top line for 1s
-		_delay_ms(1000);
-	}
-	else{				//if PIN has not been set, enter one
-		pressedKey = 0xA;	//skip system startup message
-		start();
+void cmdKeys(char* args){
+	if(replayActive){
+		fputs_P(PSTR("replay running\n"), &USART0_OUT);
+		return;
+	}
+	if((*args == '\0') || (replay_start(args) != 0)){
+		fputs_P(PSTR("usage: keys [/ms] [!ms] <keys 0-9 A-D * #> [>view]\n"),
+			&USART0_OUT);
 	}
 	return;
 }
 
 /*
- * Function:  disAlarm
- *  disables alarm if entered unlockPIN is the same as stored pin. Displays 
- *  error and returns to previous displayed message if alarm is not enabled or
- *  if entered unlockPIN does not match the stored pin.
+ * Function:  cmdLog
+ *  Console command "log". Prints the event log, oldest first, one record
+ *  per line: number, seconds since boot, event type, argument.
+ *
+ *  args	char*	unused
  *
  *  returns:    none
  */
-void disAlarm(){
-	int incorrectPIN = 0;	//flag for if incorrect pin is entered
-	int er = 0;		//flag for input pin error
-	int LCDline;		//LCD line
-	char msg[13];		//LCD message
-	
-	if(alarmEnable == 0){	//if alarm is not enabled, display error message 
-				//and return
-		
-		LCDline = 1;				//clear LCD lines
-		LCD_clear_line(&LCDline);
-		LCDline = 0;
-		LCD_clear_line(&LCDline);
-		
-		strcpy(msg, "System not armed");	//error message
-		blinkMsg(msg);
-		
+void cmdLog(char* args){
+	evlog_dump();
+	return;
+}
+
+#ifdef PROBE_ENABLE
+/*
+ * Function:  cmdProbe
+ *  Console command "probe". Prints the timing probe table. "probe reset"
+ *  clears it.
+ *
+ *  args	char*	"reset" or empty
+ *
+ *  returns:    none
+ */
+void cmdProbe(char* args){
+	if(strcmp_P(args, PSTR("reset")) == 0){
+		probe_reset();
 		return;
 	}
+	probe_dump(&USART0_OUT);
+	return;
+}
+#endif
+
+/*
+ * Function:  cmdRam
+ *  Console command "ram". Prints the RAM budget: static data, heap, the
+ *  deepest the stack has been and how close it has come to the heap.
+ *
+ *  args	char*	unused
+ *
+ *  returns:    none
+ */
+void cmdRam(char* args){
+	fprintf_P(&USART0_OUT, PSTR("static %u heap %u\nstack %u max %u\n"),
+		ram_static(), ram_heap(), stack_now(), stack_max());
+	fprintf_P(&USART0_OUT, PSTR("free min %u of %u bytes\n"),
+		ram_free_min(), RAMEND + 1 - RAMSTART);
+	return;
+}
+
+/*
+ * Function:  cmdScreen
+ *  Console command "screen". Draws the panel as text: the LCD as it is on
+ *  the screen (custom characters show as *), the mirror display if it is
+ *  built, and the frames drawn and keys taken with their rate.
+ *
+ *  args	char*	unused
+ *
+ *  returns:    none
+ */
+void cmdScreen(char* args){
+	unsigned long secs = getTicks() / 1000;
+	char c;
 	
-	er = enterCode(0);	//get unlockPIN from keypad input
+	fputs_P(PSTR("+----------------+\n"), &USART0_OUT);
+	for(int line = 0; line < 2; line++){
+		fputc('|', &USART0_OUT);
+		for(int col = 0; col < LCD_LineLength; col++){
+			c = LCDShadow[line][col];
+			//codes 0 - 15 are CGRAM slots, glyphs are drawn as 8 - 15
+			fputc(((uint8_t)c < GLYPH_CHAR + GLYPH_SLOTS) ? '*' : c, &USART0_OUT);
+		}
+		fputs_P(PSTR("|\n"), &USART0_OUT);
+	}
+	fputs_P(PSTR("+----------------+\n"), &USART0_OUT);
+#ifdef DISPLAY_SEG
+	fprintf_P(&USART0_OUT, PSTR("[%c%c%c%c]\n"), seg_char(digits[0]),
+		seg_char(digits[1]), seg_char(digits[2]), seg_char(digits[3]));
+#endif
+	if(secs == 0){
+		secs = 1;
+	}
+	fprintf_P(&USART0_OUT, PSTR("frames %lu (%lu/min) keys %lu (%lu/min)\n"),
+		displayFrames, displayFrames * 60 / secs,
+		keyPresses, keyPresses * 60 / secs);
+	return;
+}
+
+/*
+ * Function:  cmdSetpin
+ *  Console command "setpin [old] <new>". Changes the stored pin. The old pin
+ *  is required once a pin has been set.
+ *
+ *  args	char*	old PIN (if set) and new PIN
+ *
+ *  returns:    none
+ */
+void cmdSetpin(char* args){
+	int oldPIN[PIN_LENGTH];
+	int code[PIN_LENGTH];
 	
-	if(er == 1){		//if a bad code has been entered, (re)enable alarm
-		enAlarm();
+	if(PINset == 1){
+		if(parsePIN(&args, oldPIN) != 0){
+			fputs_P(PSTR("usage: setpin <old> <new>\n"), &USART0_OUT);
+			return;
+		}
+		switch(checkPIN(oldPIN, EVLOG_CONSOLE)){
+			case 0:
+				break;
+			case 1:
+				fputs_P(PSTR("wrong PIN\n"), &USART0_OUT);
+				return;
+			default:
+				fprintf_P(&USART0_OUT, PSTR("locked out, retry in %lu s\n"), 
+					(lockout_remaining(EVLOG_CONSOLE) + 999) / 1000);
+				return;
+		}
+	}
+	if((parsePIN(&args, code) != 0) || (*args != '\0')){
+		fputs_P(PSTR("usage: setpin [old] <new>\n"), &USART0_OUT);
 		return;
 	}
+	core_set_pin(code);
+	saveConfig();
+	fputs_P(PSTR("PIN set\n"), &USART0_OUT);
+	return;
+}
+
+/*
+ * Function:  cmdStats
+ *  Console command "stats". Prints timing, cache and work queue counters
+ *  and invariant failures. "stats reset" clears the interrupt time, queue
+ *  depth and invariant failures afterwards.
+ *
+ *  args	char*	"reset" or empty
+ *
+ *  returns:    none
+ */
+void cmdStats(char* args){
+	fprintf_P(&USART0_OUT, PSTR("uptime %lu ms\nboot %lu ms\n"), 
+		getTicks(), bootTime);
+	fprintf_P(&USART0_OUT, PSTR("glyph hits %u misses %u\n"), 
+		glyphHits, glyphMisses);
+	fprintf_P(&USART0_OUT, PSTR("rx overruns %u\n"), rxOverruns);
+	fprintf_P(&USART0_OUT, PSTR("isr max %u us\nqueue max %u dropped %u\n"),
+		work_isr_max_us(), workMaxDepth, workDropped);
+	fprintf_P(&USART0_OUT, PSTR("invariant fails %u first %u line %u\n"),
+		invCount, invFirst, invLine);
+	if(strcmp_P(args, PSTR("reset")) == 0){
+		work_stats_reset();
+		inv_reset();
+	}
+	return;
+}
+
+/*
+ * Function:  cmdStatus
+ *  Console command "status". Prints the alarm state.
+ *
+ *  args	char*	unused
+ *
+ *  returns:    none
+ */
+void cmdStatus(char* args){
+	fprintf_P(&USART0_OUT, PSTR("alarm %S\nPIN %S\n"),
+		alarmEnable ? PSTR("armed") : PSTR("disarmed"),
+		PINset ? PSTR("set") : PSTR("not set"));
+	return;
+}
+
+
+/*
+ * Function:  backgroundTasks
+ *  Keypad idle hook. Runs the serial console and the Modbus requests while
+ *  the keypad is waiting for a key.
+ *
+ *  returns:    none
+ */
+void backgroundTasks(){
+	wd_beat(BEAT_KEYPAD);
+	work_run();
+	stack_check();
+	core_check();
+	console_poll();
+	replay_poll();
+	modbusService();
+	reportZones();
+	panel_countdown();
+	return;
+}
+
+/*
+ * Function:  zonesTickHook
+ *  System tick hook. Runs the zone inputs, delays and beeper every 
+ *  ZONE_TICK_MS.
+ *
+ *  returns:    none
+ */
+void zonesTickHook(){
+	if(++zoneTickCount >= ZONE_TICK_MS){
+		zoneTickCount = 0;
+		zones_tick();
+	}
+	return;
+}
+
+/*
+ * Function:  reportZones
+ *  Reports zones that have set off the alarm to the monitoring station and
+ *  the event log and starts the siren. Plays the chime when a door (entry 
+ *  zone) opens while the alarm is off.
+ *
+ *  returns:    none
+ */
+void reportZones(){
+	uint8_t trips = zones_take_trips();
+	uint8_t doors = zoneOpen & config.entryZones;
 	
-	for(int i = 0; i < 4; i++){		//loop to check if pin matches unlockPIN
-		if(pin[i] != unlockPIN[i])	//check each pin digit
-			incorrectPIN = 1;	//incorrctPIN = 1 if incorrect pin is 
-						//entered
+	if(trips != 0){
+		siren_play(sirenAlarm);
+	}
+	for(int i = 0; i < ZONE_COUNT; i++){
+		if(trips & (1 << i)){
+			tel_event8(TEL_ZONE_TRIP, i);
+			evlog_write(TEL_ZONE_TRIP, i);
+		}
 	}
 	
-	if(incorrectPIN == 1){	//if incorrect pin is entered, display message and
-				//(re)enable the alarm
-		strcpy(msg, "Wrong PIN");
-		blinkMsg(msg);	//display error message
-		
-		enAlarm();	//(re)enable the alarm
-		return;
+	if((zoneState == ZONES_DISARMED) && (doors & ~chimeZones) && 
+	   !siren_active()){
+		siren_play(sirenChime);
 	}
+	chimeZones = doors;
+	return;
+}
+
+/*
+ * Function:  modbusService
+ *  Carries out arm and disarm requests written over Modbus. The register
+ *  writes only set flags because they arrive in interrupt context. The PIN
+ *  registers are cleared after every disarm attempt, and an attempt is 
+ *  ignored unless every PIN register was written for it.
+ *
+ *  returns:    none
+ */
+void modbusService(){
+	int code[PIN_LENGTH];
+	uint16_t regs[PIN_GROUPS];
+	uint8_t written;
+	uint16_t value;
 	
-	alarmEnable = 0;	//disable alarm
+	if(modbusArmRequest){
+		modbusArmRequest = 0;
+		armSystem(EVLOG_MODBUS);
+	}
+	if(modbusDisarmRequest){
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){	//take this attempt, start the next
+			for(int g = 0; g < PIN_GROUPS; g++){
+				regs[g] = modbusPIN[g];
+				modbusPIN[g] = 0;
+			}
+			written = modbusPINWritten;
+			modbusPINWritten = 0;
+			modbusDisarmRequest = 0;
+		}
+		if(written != PIN_GROUPS_ALL){	//part of the PIN is from before
+			return;
+		}
+		for(int g = 0; g < PIN_GROUPS; g++){	//split registers into digits
+			value = regs[g];
+			for(int i = ((g == PIN_GROUPS - 1) ? PIN_LENGTH : (g + 1) * 4) - 1;
+				i >= g * 4; i--){
+				code[i] = value % 10;
+				value /= 10;
+			}
+		}
+		disarmSystem(code, EVLOG_MODBUS);
+	}
+	return;
+}
+
+/*
+ * Function:  modbusReadCoil
+ *  Modbus coil map. Coil 0 is the alarm armed state.
+ *
+ *  addr	uint16_t	coil address
+ *
+ *  returns:    int		coil state, -1 for an unknown coil
+ */
+int modbusReadCoil(uint16_t addr){
+	if(addr == 0){
+		return alarmEnable;
+	}
+	return -1;
+}
+
+/*
+ * Function:  modbusWriteCoil
+ *  Writing 1 to coil 0 arms the alarm. Disarming needs the PIN, so it is 
+ *  done by writing holding register 0.
+ *
+ *  addr	uint16_t	coil address
+ *  on		int			1 to arm
+ *
+ *  returns:    0	request accepted
+ *		1	unknown coil or disarm request
+ */
+int modbusWriteCoil(uint16_t addr, int on){
+	if((addr != 0) || !on){
+		return 1;
+	}
+	modbusArmRequest = 1;
+	return 0;
+}
+
+/*
+ * Function:  modbusReadHolding
+ *  Modbus holding register map. Registers 0 to PIN_GROUPS - 1 are the 
+ *  disarm PIN and always read as 0 so the stored PIN cannot be read from 
+ *  the bus.
+ *
+ *  addr	uint16_t	register address
+ *  value	uint16_t*	register value
+ *
+ *  returns:    0	register was read
+ *		1	unknown register
+ */
+int modbusReadHolding(uint16_t addr, uint16_t* value){
+	if(addr >= PIN_GROUPS){
+		return 1;
+	}
+	*value = 0;
+	return 0;
+}
+
+/*
+ * Function:  modbusWriteHolding
+ *  The PIN is written 4 digits per register (as a decimal number), first
+ *  digits in register 0. The last register holds the remaining digits, and
+ *  writing it disarms the alarm if every other PIN register has been
+ *  written since the last attempt. With a 4 digit PIN that is just 
+ *  register 0.
+ *
+ *  addr	uint16_t	register address
+ *  value	uint16_t	PIN digits as a decimal number
+ *
+ *  returns:    0	request accepted
+ *		1	unknown register or value out of range
+ */
+int modbusWriteHolding(uint16_t addr, uint16_t value){
+	uint16_t limit = 1;		//10 ^ digits in this register
+	int digits = (addr == PIN_GROUPS - 1) ? PIN_LENGTH - addr * 4 : 4;
 	
-	LCDline = 1;		//clear LCD lines
-	LCD_clear_line(&LCDline);
-	LCDline = 0;
-	LCD_clear_line(&LCDline);
+	for(int i = 0; i < digits; i++){
+		limit *= 10;
+	}
+	if((addr >= PIN_GROUPS) || (value >= limit)){
+		return 1;
+	}
+	modbusPIN[addr] = value;
+	modbusPINWritten |= 1 << addr;
+	if(addr == PIN_GROUPS - 1){	//PIN complete
+		modbusDisarmRequest = 1;
+	}
+	return 0;
+}
+
+/*
+ * Function:  modbusReadInput
+ *  Modbus input register map.
+ *	0	alarm armed		1	PIN set			2	open zones
+ *	3	wrong PINs		4	uptime s (low)	5	uptime s (high)
+ *	6	CRC errors		7	console overruns
+ *
+ *  addr	uint16_t	register address
+ *  value	uint16_t*	register value
+ *
+ *  returns:    0	register was read
+ *		1	unknown register
+ */
+int modbusReadInput(uint16_t addr, uint16_t* value){
+	unsigned long seconds = sysTicks / 1000;	//ISR context, read is atomic
 	
-	strcpy(msg, "Success");		//success message
-	LCD_write_str(msg, &LCDline);	//send message to LCD top line for 1s
-	_delay_ms(1000);
+	switch(addr){
+		case 0: *value = alarmEnable; break;
+		case 1: *value = PINset; break;
+		case 2: *value = zoneOpen; break;
+		case 3: *value = wrongPINCount; break;
+		case 4: *value = seconds & 0xFFFF; break;
+		case 5: *value = seconds >> 16; break;
+		case 6: *value = modbusCRCErrors; break;
+		case 7: *value = rxOverruns; break;
+		default: return 1;
+	}
+	return 0;
+}
+
+
+/*
+ * Function:  loadConfig
+ *  Reads the stored configuration, keeping the defaults if none is stored,
+ *  and applies it.
+ *
+ *  returns:    none
+ */
+void loadConfig(){
+	config_load(&config);
+	applyConfig();
 	return;
 }
 
 /*
- * Function:  selection
- *  calls start, enAlarm, and disAlarm functions based on current state of 
- *  system and input from keypad
+ * Function:  applyConfig
+ *  Copies the PIN, lockout limit and zone settings from the configuration.
  *
  *  returns:    none
  */
-void selection(){
-	if(PINset == 0){	//if pin is not set, call start function to indicate
-				//no pin is set and get pin
-		start();
-		pressedKey = -1;	//clear pressedKey
-		return;
+void applyConfig(){
+	lockLimit = config.lockoutLimit;
+	zones_init(config.zoneMask, config.entryZones, config.exitDelay, 
+		config.entryDelay);
+	for(int i = 0; i < PIN_LENGTH; i++){
+		if(config.pin[i] > 9){
+			return;			//no PIN stored, or a shorter one
+		}
 	}
-	displayMenu();		//display menu of alarm system options
-	getNewKey();		//wait for user input
-	
-	if(pressedKey == 0xC){	//if "C" is pressed, call enterCode to set the PIN
-		enterCode(1);
-		pressedKey = -1;	//clear pressedKey
-		return;
+#if PIN_LENGTH < CONFIG_PIN_DIGITS
+	if(config.pin[PIN_LENGTH] != 0xFF){
+		return;				//longer PIN, not cut short
 	}
-	
-	if(pressedKey == 0xA){	//if "A" is pressed, call enAlarm to set the alarm
-		enAlarm();
-		pressedKey = -1;	//clear pressedKey
-		return;
+#endif
+	for(int i = 0; i < PIN_LENGTH; i++){
+		pin[i] = config.pin[i];
 	}
-	
-	if(pressedKey == 0xD){	//if "D" is pressed, call disAlarm to disable the
-		disAlarm();	//alarm
-		pressedKey = -1;	//clear pressedKey
-		return;
+	PINset = 1;
+	return;
+}
+
+/*
+ * Function:  saveConfig
+ *  Stores the current PIN with the other settings.
+ *
+ *  returns:    none
+ */
+void saveConfig(){
+	for(int i = 0; i < CONFIG_PIN_DIGITS; i++){
+		config.pin[i] = (i < PIN_LENGTH) ? pin[i] : 0xFF;
 	}
-	
-	return;	//return if no conditions are met
+	if(config_save(&config) != 0){
+		fputs_P(PSTR("config write failed\n"), &USART0_OUT);
+	}
+	return;
 }
 
 /*
- * Function:  displayMenu
- *  prints menu options to the LCD screen for user to interact with security
- *  system.
+ * Function:  supervisorTickHook
+ *  System tick hook. Sends the display and comms heartbeats when those 
+ *  paths are moving, keeps the zone state in the reset record, and kicks 
+ *  the watchdog while all heartbeats arrive.
  *
  *  returns:    none
  */
-void displayMenu(){
-	//menu message
-	//Change pin option entirely wraps to second line of LCD
-	char str[32] = "A:Arm  D:Disarm C:Change Pin Num";
+void supervisorTickHook(){
+	uint8_t beats = 0;
 	
-	//clear lines
-	int line = 1;
-	LCD_clear_line(&line);
-	line = 0;
-	LCD_clear_line(&line);
+	if(LCDBusLock == 0){		//no LCD write in progress
+		beats |= BEAT_DISPLAY;
+	}
+	if((txTail == txHead) || (txTail != supervisorTail)){	//empty or moving
+		beats |= BEAT_COMMS;
+	}
+	supervisorTail = txTail;
+	wd_beat(beats);
 	
-	//print message
-	LCD_write_str(str, &line);
+	if(zoneState != savedZoneState){
+		savedZoneState = zoneState;
+		wd_save_state(&savedZoneState, 1);
+	}
+	wd_tick();
 	return;
 }
 
 /*
- * Function:  displayStart
- *  prints scrolling startup message for system
+ * Function:  restoreState
+ *  Starts the watchdog and, if the reset record is valid, puts the alarm 
+ *  back in the state it was in before the reset. Runs before the LCD is 
+ *  ready so the zones are armed again a few ms after the reset.
  *
  *  returns:    none
  */
-void displayStart(){
-	char str[20] = "System Setup    ";	//startup message
-	startScrollStr(str);			//scroll startup message
+void restoreState(){
+	if(!wd_init(BEAT_KEYPAD | BEAT_DISPLAY | BEAT_COMMS)){
+		return;
+	}
+	savedZoneState = wdRecord.state[0];
+	if((savedZoneState == ZONES_DISARMED) || (PINset == 0)){
+		return;
+	}
+	alarmEnable = 1;
+	zones_restore(savedZoneState);
+	if(savedZoneState == ZONES_ALARM){
+		siren_play(sirenAlarm);
+	}
+	restored = 1;
 	return;
 }
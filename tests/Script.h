@@ -0,0 +1,346 @@
+/*
+ * Script.h
+ *
+ * Header file for the tests that run a whole application on the host board
+ * model (host/board.h). A script of steps presses keys on the keypad
+ * matrix, with bounce and held keys, and waits for the frame each step
+ * ends on. The frame time, from the build's own clock, is checked against
+ * the step's latency budget, and the display text is checked SCRIPT_LOOK_MS
+ * after the frame, once a multiplexed display has lit every digit.
+ *
+ * Keys in a step:
+ *	0-9 A-D * #		press, held SCRIPT_HOLD_MS
+ *	~key			bouncing press, the contact chatters SCRIPT_BOUNCE times
+ *					as it closes and as it opens
+ *	=key			held SCRIPT_LONG_MS, still one key
+ *	!key			closed for SCRIPT_GLITCH_MS, shorter than a debounce, so
+ *					not a key
+ *	T				one second with no key
+ * Each key is SCRIPT_GAP_MS after the last one was let go.
+ *
+ * The test defines
+ *	unsigned long script_ms()		the build's clock, for frame times
+ *	void script_text(char* text)	display text now, SCRIPT_TEXT bytes
+ * and calls script_frame from displayTraceHook. script_run starts the board
+ * and returns when the script is done.
+ * Author : Jace Johnson
+ * Rev 1
+ * Designed to work with the host board model (Rev 1) and Test.h (Rev 1) by
+ * Jace Johnson
+ */
+
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+#include <stdio.h>
+#include <string.h>
+#include "board.h"
+#include "Test.h"
+
+#define SCRIPT_HOLD_MS 150		//key press
+#define SCRIPT_LONG_MS 1500		//held key
+#define SCRIPT_GLITCH_MS 20		//contact too short to be a key
+#define SCRIPT_GAP_MS 250		//between keys
+#define SCRIPT_BOUNCE 4			//chatter on each edge of a bouncing key
+#define SCRIPT_LOOK_MS 20		//frame to text check
+#define SCRIPT_LATE_MS 3000		//past the budget before a frame is missing
+#define SCRIPT_EVENTS 256		//key edges in a step
+#define SCRIPT_TEXT 40			//display text, 0 terminated
+#define SCRIPT_NO_FRAME -1		//view of a step that must not draw
+#define SCRIPT_ANY -1			//value of a step that takes any value
+
+//a step of a script
+typedef struct{
+	const char* keys;		//keys pressed, see above
+	int view;				//view the step ends on, or SCRIPT_NO_FRAME
+	int value;				//its value, or SCRIPT_ANY
+	const char* text;		//display text, '?' for any character, compared
+							//as far as it goes. 0 to not check
+	unsigned int budget;	//ms from the first contact of the last key, or
+							//the start of a step with no keys, to the frame
+}ScriptStep;
+
+//a key edge
+typedef struct{
+	uint64_t at;			//board cycle
+	int8_t key;				//BOARD_KEYS index
+	uint8_t down;			//1 closes the contact
+	uint8_t last;			//1 on the first contact of the last key
+}ScriptEvent;
+
+unsigned long script_ms();
+void script_text(char text[SCRIPT_TEXT]);
+void script_run(const ScriptStep* steps, int count, int (*entry)(void));
+void script_frame(int view, int value);
+void script_begin();
+void script_key(uint64_t* at, char mode, char key, int last);
+void script_step();
+void script_end();
+
+const ScriptStep* scriptSteps;	//the script
+int scriptCount = 0;		//steps in it
+int scriptAt = 0;			//step running
+ScriptEvent scriptEvents[SCRIPT_EVENTS];	//key edges of the step
+int scriptEventCount = 0;
+int scriptNextEvent = 0;	//next edge to make
+uint64_t scriptNext = 0;	//board cycle script_step next has work
+uint64_t scriptDone = 0;	//cycle the last key of the step is let go
+uint64_t scriptPressAt = 0;	//cycle the last key closed
+unsigned long scriptPressMs = 0;	//build's clock then
+uint8_t scriptPressed = 0;	//1 once the last key has closed
+uint8_t scriptMatched = 0;	//1 once the step's frame is drawn
+unsigned long scriptFrameMs = 0;	//build's clock at that frame
+uint64_t scriptLookAt = 0;	//cycle the text is checked, 0 when done
+int scriptFrames = 0;		//frames drawn in the step
+unsigned long scriptWorst = 0;	//longest key to frame time, ms
+int scriptKeys = 0;			//keys pressed so far, glitches left out
+
+
+/*
+ * Function:  script_run
+ *  Runs an application on the board with a script of steps. Every step's
+ *  frame, latency and text are checked.
+ *
+ *	steps	const ScriptStep*	the script
+ *	count	int					steps in it
+ *	entry	int (*)(void)		application main
+ *
+ *  returns:    none
+ */
+void script_run(const ScriptStep* steps, int count, int (*entry)(void)){
+	scriptSteps = steps;
+	scriptCount = count;
+	scriptAt = 0;
+	script_begin();
+	boardStepHook = script_step;
+	board_run(entry);
+	boardStepHook = 0;
+	CHECK(scriptAt == scriptCount);	//every step ran
+	return;
+}
+
+/*
+ * Function:  script_frame
+ *  Call from displayTraceHook. Takes the first frame after the last key of
+ *  the step that has the view and value it should end on.
+ *
+ *	view	int		view drawn
+ *	value	int		its value
+ *
+ *  returns:    none
+ */
+void script_frame(int view, int value){
+	const ScriptStep* s = &scriptSteps[scriptAt];
+
+	if(scriptAt >= scriptCount){	//after the script, s is past the end
+		return;
+	}
+	scriptFrames++;
+	if(scriptMatched || !scriptPressed || (view != s->view) ||
+	   ((s->value != SCRIPT_ANY) && (value != s->value))){
+		return;
+	}
+	scriptMatched = 1;
+	scriptFrameMs = script_ms();
+	scriptLookAt = boardCycles + BOARD_MS(SCRIPT_LOOK_MS);
+	scriptNext = 0;					//check it on the next step
+	return;
+}
+
+/*
+ * Function:  script_begin
+ *  Lays out the key edges of the step that is starting, from now on.
+ *
+ *  returns:    none
+ */
+void script_begin(){
+	const char* k = scriptSteps[scriptAt].keys;
+	const char* lastKey = 0;		//last key that is not a glitch
+	uint64_t at = boardCycles + BOARD_MS(1);
+
+	for(const char* c = k; *c != '\0'; c++){
+		if((*c != '~') && (*c != '=') && (*c != '!') && (*c != 'T') &&
+		   ((c == k) || (c[-1] != '!'))){
+			lastKey = c;
+		}
+	}
+	scriptEventCount = 0;
+	scriptNextEvent = 0;
+	for(; *k != '\0'; k++){
+		char mode = 0;
+
+		if((*k == '~') || (*k == '=') || (*k == '!')){
+			mode = *k++;
+		}
+		if(*k == 'T'){
+			at += BOARD_MS(1000);
+			continue;
+		}
+		script_key(&at, mode, *k, k == lastKey);
+	}
+	scriptDone = at;
+	scriptPressed = (lastKey == 0);	//a step with no keys starts now
+	scriptPressAt = boardCycles;
+	scriptPressMs = script_ms();
+	scriptMatched = 0;
+	scriptLookAt = 0;
+	scriptFrames = 0;
+	scriptNext = 0;
+	return;
+}
+
+/*
+ * Function:  script_key
+ *  Adds the edges of one key press.
+ *
+ *	at		uint64_t*	cycle of the first contact, moved on past the gap
+ *	mode	char		0, '~' bounce, '=' held or '!' glitch
+ *	key		char		key, one of BOARD_KEYS
+ *	last	int			1 for the last key of the step
+ *
+ *  returns:    none
+ */
+void script_key(uint64_t* at, char mode, char key, int last){
+	int index = board_key_index(key);
+	int edges = (mode == '~') ? 2 * SCRIPT_BOUNCE + 1 : 1;
+	uint32_t hold = (mode == '=') ? SCRIPT_LONG_MS :
+		(mode == '!') ? SCRIPT_GLITCH_MS : SCRIPT_HOLD_MS;
+	uint64_t t = *at;
+
+	if((index < 0) || (scriptEventCount + 4 * edges > SCRIPT_EVENTS)){
+		printf("step %d: bad key '%c'\n", scriptAt, key);
+		CHECK(0);
+		return;
+	}
+	for(int open = 0; open < 2; open++){
+		for(int e = 0; e < edges; e++){	//closes on even edges, opens on odd
+			ScriptEvent* ev = &scriptEvents[scriptEventCount++];
+
+			ev->at = t;
+			ev->key = index;
+			ev->down = ((e & 1) == 0) ^ open;
+			ev->last = last && !open && (e == 0);
+			t += BOARD_US(500 + 250 * e);	//chatter slows as it settles
+		}
+		if(!open){
+			t = *at + BOARD_MS(hold);
+		}
+	}
+	*at = t + BOARD_MS(SCRIPT_GAP_MS);
+	if(mode != '!'){
+		scriptKeys++;
+	}
+	return;
+}
+
+/*
+ * Function:  script_step
+ *  boardStepHook. Makes the key edges that are due, checks the step's text
+ *  a moment after its frame, and moves on to the next step once its keys
+ *  are done and its frame is checked or late.
+ *
+ *  returns:    none
+ */
+void script_step(){
+	uint64_t late;
+
+	if(boardCycles < scriptNext){
+		return;
+	}
+	while((scriptNextEvent < scriptEventCount) &&
+		  (scriptEvents[scriptNextEvent].at <= boardCycles)){
+		ScriptEvent* ev = &scriptEvents[scriptNextEvent++];
+
+		board_key(ev->key, ev->down);
+		if(ev->last){
+			scriptPressed = 1;
+			scriptPressAt = boardCycles;
+			scriptPressMs = script_ms();
+		}
+	}
+	scriptNext = (scriptNextEvent < scriptEventCount) ?
+		scriptEvents[scriptNextEvent].at : scriptDone;
+
+	if((scriptLookAt != 0) && (boardCycles >= scriptLookAt)){
+		const char* want = scriptSteps[scriptAt].text;
+		char text[SCRIPT_TEXT];
+		int ok = 1;
+
+		scriptLookAt = 0;
+		script_text(text);
+		for(int i = 0; (want != 0) && (want[i] != '\0'); i++){
+			if((want[i] != '?') && (want[i] != text[i])){
+				ok = 0;
+			}
+		}
+		if(!ok){
+			printf("step %d (%s): shows \"%s\", not \"%s\"\n", scriptAt,
+				scriptSteps[scriptAt].keys, text, want);
+		}
+		CHECK(ok);
+	}
+	if(scriptLookAt != 0){
+		if(scriptLookAt < scriptNext){
+			scriptNext = scriptLookAt;
+		}
+		return;
+	}
+
+	//the last key closes before scriptDone, so late is set by then
+	late = scriptPressAt + BOARD_MS(scriptSteps[scriptAt].budget +
+		SCRIPT_LATE_MS);
+	if((boardCycles < scriptDone) ||
+	   (!scriptMatched && (scriptSteps[scriptAt].view != SCRIPT_NO_FRAME) &&
+		(boardCycles < late))){
+		if(late < scriptNext){
+			scriptNext = late;
+		}
+		if(scriptNext <= boardCycles){
+			scriptNext = boardCycles + BOARD_MS(1);
+		}
+		return;
+	}
+	script_end();
+	if(++scriptAt >= scriptCount){
+		board_stop();
+	}
+	script_begin();
+	return;
+}
+
+/*
+ * Function:  script_end
+ *  Checks the step that has finished: its frame was drawn within budget,
+ *  or no frame was drawn for a step that should not draw.
+ *
+ *  returns:    none
+ */
+void script_end(){
+	const ScriptStep* s = &scriptSteps[scriptAt];
+	unsigned long latency = scriptFrameMs - scriptPressMs;
+
+	if(s->view == SCRIPT_NO_FRAME){
+		if(scriptFrames != 0){
+			printf("step %d (%s): %d frames, should be none\n", scriptAt,
+				s->keys, scriptFrames);
+		}
+		CHECK(scriptFrames == 0);
+		return;
+	}
+	if(!scriptMatched){
+		printf("step %d (%s): no frame of view %d value %d\n", scriptAt,
+			s->keys, s->view, s->value);
+	}
+	CHECK(scriptMatched);
+	if(scriptMatched && (latency > s->budget)){
+		printf("step %d (%s): frame %lu ms after the key, budget %u ms\n",
+			scriptAt, s->keys, latency, s->budget);
+	}
+	CHECK(!scriptMatched || (latency <= s->budget));
+	if(scriptMatched && (s->keys[0] != '\0') && (latency > scriptWorst)){
+		scriptWorst = latency;
+	}
+	return;
+}
+
+#endif /* SCRIPT_H_ */
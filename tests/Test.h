@@ -0,0 +1,45 @@
+/*
+ * Test.h
+ *
+ * Header file for the host tests. CHECK records a failure and carries on,
+ * so one run shows every broken check. test_done prints the result and is
+ * the exit code of the test.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+
+//record a failure if cond is false
+#define CHECK(cond) do{ \
+		testChecks++; \
+		if(!(cond)){ \
+			testFails++; \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		} \
+	}while(0)
+
+int test_done(const char* name);
+
+int testChecks = 0;		//checks run
+int testFails = 0;		//checks failed
+
+
+/*
+ * Function:  test_done
+ *  Prints the result of a test.
+ *
+ *  name	const char*		test name
+ *
+ *  returns:    0	every check passed
+ *		1	a check failed
+ */
+int test_done(const char* name){
+	printf("%s: %d checks, %d failed\n", name, testChecks, testFails);
+	return testFails != 0;
+}
+
+#endif /* TEST_H_ */
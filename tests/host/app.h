@@ -0,0 +1,138 @@
+/*
+ * app.h (host)
+ *
+ * Included ahead of an application main.c built on the host board model
+ * (board.h). Stands in for the parts of the application build that the
+ * tests of single headers do not need:
+ *	avr-libc streams	FILE is a put function, as FDEV_SETUP_STREAM makes
+ *						it, and the print functions send each character
+ *						to it. %S (a string in flash) prints as %s, and the
+ *						l size is dropped as long is 32 bits on the target
+ *	StackPaint.h		the stack is the host's, so the RAM figures are 0
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_APP_H_
+#define HOST_APP_H_
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include "board.h"
+
+//avr-libc stream
+typedef struct HostFILE{
+	int (*put)(char c, struct HostFILE* stream);
+	void* get;				//unused, the console reads the USART directly
+	int flags;
+}HostFILE;
+
+#define FILE HostFILE
+#undef FDEV_SETUP_STREAM
+#define FDEV_SETUP_STREAM(p, g, f) {(p), (void*)(g), (f)}
+#undef fprintf
+#undef vfprintf
+#undef fputs
+#undef fputc
+#define fprintf host_fprintf
+#define vfprintf host_vfprintf
+#define fputs host_fputs
+#define fputc host_fputc
+
+int host_vfprintf(HostFILE* stream, const char* fmt, va_list ap);
+int host_fprintf(HostFILE* stream, const char* fmt, ...);
+int host_fputs(const char* s, HostFILE* stream);
+int host_fputc(int c, HostFILE* stream);
+
+/*
+ * Function:  host_vfprintf
+ *  Prints to an avr-libc stream, up to 255 characters.
+ *
+ *  returns:    int		characters printed
+ */
+int host_vfprintf(HostFILE* stream, const char* fmt, va_list ap){
+	char f[256];
+	char out[256];
+	int n = 0;
+	int len;
+
+	while((*fmt != '\0') && (n < (int)sizeof(f) - 2)){
+		f[n++] = *fmt;
+		if(*fmt++ != '%'){
+			continue;
+		}
+		while((*fmt != '\0') && strchr("-+ #0123456789.", *fmt) &&
+			  (n < (int)sizeof(f) - 2)){
+			f[n++] = *fmt++;		//flags, width and precision
+		}
+		while(*fmt == 'l'){
+			fmt++;
+		}
+		if(*fmt != '\0'){
+			f[n++] = (*fmt == 'S') ? 's' : *fmt;
+			fmt++;
+		}
+	}
+	f[n] = '\0';
+	len = vsnprintf(out, sizeof(out), f, ap);
+	host_fputs(out, stream);
+	return len;
+}
+
+/*
+ * Function:  host_fprintf
+ *  Prints to an avr-libc stream.
+ *
+ *  returns:    int		characters printed
+ */
+int host_fprintf(HostFILE* stream, const char* fmt, ...){
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = host_vfprintf(stream, fmt, ap);
+	va_end(ap);
+	return len;
+}
+
+/*
+ * Function:  host_fputs
+ *  Writes a string to an avr-libc stream.
+ *
+ *  returns:    int		0
+ */
+int host_fputs(const char* s, HostFILE* stream){
+	while(*s != '\0'){
+		host_fputc(*s++, stream);
+	}
+	return 0;
+}
+
+/*
+ * Function:  host_fputc
+ *  Writes a character to an avr-libc stream.
+ *
+ *  returns:    int		c
+ */
+int host_fputc(int c, HostFILE* stream){
+	if(stream->put != 0){
+		stream->put(c, stream);
+	}
+	return c;
+}
+
+//the application defines F_CPU itself
+#undef F_CPU
+
+//StackPaint.h
+#define STACKPAINT_H_
+#define stack_check()
+#define ram_static() 0
+#define ram_heap() 0
+#define stack_max() 0
+#define stack_now() 0
+#define ram_free_min() 0
+
+#endif /* HOST_APP_H_ */
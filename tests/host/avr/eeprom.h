@@ -0,0 +1,34 @@
+/*
+ * avr/eeprom.h (host)
+ *
+ * Host stand in for the avr-libc EEPROM functions. The EEPROM is a RAM
+ * array in host.c, erased (0xFF) at start up. Tests read and write
+ * hostEEPROM directly to set up or corrupt a log.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+
+#define EEMEM
+
+extern uint8_t hostEEPROM[E2END + 1];	//EEPROM contents
+extern unsigned long hostEEPROMWrites;	//bytes changed by an update or write
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+uint16_t eeprom_read_word(const uint16_t* addr);
+void eeprom_read_block(void* dst, const void* src, size_t n);
+void eeprom_write_byte(uint8_t* addr, uint8_t value);
+void eeprom_update_byte(uint8_t* addr, uint8_t value);
+void eeprom_update_word(uint16_t* addr, uint16_t value);
+void eeprom_update_block(const void* src, void* dst, size_t n);
+
+#define eeprom_is_ready() 1
+#define eeprom_busy_wait()
+
+#endif /* HOST_EEPROM_H_ */
@@ -0,0 +1,23 @@
+/*
+ * avr/interrupt.h (host)
+ *
+ * Host stand in for avr-libc interrupts. An ISR is a plain function the
+ * test calls to play the interrupt, or the board model (board.c) calls
+ * when it is due. sei and cli set and clear the I bit in SREG, which the
+ * board model checks before it calls an ISR.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_INTERRUPT_H_
+#define HOST_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define sei() (SREG |= (1<<SREG_I))
+#define cli() (SREG &= (uint8_t)~(1<<SREG_I))
+
+#endif /* HOST_INTERRUPT_H_ */
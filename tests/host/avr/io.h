@@ -0,0 +1,222 @@
+/*
+ * avr/io.h (host)
+ *
+ * Host stand in for the ATmega2560 registers used by the panel headers.
+ * Each register is a plain variable, defined once in host.c, so a test can
+ * set an input pin or read back what a function wrote. The ports, pins and
+ * SREG are read through host_io, so a board model (board.c) can see each
+ * access as it happens and work out the pins first.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_IO_H_
+#define HOST_IO_H_
+
+#include <stdint.h>
+
+#ifndef HOST_REG
+#define HOST_REG extern		//host.c defines the registers
+#endif
+#define _R8(n) HOST_REG volatile uint8_t n;
+#define _R16(n) HOST_REG volatile uint16_t n;
+#define _RIO(n) HOST_REG volatile uint8_t host##n;
+
+//called before each port, pin or SREG access, 0 for none
+extern void (*hostIoHook)(volatile uint8_t* reg);
+
+static inline volatile uint8_t* host_io(volatile uint8_t* reg){
+	if(hostIoHook != 0){
+		hostIoHook(reg);
+	}
+	return reg;
+}
+
+_RIO(PORTA) _RIO(PORTB) _RIO(PORTC) _RIO(PORTD) _RIO(PORTE) _RIO(PORTF) _RIO(PORTG) _RIO(PORTH) _RIO(PORTJ) _RIO(PORTK) _RIO(PORTL)
+_RIO(PINA) _RIO(PINB) _RIO(PINC) _RIO(PIND) _RIO(PINE) _RIO(PINF) _RIO(PING) _RIO(PINH) _RIO(PINJ) _RIO(PINK) _RIO(PINL)
+_RIO(SREG)
+#define PORTA (*host_io(&hostPORTA))
+#define PORTB (*host_io(&hostPORTB))
+#define PORTC (*host_io(&hostPORTC))
+#define PORTD (*host_io(&hostPORTD))
+#define PORTE (*host_io(&hostPORTE))
+#define PORTF (*host_io(&hostPORTF))
+#define PORTG (*host_io(&hostPORTG))
+#define PORTH (*host_io(&hostPORTH))
+#define PORTJ (*host_io(&hostPORTJ))
+#define PORTK (*host_io(&hostPORTK))
+#define PORTL (*host_io(&hostPORTL))
+#define PINA (*host_io(&hostPINA))
+#define PINB (*host_io(&hostPINB))
+#define PINC (*host_io(&hostPINC))
+#define PIND (*host_io(&hostPIND))
+#define PINE (*host_io(&hostPINE))
+#define PINF (*host_io(&hostPINF))
+#define PING (*host_io(&hostPING))
+#define PINH (*host_io(&hostPINH))
+#define PINJ (*host_io(&hostPINJ))
+#define PINK (*host_io(&hostPINK))
+#define PINL (*host_io(&hostPINL))
+#define SREG (*host_io(&hostSREG))
+_R8(DDRA) _R8(DDRB) _R8(DDRC) _R8(DDRD) _R8(DDRE) _R8(DDRF) _R8(DDRG) _R8(DDRH) _R8(DDRJ) _R8(DDRK) _R8(DDRL)
+_R8(UCSR0A) _R8(UCSR0B) _R8(UCSR0C) _R8(UDR0) _R8(UBRR0L) _R8(UBRR0H) _R16(UBRR0)
+_R8(UCSR1A) _R8(UCSR1B) _R8(UCSR1C) _R8(UDR1) _R8(UBRR1L) _R8(UBRR1H) _R16(UBRR1)
+_R8(TCCR0A) _R8(TCCR0B) _R8(TCNT0) _R8(OCR0A) _R8(OCR0B) _R8(TIMSK0) _R8(TIFR0)
+_R8(TCCR1A) _R8(TCCR1B) _R8(TCCR1C) _R16(TCNT1) _R16(OCR1A) _R16(OCR1B) _R16(ICR1) _R8(TIMSK1) _R8(TIFR1)
+_R8(TCCR2A) _R8(TCCR2B) _R8(TCNT2) _R8(OCR2A) _R8(TIMSK2)
+_R8(TCCR3A) _R8(TCCR3B) _R16(TCNT3) _R16(OCR3A) _R8(TIMSK3) _R8(TIFR3)
+_R8(TCCR4A) _R8(TCCR4B) _R16(TCNT4) _R16(OCR4A) _R16(ICR4) _R8(TIMSK4) _R8(TIFR4)
+_R8(TCCR5A) _R8(TCCR5B) _R16(TCNT5) _R16(OCR5A) _R16(ICR5) _R8(TIMSK5) _R8(TIFR5)
+_R8(EICRA) _R8(EICRB) _R8(EIMSK) _R8(EIFR) _R8(PCICR) _R8(PCMSK2) _R8(PCIFR)
+_R8(MCUSR) _R8(WDTCSR) _R16(SP) _R8(GPIOR0)
+_R8(EECR) _R8(EEDR) _R16(EEAR)
+#define PORTB0 0
+#define PB0 0
+#define PB1 1
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PL0 0
+#define PL1 1
+#define PD4 4
+#define PE0 0
+#define PE1 1
+#define PE2 2
+#define PD2 2
+#define PD3 3
+#define PK0 0
+#define RXC0 7
+#define TXC0 6
+#define UDRE0 5
+#define FE0 4
+#define DOR0 3
+#define UPE0 2
+#define U2X0 1
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UCSZ01 2
+#define UCSZ00 1
+#define RXC1 7
+#define TXC1 6
+#define UDRE1 5
+#define FE1 4
+#define DOR1 3
+#define UPE1 2
+#define U2X1 1
+#define RXCIE1 7
+#define TXCIE1 6
+#define UDRIE1 5
+#define RXEN1 4
+#define TXEN1 3
+#define UCSZ11 2
+#define UCSZ10 1
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define ISC20 4
+#define ISC21 5
+#define ISC30 6
+#define ISC31 7
+#define INT0 0
+#define INT1 1
+#define INT2 2
+#define INT3 3
+#define INTF0 0
+#define INTF1 1
+#define INTF2 2
+#define INTF3 3
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define CS40 0
+#define CS41 1
+#define CS42 2
+#define CS50 0
+#define CS51 1
+#define CS52 2
+#define WGM01 1
+#define WGM00 0
+#define WGM12 3
+#define WGM32 3
+#define WGM42 3
+#define WGM52 3
+#define WGM21 1
+#define COM1A0 6
+#define COM1A1 7
+#define COM2A0 6
+#define ICES4 6
+#define ICNC4 7
+#define ICIE4 5
+#define ICF4 5
+#define TOIE0 0
+#define TOIE1 0
+#define TOIE3 0
+#define TOIE4 0
+#define TOIE5 0
+#define TOV4 0
+#define TOV5 0
+#define OCIE0A 1
+#define OCIE1A 1
+#define OCIE2A 1
+#define OCIE3A 1
+#define OCIE4A 1
+#define OCIE5A 1
+#define OCF5A 1
+#define OCF0A 1
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define JTRF 4
+#define WDCE 4
+#define WDE 3
+#define WDIE 6
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define PCIE2 2
+#define RAMEND 0x21FF
+#define RAMSTART 0x200
+#define E2END 0xFFF
+#define _BV(b) (1<<(b))
+#define bit_is_set(r,b) ((r)&_BV(b))
+#define bit_is_clear(r,b) (!((r)&_BV(b)))
+#define loop_until_bit_is_set(r,b) do{}while(bit_is_clear(r,b))
+#define loop_until_bit_is_clear(r,b) do{}while(bit_is_set(r,b))
+_R8(UCSR2A) _R8(UCSR2B) _R8(UCSR2C) _R8(UDR2) _R8(UBRR2L) _R8(UBRR2H) _R16(UBRR2)
+#define RXC2 7
+#define TXC2 6
+#define UDRE2 5
+#define FE2 4
+#define DOR2 3
+#define UPE2 2
+#define U2X2 1
+#define RXCIE2 7
+#define TXCIE2 6
+#define UDRIE2 5
+#define RXEN2 4
+#define TXEN2 3
+#define UPM21 5
+#define UPM20 4
+#define UCSZ21 2
+#define UCSZ20 1
+#define PH0 0
+#define PH1 1
+#define PH2 2
+#define SREG_I 7
+#endif /* HOST_IO_H_ */
@@ -0,0 +1,32 @@
+/*
+ * avr/pgmspace.h (host)
+ *
+ * Host stand in for avr-libc program memory access. Flash and RAM are the
+ * same address space on the host, so the _P functions are the plain ones.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_PGMSPACE_H_
+#define HOST_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(a) (*(const uint8_t*)(a))
+#define pgm_read_word(a) (*(const uint16_t*)(a))
+#define pgm_read_ptr(a) (*(void* const*)(a))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define printf_P printf
+#define fprintf_P fprintf
+#define fputs_P fputs
+
+#endif /* HOST_PGMSPACE_H_ */
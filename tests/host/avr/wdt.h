@@ -0,0 +1,26 @@
+/*
+ * avr/wdt.h (host)
+ *
+ * Host stand in for the avr-libc watchdog functions. There is no watchdog
+ * on the host, so they do nothing.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_WDT_H_
+#define HOST_WDT_H_
+
+#define WDTO_15MS 0
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+#define wdt_reset()
+#define wdt_enable(timeout)
+#define wdt_disable()
+
+#endif /* HOST_WDT_H_ */
@@ -0,0 +1,993 @@
+/*
+ * board.c
+ *
+ * Host board model (board.h). The application is built against the host
+ * headers, which call board_io before each port, pin and SREG access and
+ * board_delay for each _delay_ms and _delay_us.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <util/delay.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+
+#define BOARD_WRITE_CYCLES 4	//port write, or read-modify-write
+#define BOARD_READ_CYCLES 16	//pin or SREG read, usually in a wait loop
+#define BOARD_ISR_CYCLES 40		//interrupt entry, prologue and epilogue
+#define BOARD_BATCH_CYCLES 64	//clock moved on at most every 4 us
+#define BOARD_EE_CYCLES BOARD_US(3400)	//EEPROM byte write
+#define BOARD_SEG_DARK BOARD_MS(10)	//digit not lit for this long is dark
+#define BOARD_STALL_MS 10000	//main loop time without a step before the
+								//test is stopped
+#define BOARD_SPIN_US 50		//CPU time without an access before a loop
+								//is taken as spinning on a variable
+
+//weak, so an application without one of these interrupts still links
+#define BOARD_VECTOR(v) void v(void) __attribute__((weak));
+BOARD_VECTOR(INT0_vect) BOARD_VECTOR(INT1_vect) BOARD_VECTOR(INT2_vect)
+BOARD_VECTOR(INT3_vect) BOARD_VECTOR(TIMER0_COMPA_vect)
+BOARD_VECTOR(TIMER0_OVF_vect) BOARD_VECTOR(TIMER1_COMPA_vect)
+BOARD_VECTOR(TIMER1_OVF_vect) BOARD_VECTOR(TIMER3_COMPA_vect)
+BOARD_VECTOR(TIMER3_OVF_vect) BOARD_VECTOR(TIMER4_COMPA_vect)
+BOARD_VECTOR(TIMER4_OVF_vect) BOARD_VECTOR(TIMER5_COMPA_vect)
+BOARD_VECTOR(TIMER5_OVF_vect) BOARD_VECTOR(USART0_RX_vect)
+BOARD_VECTOR(USART0_UDRE_vect) BOARD_VECTOR(EE_READY_vect)
+
+//registers of a port
+typedef struct{
+	volatile uint8_t* port;
+	volatile uint8_t* ddr;
+	volatile uint8_t* pin;
+}BoardPort;
+
+//a timer, 8 bit (tcnt8) or 16 bit (tcnt16)
+typedef struct{
+	volatile uint8_t* tccrA;
+	volatile uint8_t* tccrB;
+	volatile uint8_t* timsk;
+	volatile uint8_t* tifr;
+	volatile uint8_t* tcnt8;
+	volatile uint8_t* ocr8;
+	volatile uint16_t* tcnt16;
+	volatile uint16_t* ocr16;
+	void (*compa)(void);	//compare A interrupt
+	void (*ovf)(void);		//overflow interrupt
+	uint32_t prescaled;		//cycles towards the next count
+	uint8_t flags;			//TOV (bit 0) and OCFA (bit 1) set
+}BoardTimer;
+
+void board_io(volatile uint8_t* reg);
+void board_delay(double us);
+void board_poll(uint32_t cycles);
+void board_advance(uint64_t cycles);
+void board_clock(uint64_t cycles);
+uint64_t board_next();
+int board_dispatch();
+void board_call(void (*isr)(void));
+void board_sample();
+uint8_t board_pins(int p);
+int board_out(BoardPin pin);
+void board_lcd_clock(int rs, int rw, uint8_t d);
+void board_lcd_byte(int rs, uint8_t b);
+void board_pace();
+void board_spin(int sig);
+
+volatile uint64_t boardCycles = 0;
+volatile unsigned long boardInterrupts = 0;
+void (*boardStepHook)(void) = 0;
+void (*boardUartOut)(uint8_t c) = 0;
+uint8_t boardRealTime = 0;
+BoardLCD boardLCD;
+uint8_t boardSeg[4];
+uint64_t boardSegLit[4];
+
+static const BoardPort boardPorts[12] = {
+	{&hostPORTA, &DDRA, &hostPINA}, {&hostPORTB, &DDRB, &hostPINB},
+	{&hostPORTC, &DDRC, &hostPINC}, {&hostPORTD, &DDRD, &hostPIND},
+	{&hostPORTE, &DDRE, &hostPINE}, {&hostPORTF, &DDRF, &hostPINF},
+	{&hostPORTG, &DDRG, &hostPING}, {&hostPORTH, &DDRH, &hostPINH},
+	{0, 0, 0},					//there is no port I
+	{&hostPORTJ, &DDRJ, &hostPINJ}, {&hostPORTK, &DDRK, &hostPINK},
+	{&hostPORTL, &DDRL, &hostPINL}
+};
+
+//in priority order, timer 1 is ahead of timer 0 on the ATmega2560
+static BoardTimer boardTimers[5] = {
+	{&TCCR1A, &TCCR1B, &TIMSK1, &TIFR1, 0, 0, &TCNT1, &OCR1A,
+		TIMER1_COMPA_vect, TIMER1_OVF_vect},
+	{&TCCR0A, &TCCR0B, &TIMSK0, &TIFR0, &TCNT0, &OCR0A, 0, 0,
+		TIMER0_COMPA_vect, TIMER0_OVF_vect},
+	{&TCCR3A, &TCCR3B, &TIMSK3, &TIFR3, 0, 0, &TCNT3, &OCR3A,
+		TIMER3_COMPA_vect, TIMER3_OVF_vect},
+	{&TCCR4A, &TCCR4B, &TIMSK4, &TIFR4, 0, 0, &TCNT4, &OCR4A,
+		TIMER4_COMPA_vect, TIMER4_OVF_vect},
+	{&TCCR5A, &TCCR5B, &TIMSK5, &TIFR5, 0, 0, &TCNT5, &OCR5A,
+		TIMER5_COMPA_vect, TIMER5_OVF_vect}
+};
+static void (* const boardInts[4])(void) = {
+	INT0_vect, INT1_vect, INT2_vect, INT3_vect
+};
+static const uint16_t boardPrescale[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+static BoardWiring wiring;			//set by board_init
+static uint8_t levels[12];			//input levels set by the test
+static uint16_t keysDown = 0;		//keypad keys held, bit per BOARD_KEYS
+static uint8_t intLevels = 0x0F;	//PD0 - PD3 at the last sample
+static uint8_t intFlags = 0;		//external interrupts 0 - 3 waiting
+static uint8_t lcdE = 0;			//LCD enable at the last sample
+static uint64_t udreAt = 0;			//cycle USART0 can take the next byte
+static uint64_t rxAt = 0;			//cycle the next byte arrives
+static char rxBuf[256];				//bytes still to arrive on USART0
+static uint8_t rxHead = 0;
+static uint8_t rxTail = 0;
+static uint64_t eeAt = 0;			//cycle the EEPROM write ends
+static volatile sig_atomic_t busy = 0;	//1 while the board model runs
+static uint32_t nested = 0;			//cycles spent in the interrupt running
+static uint32_t owed = 0;			//cycles used since the clock moved on
+static volatile unsigned long polls = 0;	//accesses and delays
+static unsigned long spinPolls = 0;	//polls at the last spin signal
+static uint64_t stepAt = 0;			//cycle the step hook was last called
+static struct timespec spinCPU;		//CPU time polls last moved or the clock
+									//last moved for a spin
+static sigjmp_buf boardExit;		//where board_stop goes
+static struct timespec paceStart;	//wall clock at cycle 0
+static uint64_t paceAt = 0;			//cycle of the next pace check
+
+
+/*
+ * Function:  board_init
+ *  Resets the board: clock, interrupt state, inputs (all high), keypad,
+ *  USART0, EEPROM timing and the LCD controller (8 bit mode, blank).
+ *
+ *	w	const BoardWiring*	what the application is wired to
+ *
+ *  returns:    none
+ */
+void board_init(const BoardWiring* w){
+	wiring = *w;
+	boardCycles = 0;
+	boardInterrupts = 0;
+	memset(levels, 0xFF, sizeof(levels));
+	keysDown = 0;
+	intLevels = 0x0F;
+	intFlags = 0;
+	lcdE = 0;
+	for(int i = 0; i < 5; i++){
+		boardTimers[i].prescaled = 0;
+		boardTimers[i].flags = 0;
+	}
+	udreAt = 0;
+	rxHead = rxTail = 0;
+	eeAt = 0;
+	hostSREG = 0;
+	UCSR0A = (1<<UDRE0);			//transmit buffer empty
+	memset(&boardLCD, 0, sizeof(boardLCD));
+	memset(boardLCD.ddram, ' ', sizeof(boardLCD.ddram));
+	boardLCD.bus8 = 1;
+	memset(boardSeg, 0, sizeof(boardSeg));
+	memset(boardSegLit, 0, sizeof(boardSegLit));
+	return;
+}
+
+/*
+ * Function:  board_run
+ *  Runs an application main on the board until board_stop is called.
+ *
+ *	entry	int (*)(void)	application main
+ *
+ *  returns:    none
+ */
+void board_run(int (*entry)(void)){
+	struct sigaction sa;
+	struct itimerval spin = {{0, BOARD_SPIN_US}, {0, BOARD_SPIN_US}};
+	struct itimerval off = {{0, 0}, {0, 0}};
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = board_spin;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &sa, 0);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &spinCPU);
+	clock_gettime(CLOCK_MONOTONIC, &paceStart);
+	paceAt = 0;
+	stepAt = boardCycles;
+	busy = 0;
+	hostIoHook = board_io;
+	hostDelayHook = board_delay;
+	if(sigsetjmp(boardExit, 1) == 0){
+		setitimer(ITIMER_REAL, &spin, 0);
+		entry();
+	}
+	setitimer(ITIMER_REAL, &off, 0);
+	hostIoHook = 0;
+	hostDelayHook = 0;
+	busy = 0;
+	nested = 0;
+	owed = 0;
+	return;
+}
+
+/*
+ * Function:  board_stop
+ *  Leaves the application and returns from board_run. Call from
+ *  boardStepHook.
+ *
+ *  returns:    does not return
+ */
+void board_stop(){
+	siglongjmp(boardExit, 1);
+}
+
+/*
+ * Function:  board_key
+ *  Closes or opens a keypad contact. Bounce is a few calls in a row.
+ *
+ *	key		int		index in BOARD_KEYS
+ *	down	int		1 closes the contact, 0 opens it
+ *
+ *  returns:    none
+ */
+void board_key(int key, int down){
+	if(down){
+		keysDown |= 1 << key;
+	}
+	else{
+		keysDown &= ~(1 << key);
+	}
+	board_sample();					//the keypad columns may have moved
+	return;
+}
+
+/*
+ * Function:  board_key_index
+ *  Finds a key on the keypad.
+ *
+ *	c		char	key as printed, one of BOARD_KEYS
+ *
+ *  returns:    int		index in BOARD_KEYS, -1 if there is no such key
+ */
+int board_key_index(char c){
+	const char* k = (c != 0) ? strchr(BOARD_KEYS, c) : 0;
+
+	return (k != 0) ? k - BOARD_KEYS : -1;
+}
+
+/*
+ * Function:  board_input
+ *  Sets the level outside an input pin, e.g. a zone contact. Pins are high
+ *  (pulled up) unless set.
+ *
+ *	port	char	A - L
+ *	bit		uint8_t	pin in the port
+ *	level	int		0 or 1
+ *
+ *  returns:    none
+ */
+void board_input(char port, uint8_t bit, int level){
+	if(level){
+		levels[port - 'A'] |= 1 << bit;
+	}
+	else{
+		levels[port - 'A'] &= ~(1 << bit);
+	}
+	board_sample();
+	return;
+}
+
+/*
+ * Function:  board_uart_in
+ *  Queues bytes to arrive on USART0, one per frame time at the baud rate
+ *  the application set.
+ *
+ *	s		const char*		bytes to send
+ *
+ *  returns:    none
+ */
+void board_uart_in(const char* s){
+	if(rxHead == rxTail){
+		rxAt = boardCycles;
+	}
+	for(; *s != '\0'; s++){
+		if((uint8_t)(rxHead + 1) == rxTail){
+			break;					//full, drop the rest
+		}
+		rxBuf[rxHead++] = *s;
+	}
+	return;
+}
+
+/*
+ * Function:  board_lcd_text
+ *  Reads the 16 visible characters of each LCD line out of the decoded
+ *  display RAM. Custom characters (0 - 15) read as '#' and the lines are
+ *  blank while the display is off.
+ *
+ *	text	char[2][17]		lines, 0 terminated
+ *
+ *  returns:    none
+ */
+void board_lcd_text(char text[2][17]){
+	for(int line = 0; line < 2; line++){
+		for(int i = 0; i < 16; i++){
+			char c = boardLCD.ddram[line * 0x40 + i];
+
+			if(!boardLCD.on){
+				c = ' ';
+			}
+			else if((uint8_t)c < 16){	//8 - 15 repeat 0 - 7
+				c = '#';
+			}
+			text[line][i] = c;
+		}
+		text[line][16] = '\0';
+	}
+	return;
+}
+
+/*
+ * Function:  board_seg_digit
+ *  Reads a 7 segment digit, as lit by the multiplexing, through the
+ *  application's segment table.
+ *
+ *	digit		int				0 - 3, left to right
+ *	patterns	const uint8_t[]	segment pattern of each character
+ *	chars		const char*		the characters
+ *	n			int				characters in the table
+ *
+ *  returns:    char	character lit, ' ' if the digit is dark, '?' if the
+ *				pattern is not in the table
+ */
+char board_seg_digit(int digit, const uint8_t patterns[], const char* chars, int n){
+	if(boardCycles - boardSegLit[digit] > BOARD_SEG_DARK){
+		return ' ';
+	}
+	for(int i = 0; i < n; i++){
+		if(patterns[i] == boardSeg[digit]){
+			return chars[i];
+		}
+	}
+	return '?';
+}
+
+/*
+ * Function:  board_io
+ *  hostIoHook. Looks at the pins after the last access, moves the clock
+ *  on and works out a pin register before it is read.
+ *
+ *	reg		volatile uint8_t*	register about to be accessed
+ *
+ *  returns:    none
+ */
+void board_io(volatile uint8_t* reg){
+	int p = -1;						//port of a pin register
+
+	for(int i = 0; i < 12; i++){
+		if((boardPorts[i].pin != 0) && (reg == boardPorts[i].pin)){
+			p = i;
+			break;
+		}
+	}
+	board_sample();
+	board_poll(((p >= 0) || (reg == &hostSREG)) ? BOARD_READ_CYCLES :
+		BOARD_WRITE_CYCLES);
+	if(p >= 0){
+		*reg = board_pins(p);
+	}
+	return;
+}
+
+/*
+ * Function:  board_delay
+ *  hostDelayHook. Moves the clock on by a busy wait delay.
+ *
+ *	us		double	delay in us
+ *
+ *  returns:    none
+ */
+void board_delay(double us){
+	board_sample();
+	board_poll(us * (BOARD_HZ / 1000000));
+	return;
+}
+
+/*
+ * Function:  board_poll
+ *  Moves the clock on for code the application has run, calling the
+ *  interrupts that fall due, then the step hook. The clock moves in
+ *  batches of BOARD_BATCH_CYCLES, so an interrupt may be called a few us
+ *  late. Time spent in an interrupt is added when it returns.
+ *
+ *	cycles	uint32_t	CPU cycles used
+ *
+ *  returns:    none
+ */
+void board_poll(uint32_t cycles){
+	polls++;
+	if(busy){						//in an interrupt, or the step hook
+		nested += cycles;
+		return;
+	}
+	owed += cycles;
+	if(owed < BOARD_BATCH_CYCLES){
+		return;
+	}
+	busy = 1;
+	board_advance(owed);
+	owed = 0;
+	if(boardRealTime){
+		board_pace();
+	}
+	stepAt = boardCycles;
+	if(boardStepHook != 0){
+		boardStepHook();
+	}
+	busy = 0;
+	return;
+}
+
+/*
+ * Function:  board_advance
+ *  Moves the clock on, stopping at each timer, USART and EEPROM event to
+ *  call an interrupt that is due.
+ *
+ *	cycles	uint64_t	CPU cycles
+ *
+ *  returns:    none
+ */
+void board_advance(uint64_t cycles){
+	uint64_t step;
+
+	board_dispatch();
+	while(cycles > 0){
+		step = board_next();
+		if(step > cycles){
+			step = cycles;
+		}
+		board_clock(step);
+		cycles -= step;
+		board_dispatch();
+	}
+	return;
+}
+
+/*
+ * Function:  board_next
+ *  Finds the cycles to the next timer, USART or EEPROM event.
+ *
+ *  returns:    uint64_t	cycles, at least 1, UINT64_MAX for none
+ */
+uint64_t board_next(){
+	uint64_t next = UINT64_MAX;
+	uint64_t c;
+
+	for(int i = 0; i < 5; i++){
+		BoardTimer* t = &boardTimers[i];
+		uint16_t prescale = boardPrescale[*t->tccrB & 0x07];
+		uint32_t count, ocr, max, counts;
+		int ctc;
+
+		if(prescale == 0){			//stopped
+			continue;
+		}
+		if(t->tcnt8 != 0){
+			count = *t->tcnt8;
+			ocr = *t->ocr8;
+			max = 0xFF;
+			ctc = *t->tccrA & (1<<WGM01);
+		}
+		else{
+			count = *t->tcnt16;
+			ocr = *t->ocr16;
+			max = 0xFFFF;
+			ctc = *t->tccrB & (1<<3);	//WGMn2
+		}
+		if(ctc && (count <= ocr)){	//cleared after TOP
+			counts = ocr - count + 1;
+		}
+		else{
+			counts = max - count + 1;
+			if(!ctc && (count < ocr)){	//compare match on the way
+				counts = ocr - count;
+			}
+		}
+		c = (uint64_t)counts * prescale - t->prescaled;
+		if(c < next){
+			next = c;
+		}
+	}
+	if((UCSR0B & (1<<UDRIE0)) && (udreAt > boardCycles) &&
+	   (udreAt - boardCycles < next)){
+		next = udreAt - boardCycles;
+	}
+	if((rxHead != rxTail) && (rxAt > boardCycles) &&
+	   (rxAt - boardCycles < next)){
+		next = rxAt - boardCycles;
+	}
+	if((EECR & (1<<EERIE)) && (eeAt > boardCycles) &&
+	   (eeAt - boardCycles < next)){
+		next = eeAt - boardCycles;
+	}
+	return (next > 0) ? next : 1;
+}
+
+/*
+ * Function:  board_clock
+ *  Moves the clock and the timers on, no further than the next event, and
+ *  sets the timer flags. Bytes arriving on USART0 are put in UDR0.
+ *
+ *	cycles	uint64_t	CPU cycles, at most board_next
+ *
+ *  returns:    none
+ */
+void board_clock(uint64_t cycles){
+	uint32_t frame = ((UCSR0A & (1<<U2X0)) ? 8 : 16) *
+		((UBRR0 ? UBRR0 : (UBRR0H << 8) | UBRR0L) + 1) * 10;
+
+	boardCycles += cycles;
+	for(int i = 0; i < 5; i++){
+		BoardTimer* t = &boardTimers[i];
+		uint16_t prescale = boardPrescale[*t->tccrB & 0x07];
+		uint32_t count, old, ocr, max, n;
+		int ctc;
+
+		if(prescale == 0){
+			continue;
+		}
+		t->prescaled += cycles;
+		n = t->prescaled / prescale;
+		t->prescaled %= prescale;
+		if(n == 0){
+			continue;
+		}
+		if(t->tcnt8 != 0){
+			count = *t->tcnt8;
+			ocr = *t->ocr8;
+			max = 0xFF;
+			ctc = *t->tccrA & (1<<WGM01);
+		}
+		else{
+			count = *t->tcnt16;
+			ocr = *t->ocr16;
+			max = 0xFFFF;
+			ctc = *t->tccrB & (1<<3);
+		}
+		old = count;
+		count += n;
+		if(ctc && (old <= ocr) && (count > ocr)){	//cleared after TOP
+			count = 0;
+			t->flags |= 0x02;
+		}
+		else if(count > max){
+			count = 0;
+			t->flags |= 0x01;
+		}
+		else if(!ctc && (old < ocr) && (count == ocr)){
+			t->flags |= 0x02;
+		}
+		if(t->tcnt8 != 0){
+			*t->tcnt8 = count;
+		}
+		else{
+			*t->tcnt16 = count;
+		}
+	}
+	if((rxHead != rxTail) && (boardCycles >= rxAt) &&
+	   !(UCSR0A & (1<<RXC0))){
+		UDR0 = rxBuf[rxTail++];
+		UCSR0A |= (1<<RXC0);
+		rxAt = boardCycles + frame;
+	}
+	return;
+}
+
+/*
+ * Function:  board_dispatch
+ *  Calls the interrupt with the highest priority that is due, if the I
+ *  bit is set. Only one is called, so the application runs between them
+ *  as on the target. Flag registers written by the application clear the
+ *  flags they have ones for.
+ *
+ *  returns:    int		1 if an interrupt was called
+ */
+int board_dispatch(){
+	uint8_t pins;
+
+	intFlags &= ~EIFR;
+	EIFR = 0;
+	for(int i = 0; i < 5; i++){
+		boardTimers[i].flags &= ~*boardTimers[i].tifr;
+		*boardTimers[i].tifr = 0;
+	}
+	if(!(hostSREG & (1<<SREG_I))){
+		return 0;
+	}
+
+	pins = board_pins(3);			//INT0 - INT3 are PD0 - PD3
+	for(int n = 0; n < 4; n++){
+		if(!(EIMSK & (1 << n)) || (boardInts[n] == 0)){
+			continue;
+		}
+		if((((EICRA >> (2 * n)) & 0x03) == 0) && !(pins & (1 << n))){
+			board_call(boardInts[n]);	//low level, for as long as it is low
+			return 1;
+		}
+		if(intFlags & (1 << n)){
+			intFlags &= ~(1 << n);
+			board_call(boardInts[n]);
+			return 1;
+		}
+	}
+	for(int i = 0; i < 5; i++){
+		BoardTimer* t = &boardTimers[i];
+
+		if(i == 2){					//USART0 and EEPROM come before timer 3
+			if((UCSR0B & (1<<RXCIE0)) && (UCSR0A & (1<<RXC0)) &&
+			   (USART0_RX_vect != 0)){
+				UCSR0A &= ~(1<<RXC0);	//as the ISR reads UDR0
+				board_call(USART0_RX_vect);
+				return 1;
+			}
+			if((UCSR0B & (1<<UDRIE0)) && (boardCycles >= udreAt) &&
+			   (USART0_UDRE_vect != 0)){
+				board_call(USART0_UDRE_vect);
+				if(UCSR0B & (1<<UDRIE0)){	//still on, so it wrote UDR0
+					udreAt = boardCycles + ((UCSR0A & (1<<U2X0)) ? 8 : 16) *
+						((UBRR0 ? UBRR0 : (UBRR0H << 8) | UBRR0L) + 1) * 10;
+					if(boardUartOut != 0){
+						boardUartOut(UDR0);
+					}
+				}
+				return 1;
+			}
+			if((EECR & (1<<EERIE)) && (boardCycles >= eeAt) &&
+			   (EE_READY_vect != 0)){
+				board_call(EE_READY_vect);
+				if(EECR & (1<<EEPE)){	//write started
+					hostEEPROM[EEAR & E2END] = EEDR;
+					hostEEPROMWrites++;
+					EECR &= ~((1<<EEPE)|(1<<EEMPE));
+					eeAt = boardCycles + BOARD_EE_CYCLES;
+				}
+				return 1;
+			}
+		}
+		if((t->flags & 0x02) && (*t->timsk & 0x02) && (t->compa != 0)){
+			t->flags &= ~0x02;
+			board_call(t->compa);
+			return 1;
+		}
+		if((t->flags & 0x01) && (*t->timsk & 0x01) && (t->ovf != 0)){
+			t->flags &= ~0x01;
+			board_call(t->ovf);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Function:  board_call
+ *  Calls an interrupt with the I bit clear, as the target does, then moves
+ *  the clock on by the time it took.
+ *
+ *	isr		void (*)(void)	interrupt
+ *
+ *  returns:    none
+ */
+void board_call(void (*isr)(void)){
+	uint64_t cycles;
+	uint64_t step;
+
+	boardInterrupts++;
+	hostSREG &= ~(1<<SREG_I);
+	nested = BOARD_ISR_CYCLES;
+	isr();
+	hostSREG |= (1<<SREG_I);		//reti
+	board_sample();
+	cycles = nested;
+	nested = 0;
+	while(cycles > 0){				//flags set meanwhile wait for the
+		step = board_next();		//next dispatch
+		if(step > cycles){
+			step = cycles;
+		}
+		board_clock(step);
+		cycles -= step;
+	}
+	return;
+}
+
+/*
+ * Function:  board_sample
+ *  Looks at the pins as the last access left them: clocks the LCD on a
+ *  falling enable, records the lit 7 segment digit and sets the external
+ *  interrupt flags for edges on PD0 - PD3.
+ *
+ *  returns:    none
+ */
+void board_sample(){
+	uint8_t pins;
+	uint8_t lit;
+
+	if(wiring.lcdE.port != 0){
+		int e = board_out(wiring.lcdE) &&	//undriven, it is pulled low
+			(*boardPorts[wiring.lcdE.port - 'A'].ddr & (1 << wiring.lcdE.bit));
+
+		if(lcdE && !e){
+			board_lcd_clock(board_out(wiring.lcdRS),
+				(wiring.lcdRW.port != 0) ? board_out(wiring.lcdRW) : 0,
+				*boardPorts[wiring.lcdData - 'A'].port &
+				*boardPorts[wiring.lcdData - 'A'].ddr);
+		}
+		lcdE = e;
+	}
+	if(wiring.segPort != 0){
+		uint8_t segs = *boardPorts[wiring.segPort - 'A'].port;
+
+		lit = ~*boardPorts[wiring.segDigitPort - 'A'].port & 0x0F;
+		//one digit lit, with no segments it shows nothing
+		if((lit != 0) && ((lit & (lit - 1)) == 0) && (segs != 0)){
+			int d = __builtin_ctz(lit);
+
+			boardSeg[d] = segs;
+			boardSegLit[d] = boardCycles;
+		}
+	}
+
+	if(EICRA == 0){					//all low level, no edges to look for
+		return;
+	}
+	pins = board_pins(3) & 0x0F;
+	for(int n = 0; n < 4; n++){
+		uint8_t bit = 1 << n;
+		int fall = (intLevels & bit) && !(pins & bit);
+		int rise = !(intLevels & bit) && (pins & bit);
+
+		switch((EICRA >> (2 * n)) & 0x03){
+			case 1:					//any edge
+				fall |= rise;
+				//fall through
+			case 2:					//falling edge
+				if(fall){
+					intFlags |= bit;
+				}
+				break;
+			case 3:					//rising edge
+				if(rise){
+					intFlags |= bit;
+				}
+				break;
+		}
+	}
+	intLevels = pins;
+	return;
+}
+
+/*
+ * Function:  board_pins
+ *  Works out the levels on a port: outputs as written, inputs as set by
+ *  board_input, pulled low through a closed key by a keypad line driven
+ *  low, and the LCD data lines while it is read.
+ *
+ *	p		int		port, 0 for A
+ *
+ *  returns:    uint8_t		pin levels
+ */
+uint8_t board_pins(int p){
+	uint8_t ddr = *boardPorts[p].ddr;
+	uint8_t pins = (*boardPorts[p].port & ddr) | (levels[p] & ~ddr);
+
+	for(int k = 0; (keysDown >> k) != 0; k++){
+		BoardPin row = wiring.rows[k / 4];
+		BoardPin col = wiring.cols[k % 4];
+
+		if(!(keysDown & (1 << k))){
+			continue;
+		}
+		if((col.port - 'A' == p) && !(ddr & (1 << col.bit)) &&
+		   (board_out(row) == 0)){
+			pins &= ~(1 << col.bit);
+		}
+		if((row.port - 'A' == p) && !(ddr & (1 << row.bit)) &&
+		   (board_out(col) == 0)){
+			pins &= ~(1 << row.bit);
+		}
+	}
+	if((wiring.lcdE.port != 0) && (wiring.lcdData - 'A' == p) &&
+	   (wiring.lcdRW.port != 0) && board_out(wiring.lcdRW) &&
+	   board_out(wiring.lcdE)){
+		//never busy, address counter reads as 0
+		pins &= ddr | (wiring.lcdBus8 ? 0x00 : 0x0F);
+	}
+	return pins;
+}
+
+/*
+ * Function:  board_out
+ *  Level of a pin: as written if it is an output, otherwise as set by
+ *  board_input.
+ *
+ *	pin		BoardPin	pin
+ *
+ *  returns:    int		0 or 1
+ */
+int board_out(BoardPin pin){
+	const BoardPort* p = &boardPorts[pin.port - 'A'];
+	uint8_t bit = 1 << pin.bit;
+
+	if(*p->ddr & bit){
+		return (*p->port & bit) != 0;
+	}
+	return (levels[pin.port - 'A'] & bit) != 0;
+}
+
+/*
+ * Function:  board_lcd_clock
+ *  A falling enable on the LCD. Writes take the data lines, two nybbles to
+ *  a byte in 4 bit mode. Reads only count.
+ *
+ *	rs		int			register select, 1 for data
+ *	rw		int			1 for a read
+ *	d		uint8_t		data port
+ *
+ *  returns:    none
+ */
+void board_lcd_clock(int rs, int rw, uint8_t d){
+	boardLCD.pulses++;
+	if(!wiring.lcdBus8){
+		d &= 0xF0;					//D0 - D3 are not wired
+	}
+	if(boardLCD.bus8){
+		if(!rw){
+			board_lcd_byte(rs, d);
+		}
+		return;
+	}
+	if(!boardLCD.nybble){
+		boardLCD.high = d & 0xF0;
+		boardLCD.nybble = 1;
+		return;
+	}
+	boardLCD.nybble = 0;
+	if(!rw){
+		board_lcd_byte(rs, boardLCD.high | (d >> 4));
+	}
+	return;
+}
+
+/*
+ * Function:  board_lcd_byte
+ *  Runs an HD44780 instruction or writes a data byte. Cursor and display
+ *  shifts are not modelled.
+ *
+ *	rs		int			1 for data
+ *	b		uint8_t		byte
+ *
+ *  returns:    none
+ */
+void board_lcd_byte(int rs, uint8_t b){
+	if(rs){
+		boardLCD.data++;
+		if(boardLCD.cgMode){
+			boardLCD.cgram[boardLCD.addr++ & 0x3F] = b;
+			return;
+		}
+		boardLCD.ddram[boardLCD.addr & 0x7F] = b;
+		boardLCD.addr = (boardLCD.addr + 1) & 0x7F;
+		if((boardLCD.addr & 0x3F) == 0x28){	//end of a line
+			boardLCD.addr = (boardLCD.addr & 0x40) ^ 0x40;
+		}
+		return;
+	}
+
+	boardLCD.instructions++;
+	if(b & 0x80){					//DDRAM address
+		boardLCD.addr = b & 0x7F;
+		boardLCD.cgMode = 0;
+	}
+	else if(b & 0x40){				//CGRAM address
+		boardLCD.addr = b & 0x3F;
+		boardLCD.cgMode = 1;
+	}
+	else if(b & 0x20){				//function set
+		boardLCD.bus8 = (b & 0x10) != 0;
+		boardLCD.nybble = 0;
+	}
+	else if(b & 0x08){				//display control
+		boardLCD.on = (b & 0x04) != 0;
+	}
+	else if(b & 0x02){				//home
+		boardLCD.addr = 0;
+		boardLCD.cgMode = 0;
+	}
+	else if(b == 0x01){				//clear
+		memset(boardLCD.ddram, ' ', sizeof(boardLCD.ddram));
+		boardLCD.addr = 0;
+		boardLCD.cgMode = 0;
+	}
+	return;
+}
+
+/*
+ * Function:  board_pace
+ *  Sleeps while the clock is ahead of the wall clock, checked once a
+ *  simulated millisecond.
+ *
+ *  returns:    none
+ */
+void board_pace(){
+	struct timespec now;
+	int64_t ahead;					//ns
+
+	if(boardCycles < paceAt){
+		return;
+	}
+	paceAt = boardCycles + BOARD_MS(1);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ahead = (int64_t)(boardCycles * 1000 / (BOARD_HZ / 1000000)) -
+		((int64_t)(now.tv_sec - paceStart.tv_sec) * 1000000000 +
+		(now.tv_nsec - paceStart.tv_nsec));
+	if(ahead > 1000000){
+		struct timespec until = now;
+
+		until.tv_sec += (now.tv_nsec + ahead) / 1000000000;
+		until.tv_nsec = (now.tv_nsec + ahead) % 1000000000;
+		//the spin signal comes sooner than a relative sleep's slack, so
+		//that would never end. A sleep to a set time ends once it is past
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, 0) != 0){}
+	}
+	return;
+}
+
+/*
+ * Function:  board_spin
+ *  SIGALRM handler, every BOARD_SPIN_US of wall clock. If the application
+ *  has used BOARD_SPIN_US of CPU time without touching a port, pin or SREG
+ *  or delaying, it is spinning on a variable that only an interrupt
+ *  changes, so the clock is moved on to the next event, at most 1 ms. If
+ *  it spins for BOARD_STALL_MS, e.g. as an interrupt that never clears
+ *  keeps the one it waits on from running, the test is stopped. The
+ *  CPU time is what counts, so a test that is not running is not moved on.
+ *
+ *	sig		int		signal
+ *
+ *  returns:    none
+ */
+void board_spin(int sig){
+	struct timespec now;
+	uint64_t step;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	if(busy || (polls != spinPolls)){
+		spinPolls = polls;
+		spinCPU = now;
+		return;
+	}
+	if((now.tv_sec - spinCPU.tv_sec) * 1000000000L +
+	   (now.tv_nsec - spinCPU.tv_nsec) < BOARD_SPIN_US * 1000L){
+		return;
+	}
+	spinCPU = now;
+	busy = 1;
+	step = board_next();
+	if(step > BOARD_MS(1)){
+		step = BOARD_MS(1);
+	}
+	board_advance(step);
+	if(boardCycles - stepAt > BOARD_MS(BOARD_STALL_MS)){
+		static const char stall[] = "board: application stalled, only "
+			"interrupts run\n";
+
+		write(2, stall, sizeof(stall) - 1);
+		_exit(1);
+	}
+	busy = 0;
+	return;
+}
@@ -0,0 +1,92 @@
+/*
+ * board.h (host)
+ *
+ * Header file for the host board model. Runs an application main, built
+ * against the host headers, on a simulated ATmega2560 at 16 MHz: timers 0,
+ * 1, 3, 4 and 5 (normal and CTC modes), external interrupts 0 - 3, USART0
+ * and the EEPROM ready interrupt. Input pins are worked out from a 4x4
+ * keypad matrix and the levels set by the test, and the port writes are
+ * decoded as an HD44780 LCD and a four digit 7 segment display.
+ *
+ * The clock moves on at each port, pin or SREG access and at each delay,
+ * and the interrupts that are due are called there while the I bit is
+ * set, one at a time as on the target. A loop that only reads variables,
+ * e.g. while(!LCDReady){}, is caught by a timer signal that sees CPU time
+ * used with no access, and the clock is moved on to the next interrupt. A
+ * loop that spins for 10 s of board time stops the test as a failure.
+ * Interrupt flag registers read as 0 and writing ones to them clears the
+ * flags, so code that polls a flag, e.g. the USART0 autobaud, does not run
+ * here.
+ *
+ *	board_init(&wiring);		reset the board
+ *	boardStepHook = step;		called from the main loop as the clock moves
+ *	board_run(app_main);		returns once step calls board_stop
+ *
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdint.h>
+
+#define BOARD_HZ 16000000ULL					//CPU clock
+#define BOARD_US(us) ((uint64_t)(us) * (BOARD_HZ / 1000000))
+#define BOARD_MS(ms) ((uint64_t)(ms) * (BOARD_HZ / 1000))
+#define BOARD_KEYS "123A456B789C*0#D"		//keypad, by row then column
+
+//an I/O pin, e.g. {'C', 3} for PC3
+typedef struct{
+	char port;			//A - L, 0 for not wired
+	uint8_t bit;
+}BoardPin;
+
+//what the application is wired to
+typedef struct{
+	BoardPin rows[4];		//keypad rows, top to bottom
+	BoardPin cols[4];		//keypad columns, left to right
+	BoardPin lcdE;			//LCD enable, port 0 for no LCD
+	BoardPin lcdRS;
+	BoardPin lcdRW;			//port 0 when RW is tied to GND
+	char lcdData;			//port with D4 - D7 on the high nybble
+	uint8_t lcdBus8;		//1 if D0 - D7 are wired to the whole port
+	char segPort;			//7 segment segments, 0 for no display
+	char segDigitPort;		//digit enables on the low nybble, active low
+}BoardWiring;
+
+//HD44780 controller as decoded from the enable pulses
+typedef struct{
+	char ddram[0x80];		//display RAM, line 2 starts at 0x40
+	uint8_t cgram[64];		//custom character rows
+	uint8_t addr;			//address counter
+	uint8_t cgMode;			//1 if the address counter is in CGRAM
+	uint8_t bus8;			//1 in 8 bit mode, as after power up
+	uint8_t nybble;			//1 when the high nybble has been clocked
+	uint8_t high;			//high nybble of the byte being clocked
+	uint8_t on;				//1 if the display is on
+	uint32_t instructions;	//instructions written
+	uint32_t data;			//characters and CGRAM rows written
+	uint32_t pulses;		//enable pulses, reads included
+}BoardLCD;
+
+void board_init(const BoardWiring* wiring);
+void board_run(int (*entry)(void));
+void board_stop();
+void board_key(int key, int down);
+int board_key_index(char c);
+void board_input(char port, uint8_t bit, int level);
+void board_uart_in(const char* s);
+void board_lcd_text(char text[2][17]);
+char board_seg_digit(int digit, const uint8_t patterns[], const char* chars, int n);
+
+extern volatile uint64_t boardCycles;		//CPU cycles since board_init
+extern volatile unsigned long boardInterrupts;	//interrupts called
+extern void (*boardStepHook)(void);		//called from the main loop
+extern void (*boardUartOut)(uint8_t c);	//byte sent on USART0
+extern uint8_t boardRealTime;			//1 to keep the clock to the wall clock
+extern BoardLCD boardLCD;
+extern uint8_t boardSeg[4];				//segments last lit on each digit
+extern uint64_t boardSegLit[4];			//cycle each digit was last lit
+
+#endif /* BOARD_H_ */
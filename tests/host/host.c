@@ -0,0 +1,113 @@
+/*
+ * host.c
+ *
+ * Definitions behind the host stand in headers: the registers, the access
+ * and delay hooks and the EEPROM array. Linked into every test.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#define HOST_REG		//define the registers declared in avr/io.h
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <util/delay.h>
+#include <string.h>
+
+void (*hostIoHook)(volatile uint8_t* reg) = 0;	//set by board.c
+void (*hostDelayHook)(double us) = 0;			//set by board.c
+uint8_t hostEEPROM[E2END + 1];
+unsigned long hostEEPROMWrites = 0;
+
+/*
+ * Function:  host_eeprom_init
+ *  Erases the EEPROM before main runs, as on a new part.
+ *
+ *  returns:    none
+ */
+__attribute__((constructor)) static void host_eeprom_init(){
+	memset(hostEEPROM, 0xFF, sizeof(hostEEPROM));
+	return;
+}
+
+/*
+ * Function:  eeprom_read_byte
+ *  Reads an EEPROM byte.
+ *
+ *  returns:    uint8_t		byte at addr
+ */
+uint8_t eeprom_read_byte(const uint8_t* addr){
+	return hostEEPROM[(uintptr_t)addr];
+}
+
+/*
+ * Function:  eeprom_read_word
+ *  Reads an EEPROM word, low byte first.
+ *
+ *  returns:    uint16_t	word at addr
+ */
+uint16_t eeprom_read_word(const uint16_t* addr){
+	uintptr_t a = (uintptr_t)addr;
+
+	return hostEEPROM[a] | (hostEEPROM[a + 1] << 8);
+}
+
+/*
+ * Function:  eeprom_read_block
+ *  Reads n EEPROM bytes from src into dst.
+ *
+ *  returns:    none
+ */
+void eeprom_read_block(void* dst, const void* src, size_t n){
+	memcpy(dst, &hostEEPROM[(uintptr_t)src], n);
+	return;
+}
+
+/*
+ * Function:  eeprom_write_byte
+ *  Writes an EEPROM byte and counts the write.
+ *
+ *  returns:    none
+ */
+void eeprom_write_byte(uint8_t* addr, uint8_t value){
+	hostEEPROM[(uintptr_t)addr] = value;
+	hostEEPROMWrites++;
+	return;
+}
+
+/*
+ * Function:  eeprom_update_byte
+ *  Writes an EEPROM byte only if it differs.
+ *
+ *  returns:    none
+ */
+void eeprom_update_byte(uint8_t* addr, uint8_t value){
+	if(hostEEPROM[(uintptr_t)addr] != value){
+		eeprom_write_byte(addr, value);
+	}
+	return;
+}
+
+/*
+ * Function:  eeprom_update_word
+ *  Updates an EEPROM word, low byte first.
+ *
+ *  returns:    none
+ */
+void eeprom_update_word(uint16_t* addr, uint16_t value){
+	eeprom_update_byte((uint8_t*)addr, value & 0xFF);
+	eeprom_update_byte((uint8_t*)addr + 1, value >> 8);
+	return;
+}
+
+/*
+ * Function:  eeprom_update_block
+ *  Updates n EEPROM bytes at dst from src.
+ *
+ *  returns:    none
+ */
+void eeprom_update_block(const void* src, void* dst, size_t n){
+	for(size_t i = 0; i < n; i++){
+		eeprom_update_byte((uint8_t*)dst + i, ((const uint8_t*)src)[i]);
+	}
+	return;
+}
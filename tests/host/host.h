@@ -0,0 +1,29 @@
+/*
+ * host.h (host)
+ *
+ * Included ahead of every file in the host build (gcc -include). Covers
+ * the avr-libc and avr-gcc parts the panel headers use that have no
+ * header of their own to stand in for.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdio.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+//avr-libc stdio streams, tests do not print through them
+#define FDEV_SETUP_STREAM(put, get, flags) {0}
+#define _FDEV_SETUP_WRITE 0
+#define _FDEV_SETUP_READ 0
+
+//start up code in .init sections is not run on the host, and x86 naked
+//functions may only hold asm
+#define naked noinline
+
+#endif /* HOST_H_ */
@@ -0,0 +1,36 @@
+/*
+ * util/atomic.h (host)
+ *
+ * Host stand in for avr-libc ATOMIC_BLOCK. The block clears the I bit in
+ * SREG and puts it back when it is left, as on the target, so the board
+ * model (board.c) holds interrupts off inside it. Without a board model
+ * nothing checks the bit and the body simply runs once.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_ATOMIC_H_
+#define HOST_ATOMIC_H_
+
+#include <avr/io.h>
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON (1<<SREG_I)
+
+//put SREG back at the end of the block, with I set for ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) \
+	for(uint8_t atomicSREG __attribute__((cleanup(host_atomic_end))) = \
+		SREG | (type), atomicOnce = host_atomic_begin(); \
+		atomicOnce; atomicOnce = 0)
+
+static inline uint8_t host_atomic_begin(){
+	SREG &= (uint8_t)~(1<<SREG_I);
+	return 1;
+}
+
+static inline void host_atomic_end(const uint8_t* sreg){
+	SREG = *sreg;
+	return;
+}
+
+#endif /* HOST_ATOMIC_H_ */
@@ -0,0 +1,26 @@
+/*
+ * util/delay.h (host)
+ *
+ * Host stand in for the avr-libc busy wait delays. Tests do not wait. The
+ * board model (board.c) sets hostDelayHook to move its clock on instead.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#ifndef HOST_DELAY_H_
+#define HOST_DELAY_H_
+
+//called with the length of each delay in us, 0 for none
+extern void (*hostDelayHook)(double us);
+
+#define _delay_ms(ms) host_delay((ms) * 1000.0)
+#define _delay_us(us) host_delay(us)
+
+static inline void host_delay(double us){
+	if(hostDelayHook != 0){
+		hostDelayHook(us);
+	}
+	return;
+}
+
+#endif /* HOST_DELAY_H_ */
@@ -0,0 +1,407 @@
+/*
+ * sim_panel.c
+ *
+ * Virtual panel. Runs the LCD build, with the 7 segment mirror, on the host
+ * board model and draws the decoded LCD and mirror digits in the terminal.
+ *	sim_panel				keys from the keyboard, in real time. 0 - 9,
+ *							a - d, * and # press keypad keys, z opens or
+ *							closes zone 0, q quits
+ *	sim_panel -n N [-t S]	soak: N panels press random keys for S seconds
+ *							of board time (SIM_SOAK_S), as fast as the host
+ *							runs them. Each panel reports its frames, keys
+ *							and LCD bus counters, and fails if the counters
+ *							do not match the traffic seen on its port
+ * The build keeps its state in globals, so each panel is a process of its
+ * own, forked before the board starts.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <time.h>
+#include "app.h"
+#define DISPLAY_SEG				//7 segment mirror on PORTF and PORTJ
+#define main app_main
+#include "../With LCD Screen_Security System and Code Entry/main.c"
+#undef main
+
+#define SIM_HOLD_MS 150			//key press
+#define SIM_GAP_MS 100			//shortest gap between soak keys
+#define SIM_GAP_SPREAD_MS 500	//soak gaps are up to this much longer
+#define SIM_POLL_MS 10			//keyboard read
+#define SIM_DRAW_MS 50			//terminal redraw
+#define SIM_SOAK_S 600			//board time of a soak
+#define SIM_ZONE_ODDS 50		//1 in this many soak keys is a zone instead
+#define SIM_CONSOLE 64			//console line shown
+
+void sim_board();
+void sim_step();
+void sim_key();
+void sim_next_key();
+void sim_read_key();
+void sim_draw();
+void sim_uart(uint8_t c);
+int sim_soak(int panel, unsigned long secs);
+int sim_report(int panel, double wall);
+int sim_interactive();
+void sim_restore();
+
+uint8_t simSoak = 0;			//1 for random keys, 0 for the keyboard
+uint64_t simEnd = 0;			//soak, cycle the panel stops
+uint64_t simKeyAt = 0;			//cycle sim_key next has work
+uint64_t simDrawAt = 0;			//cycle of the next redraw
+int simDown = -1;				//key held, BOARD_KEYS index
+uint8_t simZones = 0;			//zone contacts open, bit per zone
+char simConsole[SIM_CONSOLE];	//console line being sent
+char simConsoleLast[SIM_CONSOLE];	//last whole console line
+int simConsoleLen = 0;
+struct termios simTerm;			//terminal settings to put back
+uint8_t simRaw = 0;				//1 while the terminal is raw
+
+
+/*
+ * Function:  sim_board
+ *  Resets the board with the LCD build's wiring and every zone closed.
+ *
+ *  returns:    none
+ */
+void sim_board(){
+	BoardWiring wiring = {
+		{{'C', 3}, {'C', 2}, {'C', 1}, {'C', 0}},	//rows, Keypad.h
+		{{'D', 0}, {'D', 1}, {'D', 2}, {'D', 3}},	//columns, INT0 - INT3
+		{'B', 1}, {'B', 0}, {0, 0},		//E, RS, RW tied to GND (LCD.h)
+		'A', 0,							//D4 - D7 on PA4 - PA7
+		'F', 'J'						//mirror display (main.c)
+	};
+
+	board_init(&wiring);
+	for(uint8_t zone = 0; zone < 8; zone++){
+		board_input('K', zone, 0);		//zone contacts closed
+	}
+	simZones = 0;
+	simDown = -1;
+	simKeyAt = 0;
+	simDrawAt = 0;
+	boardStepHook = sim_step;
+	return;
+}
+
+/*
+ * Function:  sim_step
+ *  boardStepHook. Presses keys, redraws the terminal and ends a soak. Runs
+ *  every few us of board time, so it only looks at the clock until one of
+ *  them is due.
+ *
+ *  returns:    none
+ */
+void sim_step(){
+	if(boardCycles >= simKeyAt){
+		sim_key();
+	}
+	if(boardCycles < simDrawAt){
+		return;
+	}
+	simDrawAt = boardCycles + BOARD_MS(SIM_DRAW_MS);
+	if(!simSoak){
+		sim_draw();
+	}
+	else if(boardCycles >= simEnd){
+		board_stop();
+	}
+	return;
+}
+
+/*
+ * Function:  sim_key
+ *  Lets go of the key held, or presses the next one.
+ *
+ *  returns:    none
+ */
+void sim_key(){
+	if(simDown >= 0){
+		board_key(simDown, 0);
+		simDown = -1;
+		simKeyAt = boardCycles + BOARD_MS(simSoak ? SIM_GAP_MS : SIM_POLL_MS);
+		return;
+	}
+	if(simSoak){
+		sim_next_key();
+	}
+	else{
+		sim_read_key();
+	}
+	return;
+}
+
+/*
+ * Function:  sim_next_key
+ *  Soak. Presses a random key, or now and then opens or closes a random
+ *  zone.
+ *
+ *  returns:    none
+ */
+void sim_next_key(){
+	uint32_t gap = SIM_GAP_MS + rand() % SIM_GAP_SPREAD_MS;
+
+	if(rand() % SIM_ZONE_ODDS == 0){
+		uint8_t zone = rand() % 8;
+
+		simZones ^= (1 << zone);
+		board_input('K', zone, (simZones >> zone) & 1);
+		simKeyAt = boardCycles + BOARD_MS(gap);
+		return;
+	}
+	simDown = rand() % (sizeof(BOARD_KEYS) - 1);
+	board_key(simDown, 1);
+	simKeyAt = boardCycles + BOARD_MS(SIM_HOLD_MS);
+	return;
+}
+
+/*
+ * Function:  sim_read_key
+ *  Reads a key from the keyboard, if one is waiting, and presses it.
+ *
+ *  returns:    none
+ */
+void sim_read_key(){
+	struct pollfd in = {0, POLLIN, 0};
+	char c;
+	int key;
+
+	simKeyAt = boardCycles + BOARD_MS(SIM_POLL_MS);
+	if((poll(&in, 1, 0) != 1) || (read(0, &c, 1) != 1)){	//keys may be piped
+		return;
+	}
+	c = toupper((unsigned char)c);
+	if(c == 'Q'){
+		board_stop();
+	}
+	if(c == 'Z'){
+		simZones ^= 0x01;
+		board_input('K', 0, simZones & 0x01);
+		return;
+	}
+	key = board_key_index(c);
+	if(key < 0){
+		return;
+	}
+	simDown = key;
+	board_key(simDown, 1);
+	simKeyAt = boardCycles + BOARD_MS(SIM_HOLD_MS);
+	return;
+}
+
+/*
+ * Function:  sim_draw
+ *  Draws the panel at the top of the terminal: the LCD as decoded from its
+ *  port, the mirror digits as lit, and the counters.
+ *
+ *  returns:    none
+ */
+void sim_draw(){
+	char lcd[2][17];
+	char seg[5];
+
+	board_lcd_text(lcd);
+	for(int i = 0; i < 4; i++){
+		seg[i] = board_seg_digit(i, displayNums, "0123456789ACDEILPRSU8 ",
+			SEG_BLANK + 1);
+	}
+	seg[4] = '\0';
+	printf("\033[H+----------------+\033[K\n");
+	printf("|%s|\033[K\n|%s|\033[K\n", lcd[0], lcd[1]);
+	printf("+----------------+  [%s]\033[K\n\n", seg);
+	printf("%.1f s  frames %lu  keys %lu  zones open %02X\033[K\n",
+		(double)boardCycles / BOARD_HZ, displayFrames, keyPresses, simZones);
+	printf("console: %s\033[K\n", simConsoleLast);
+	printf("0-9 a-d * # keys, z zone 0, q quit\033[K\n");
+	fflush(stdout);
+	return;
+}
+
+/*
+ * Function:  sim_uart
+ *  boardUartOut. Keeps the last line the console sent.
+ *
+ *	c		uint8_t		byte sent
+ *
+ *  returns:    none
+ */
+void sim_uart(uint8_t c){
+	if((c == '\n') || (simConsoleLen == SIM_CONSOLE - 1)){
+		simConsole[simConsoleLen] = '\0';
+		memcpy(simConsoleLast, simConsole, sizeof(simConsoleLast));
+		simConsoleLen = 0;
+	}
+	if((c >= ' ') && (c < 0x7F)){
+		simConsole[simConsoleLen++] = c;
+	}
+	return;
+}
+
+/*
+ * Function:  sim_soak
+ *  Runs one soak panel. Called in the forked process.
+ *
+ *	panel	int				panel number, also its random seed
+ *	secs	unsigned long	board time to run
+ *
+ *  returns:    int		0 if the bus counters matched, 1 if not
+ */
+int sim_soak(int panel, unsigned long secs){
+	struct timespec start;
+	struct timespec end;
+
+	srand(panel + 1);
+	simSoak = 1;
+	sim_board();
+	simEnd = BOARD_MS((uint64_t)secs * 1000);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	board_run(app_main);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return sim_report(panel, (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+/*
+ * Function:  sim_report
+ *  Prints a soak panel's counters in one write, so the lines of panels
+ *  that finish together do not mix, and checks the LCD bus counters
+ *  against the traffic the board decoded.
+ *
+ *	panel	int		panel number
+ *	wall	double	seconds the run took
+ *
+ *  returns:    int		0 if the counters matched, 1 if not
+ */
+int sim_report(int panel, double wall){
+	double secs = (double)boardCycles / BOARD_HZ;
+	LCDBusCount bus = {0, 0, 0};
+	char out[2048];
+	int len;
+	int ok;
+
+	for(int i = 0; i < LCD_CTX_COUNT; i++){
+		bus.instructions += LCDBusStats[i].instructions;
+		bus.data += LCDBusStats[i].data;
+		bus.pulses += LCDBusStats[i].pulses;
+	}
+	//LCD.h counts the four function sets of the reset as pulses only
+	ok = (bus.instructions + 4 == boardLCD.instructions) &&
+		(bus.data == boardLCD.data) && (bus.pulses == boardLCD.pulses);
+	len = snprintf(out, sizeof(out),
+		"panel %d: %.0f s in %.1f s, %lu frames (%.1f/s), %lu keys, "
+		"%lu interrupts, bus %u/%u/%u%s\n", panel, secs, wall, displayFrames,
+		displayFrames / secs, keyPresses, boardInterrupts, bus.instructions,
+		bus.data, bus.pulses, ok ? "" : ", does not match the port");
+	for(int i = 0; i < LCD_CTX_COUNT; i++){
+		LCDBusCount c = LCDBusStats[i];
+
+		if((c.pulses != 0) && (len < (int)sizeof(out))){
+			len += snprintf(out + len, sizeof(out) - len,
+				"\t%-7s %8u instructions %8u data %8u pulses\n",
+				LCDBusNames[i], c.instructions, c.data, c.pulses);
+		}
+	}
+	if(len > (int)sizeof(out)){
+		len = sizeof(out);
+	}
+	if(write(1, out, len) != len){
+		return 1;
+	}
+	return !ok;
+}
+
+/*
+ * Function:  sim_interactive
+ *  Runs one panel in real time with keys from the keyboard.
+ *
+ *  returns:    int		0
+ */
+int sim_interactive(){
+	struct termios raw;
+
+	if(tcgetattr(0, &simTerm) == 0){
+		raw = simTerm;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 0;				//reads do not wait
+		raw.c_cc[VTIME] = 0;
+		tcsetattr(0, TCSANOW, &raw);
+		simRaw = 1;
+		atexit(sim_restore);
+	}
+	printf("\033[2J\033[?25l");
+	simSoak = 0;
+	sim_board();
+	boardUartOut = sim_uart;
+	boardRealTime = 1;
+	board_run(app_main);
+	sim_draw();
+	sim_restore();
+	return 0;
+}
+
+/*
+ * Function:  sim_restore
+ *  Puts the terminal back as it was.
+ *
+ *  returns:    none
+ */
+void sim_restore(){
+	if(simRaw){
+		tcsetattr(0, TCSANOW, &simTerm);
+		simRaw = 0;
+	}
+	printf("\033[?25h");
+	fflush(stdout);
+	return;
+}
+
+int main(int argc, char** argv){
+	int panels = 0;
+	unsigned long secs = SIM_SOAK_S;
+	int failed = 0;
+	int status;
+
+	for(int i = 1; i < argc; i++){
+		if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)){
+			panels = atoi(argv[++i]);
+		}
+		else if((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)){
+			secs = strtoul(argv[++i], 0, 10);
+		}
+		else{
+			printf("usage: sim_panel [-n panels [-t seconds]]\n");
+			return 2;
+		}
+	}
+	if(panels <= 0){
+		return sim_interactive();
+	}
+
+	fflush(stdout);
+	for(int i = 0; i < panels; i++){
+		pid_t pid = fork();
+
+		if(pid == 0){
+			_exit(sim_soak(i, secs));
+		}
+		if(pid < 0){
+			perror("fork");
+			failed++;
+			break;
+		}
+	}
+	while(wait(&status) > 0){
+		if(!WIFEXITED(status) || (WEXITSTATUS(status) != 0)){
+			failed++;
+		}
+	}
+	printf("%d panels, %lu s each, %d failed\n", panels, secs, failed);
+	return failed != 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * test_alarm.c
+ *
+ * Host test for the alarm state (AlarmCore.h) and the zones (Zones.h).
+ * Zone contacts are set on PINK and zones_tick is called in place of the
+ * timer interrupt. Arming while armed must not restart a delay or clear
+ * an alarm, and a wrong code never disarms.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "../Common/AlarmCore.h"
+#include "Test.h"
+
+#define DOOR 0x01			//zone 0, entry delay
+#define WINDOW 0x02			//zone 1, instant
+
+void tick(int n);
+
+const int code[PIN_LENGTH] = {1, 2, 3, 4};
+const int wrong[PIN_LENGTH] = {1, 2, 3, 5};
+
+
+/*
+ * Function:  tick
+ *  Runs the zone interrupt.
+ *
+ *  n		int		ticks (ZONE_TICK_MS each)
+ *
+ *  returns:    none
+ */
+void tick(int n){
+	for(int i = 0; i < n; i++){
+		zones_tick();
+	}
+	return;
+}
+
+int main(){
+	int entry;
+
+	zones_init(DOOR | WINDOW, DOOR, 30, 30);
+	PINK = 0x00;						//all contacts closed
+
+	//no PIN, nothing to arm with
+	CHECK(core_arm() == 1);
+	CHECK(alarmEnable == 0);
+	CHECK(zoneState == ZONES_DISARMED);
+	CHECK(core_disarm(code) == 2);
+
+	//arm starts the exit delay
+	core_set_pin(code);
+	CHECK(PINset == 1);
+	CHECK(core_arm() == 0);
+	CHECK(zoneState == ZONES_EXIT);
+	CHECK(zones_countdown(&entry) == 30);
+	CHECK(entry == 0);
+
+	//arming again part way through does not restart it
+	tick(10 * ZONE_TICKS_PER_S);
+	CHECK(core_arm() == 2);
+	CHECK(zones_countdown(&entry) == 20);
+	CHECK(zoneState == ZONES_EXIT);
+
+	//the door opening during the exit delay is ignored
+	PINK = DOOR;
+	tick(5 * ZONE_TICKS_PER_S);
+	CHECK(zoneState == ZONES_EXIT);
+	PINK = 0x00;
+	tick(15 * ZONE_TICKS_PER_S + 10);
+	CHECK(zoneState == ZONES_ARMED);
+	CHECK(zones_countdown(&entry) == 0);
+
+	//the door starts the entry delay, arming does not turn it into an exit
+	//delay or stop it
+	PINK = DOOR;
+	tick(ZONE_DEBOUNCE + 2);
+	CHECK(zones_countdown(&entry) == 30);
+	CHECK(entry == 1);
+	tick(10 * ZONE_TICKS_PER_S);
+	CHECK(core_arm() == 2);
+	CHECK(zoneState == ZONES_ARMED);
+	CHECK(zones_countdown(&entry) == 20);
+	CHECK(entry == 1);
+
+	//a wrong code leaves the delay running
+	CHECK(core_disarm(wrong) == 1);
+	CHECK(alarmEnable == 1);
+	CHECK(zones_countdown(&entry) == 20);
+
+	//the delay runs out, arming again does not clear the alarm
+	tick(20 * ZONE_TICKS_PER_S);
+	CHECK(zoneState == ZONES_ALARM);
+	CHECK(zones_take_trips() == DOOR);
+	CHECK(zones_take_trips() == 0);
+	CHECK(core_arm() == 2);
+	CHECK(zoneState == ZONES_ALARM);
+	CHECK(PORTB & (1<<ZONE_BEEP_PIN));
+
+	//the right code disarms and keeps the PIN
+	CHECK(core_disarm(code) == 0);
+	CHECK(alarmEnable == 0);
+	CHECK(zoneState == ZONES_DISARMED);
+	CHECK(!(PORTB & (1<<ZONE_BEEP_PIN)));
+	CHECK(core_disarm(code) == 2);
+	CHECK(PINset == 1);
+
+	//an instant zone sets off the alarm once the exit delay is over
+	PINK = 0x00;
+	tick(ZONE_DEBOUNCE + 2);
+	CHECK(core_arm() == 0);
+	tick(30 * ZONE_TICKS_PER_S);
+	CHECK(zoneState == ZONES_ARMED);
+	PINK = WINDOW;
+	tick(ZONE_DEBOUNCE + 2);
+	CHECK(zoneState == ZONES_ALARM);
+	CHECK(zones_take_trips() == WINDOW);
+	CHECK(core_disarm(code) == 0);
+
+	//a new PIN replaces the old one
+	core_set_pin(wrong);
+	CHECK(pinMatches(pin, wrong));
+	CHECK(!pinMatches(pin, code));
+
+	core_check();
+	CHECK(invCount == 0);
+	return test_done("alarm");
+}
@@ -0,0 +1,95 @@
+/*
+ * test_evlog.c
+ *
+ * Host test for the EEPROM event log (EventLog.h). The panel is reset
+ * part way between checkpoints again and again, round the ring more than
+ * once. Each boot must find the head where the last boot left it, so no
+ * record is ever written over before its lap is done.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "../With LCD Screen_Security System and Code Entry/EventLog.h"
+#include "Test.h"
+
+#define CYCLES 150			//resets, about three laps of the ring
+#define BURST 20			//records between resets, not a checkpoint multiple
+
+int since_checkpoint();
+
+
+/*
+ * Function:  since_checkpoint
+ *  Records between the newest checkpoint in EEPROM and the head, or the
+ *  start of the log before the first checkpoint.
+ *
+ *  returns:    int		records
+ */
+int since_checkpoint(){
+	uint8_t seq = evlogSeq;		//evlog_find_checkpoint sets it
+	uint16_t head;
+	uint8_t lap;
+	int found = evlog_find_checkpoint(&head, &lap);
+
+	evlogSeq = seq;
+	if(found != 0){
+		return evlogHead;
+	}
+	return (evlogHead + EVLOG_RECORDS - head) % EVLOG_RECORDS;
+}
+
+int main(){
+	EventRecord rec;
+	uint16_t expect;
+	int n;
+
+	//new log, boot record at the start
+	sysTicks = 0;
+	evlog_init();
+	CHECK(evlogHead == 1);
+	evlog_read(0, &rec);
+	CHECK((rec.type & ~EVLOG_LAP) == TEL_BOOT);
+
+	for(int c = 0; c < CYCLES; c++){
+		for(int i = 0; i < BURST; i++){
+			sysTicks += 1500;
+			evlog_write(TEL_ARM, c);
+			CHECK(since_checkpoint() <= EVLOG_CHECKPOINT);
+		}
+		expect = (evlogHead + 1) % EVLOG_RECORDS;	//head after the boot record
+
+		evlog_init();							//reset
+		CHECK(evlogHead == expect);
+		n = since_checkpoint();
+		CHECK(n <= EVLOG_CHECKPOINT);
+		CHECK(evlogSinceCheckpoint == n);
+
+		//newest records are this boot and the last record of the burst
+		evlog_read((expect + EVLOG_RECORDS - 1) % EVLOG_RECORDS, &rec);
+		CHECK((rec.type & ~EVLOG_LAP) == TEL_BOOT);
+		CHECK((rec.type & EVLOG_LAP) ==
+			((expect == 0) ? (evlogLap ^ EVLOG_LAP) : evlogLap));
+		evlog_read((expect + EVLOG_RECORDS - 2) % EVLOG_RECORDS, &rec);
+		CHECK((rec.type & ~EVLOG_LAP) == TEL_ARM);
+		CHECK(rec.arg == c);
+	}
+	CHECK(CYCLES * (BURST + 1) > 2 * EVLOG_RECORDS);	//ring wrapped
+
+	//seconds between records, the remainder carries to the next one
+	sysTicks += 2500;
+	evlog_write(TEL_DISARM, 0);
+	evlog_read((evlogHead + EVLOG_RECORDS - 1) % EVLOG_RECORDS, &rec);
+	CHECK(rec.delta == 2);
+	sysTicks += 1600;
+	evlog_write(TEL_DISARM, 0);
+	evlog_read((evlogHead + EVLOG_RECORDS - 1) % EVLOG_RECORDS, &rec);
+	CHECK(rec.delta == 2);
+
+	//all checkpoint slots corrupt, the log starts again
+	for(int i = 0; i < EVLOG_HEADERS * 4; i++){
+		hostEEPROM[EVLOG_HEADER_BASE + i] = 0xFF;
+	}
+	evlog_init();
+	CHECK(evlogHead <= EVLOG_CHECKPOINT + 1);
+	return test_done("evlog");
+}
@@ -0,0 +1,202 @@
+/*
+ * test_lcd.c
+ *
+ * Host test of the whole LCD build (main.c) on the host board model. Keys
+ * are pressed on the keypad matrix, so they go through the keypad
+ * interrupts, the debounce tick and the scan of Keypad.h, with bouncing,
+ * held and glitching contacts. Every frame is timestamped from sysTicks
+ * and each step of the script has a latency budget. The LCD is decoded
+ * from the enable pulses on its port and has to match LCDShadow at every
+ * frame, and the text of each step is checked in LCDShadow.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "app.h"
+#define main app_main
+#include "../With LCD Screen_Security System and Code Entry/main.c"
+#undef main
+#include "Script.h"
+
+#define KEY_MS (KEY_DEBOUNCE_MS + 10)	//key to frame, debounce and scan
+#define SAVE_MS (KEY_MS + 100)	//key to frame, with the PIN saved to EEPROM
+#define ERROR_MS (SCRIPT_HOLD_MS + 10)	//key to an error, shown once the key
+										//is let go
+#define BLINK_MS 3500			//error message to the next screen
+#define BOOT_MS 500				//reset to the first screen
+
+void lcd_trace(const DisplayModel* m);
+void lcd_shadow(char text[SCRIPT_TEXT]);
+int lcd_matches();
+
+//text is "line 1|line 2"
+const ScriptStep script[] = {
+	{"",		VIEW_SETUP,			0,	0,							BOOT_MS},
+	{"A",		VIEW_ENTER_CODE,	0,	"Enter PIN:      |                ", KEY_MS},
+	{"~1",		VIEW_ENTER_CODE,	1,	"Enter PIN:      |1               ", KEY_MS},
+	{"=2",		VIEW_ENTER_CODE,	2,	"Enter PIN:      |#2              ", KEY_MS},
+	{"!3",		SCRIPT_NO_FRAME,	0,	0,							0},
+	{"*",		VIEW_ENTER_CODE,	1,	"Enter PIN:      |#               ", KEY_MS},
+	{"~2~3~4",	VIEW_ENTER_CODE,	4,	"Enter PIN:      |###4            ", KEY_MS},
+	{"#",		VIEW_PIN,			0,	"????????????????|1=OK, 2=New Pin ", KEY_MS},
+	{"2",		VIEW_ENTER_CODE,	0,	"Enter PIN:      |                ", KEY_MS},
+	{"1234#",	VIEW_PIN,			0,	"????????????????|1=OK, 2=New Pin ", KEY_MS},
+	{"5",		VIEW_ERROR,	DISP_ERR_GENERAL,	"Error           |", ERROR_MS},
+	{"4",		VIEW_PIN,			0,	"????????????????|1=OK, 2=New Pin ", KEY_MS},
+	{"1",		VIEW_IDLE,			0,	"A:Arm  D:Disarm |C:Change Pin Num", SAVE_MS},
+	{"D",		VIEW_ERROR,	DISP_ERR_NOT_ARMED,	"System not armed|", ERROR_MS},
+	{"",		VIEW_IDLE,			0,	"A:Arm  D:Disarm |C:Change Pin Num", BLINK_MS},
+	{"~A",		VIEW_ARMED,			0,	"System Armed   #|                ", KEY_MS},
+	{"",		VIEW_IDLE,			1,	"A:Arm  D:Disarm |C:PIN",	PANEL_SHOW_MS + 50},
+	{"",		VIEW_COUNTDOWN,	SCRIPT_ANY,	"????????????????|C:PIN   Exit 2", 1050},
+	{"=D",		VIEW_ENTER_PIN,		0,	"Enter PIN:      |                ", KEY_MS},
+	{"9999#",	VIEW_ERROR,	DISP_ERR_WRONG_PIN,	"Wrong PIN       |", ERROR_MS},
+	{"",		VIEW_IDLE,			1,	"A:Arm  D:Disarm |C:PIN",	BLINK_MS},
+	{"D1234#",	VIEW_DISARMED,		0,	"Success        #|                ", KEY_MS},
+	{"",		VIEW_IDLE,			0,	"A:Arm  D:Disarm |C:Change Pin Num", PANEL_SHOW_MS + 50},
+	{"C",		VIEW_ENTER_PIN,		0,	"Enter PIN:      |", KEY_MS},
+	{"1234#",	VIEW_ENTER_CODE,	0,	"Enter PIN:      |", KEY_MS},
+	{"56~78#",	VIEW_PIN,			0,	"????????????????|1=OK, 2=New Pin ", KEY_MS},
+	{"~1",		VIEW_IDLE,			0,	"A:Arm  D:Disarm |C:Change Pin Num", SAVE_MS},
+	{"A",		VIEW_ARMED,			0,	"System Armed   #|", KEY_MS},
+	{"",		VIEW_IDLE,			1,	"A:Arm  D:Disarm |C:PIN",	PANEL_SHOW_MS + 50},
+	{"D1234#",	VIEW_ERROR,	DISP_ERR_WRONG_PIN,	"Wrong PIN       |", ERROR_MS},
+	{"",		VIEW_IDLE,			1,	"A:Arm  D:Disarm |C:PIN",	BLINK_MS},
+	{"D5678#",	VIEW_DISARMED,		0,	"Success        #|", KEY_MS},
+	{"",		VIEW_IDLE,			0,	"A:Arm  D:Disarm |C:Change Pin Num", PANEL_SHOW_MS + 50},
+	{"C567812345678901",	VIEW_ENTER_PIN,	PANEL_ENTRY_MAX - 1,
+		"Enter PIN:      |############### ", KEY_MS},
+	{"2",		VIEW_ERROR,	DISP_ERR_GENERAL,	"Error           |", ERROR_MS},
+	{"",		VIEW_IDLE,			0,	"A:Arm  D:Disarm |C:Change Pin Num", BLINK_MS}
+};
+
+int frames = 0;				//frames drawn
+int mismatches = 0;			//frames where the LCD did not show LCDShadow
+long tickDrift = 0;			//largest gap between sysTicks and the board, ms
+
+
+/*
+ * Function:  script_ms
+ *  Script.h clock, the system tick.
+ *
+ *  returns:    unsigned long	ms since reset
+ */
+unsigned long script_ms(){
+	return sysTicks;
+}
+
+/*
+ * Function:  script_text
+ *  Script.h display text, from LCDShadow. The decoded LCD has to show the
+ *  same.
+ *
+ *	text	char[SCRIPT_TEXT]	"line 1|line 2"
+ *
+ *  returns:    none
+ */
+void script_text(char text[SCRIPT_TEXT]){
+	lcd_shadow(text);
+	CHECK(lcd_matches());
+	return;
+}
+
+/*
+ * Function:  lcd_trace
+ *  displayTraceHook. Checks each frame against the LCD and the system tick
+ *  against the board clock, then hands it to the script.
+ *
+ *	m		const DisplayModel*	frame drawn
+ *
+ *  returns:    none
+ */
+void lcd_trace(const DisplayModel* m){
+	long drift = (long)(boardCycles / BOARD_MS(1)) - (long)sysTicks;
+
+	frames++;
+	if(!lcd_matches()){
+		mismatches++;
+	}
+	if(labs(drift) > tickDrift){
+		tickDrift = labs(drift);
+	}
+	script_frame(m->view, m->value);
+	return;
+}
+
+/*
+ * Function:  lcd_shadow
+ *  LCDShadow as text. Custom characters show as '#'.
+ *
+ *	text	char[SCRIPT_TEXT]	"line 1|line 2"
+ *
+ *  returns:    none
+ */
+void lcd_shadow(char text[SCRIPT_TEXT]){
+	for(int line = 0; line < 2; line++){
+		for(int i = 0; i < LCD_LineLength; i++){
+			char c = LCDShadow[line][i];
+
+			text[line * (LCD_LineLength + 1) + i] = ((uint8_t)c < 16) ? '#' : c;
+		}
+	}
+	text[LCD_LineLength] = '|';
+	text[2 * LCD_LineLength + 1] = '\0';
+	return;
+}
+
+/*
+ * Function:  lcd_matches
+ *  Checks the LCD decoded from its port shows LCDShadow. Blinking turns
+ *  the display off, when there is nothing to compare.
+ *
+ *  returns:    int		1 if it does, or the display is off
+ */
+int lcd_matches(){
+	char shadow[SCRIPT_TEXT];
+	char shown[2][17];
+
+	if(!boardLCD.on){
+		return 1;
+	}
+	lcd_shadow(shadow);
+	board_lcd_text(shown);
+	return (strncmp(shadow, shown[0], 16) == 0) &&
+		(strncmp(shadow + 17, shown[1], 16) == 0);
+}
+
+int main(){
+	BoardWiring wiring = {
+		{{'C', 3}, {'C', 2}, {'C', 1}, {'C', 0}},	//rows, Keypad.h
+		{{'D', 0}, {'D', 1}, {'D', 2}, {'D', 3}},	//columns, INT0 - INT3
+		{'B', 1}, {'B', 0}, {0, 0},		//E, RS, RW tied to GND (LCD.h)
+		'A', 0,							//D4 - D7 on PA4 - PA7
+		0, 0							//no 7 segment mirror
+	};
+	LCDBusCount bus = {0, 0, 0};
+
+	board_init(&wiring);
+	for(uint8_t zone = 0; zone < 8; zone++){
+		board_input('K', zone, 0);		//zone contacts closed
+	}
+	displayTraceHook = lcd_trace;
+	script_run(script, sizeof(script) / sizeof(script[0]), app_main);
+
+	CHECK(frames > 0);
+	CHECK(mismatches == 0);
+	CHECK(tickDrift <= 2);				//system tick keeps to the clock
+	//one key each, held or bouncing, but the key that cancels an error
+	//message is not passed on
+	CHECK(keyPresses == scriptKeys - 1);
+	for(int i = 0; i < LCD_CTX_COUNT; i++){	//bus counters see every write
+		bus.instructions += LCDBusStats[i].instructions;
+		bus.data += LCDBusStats[i].data;
+		bus.pulses += LCDBusStats[i].pulses;
+	}
+	//LCD.h counts the four function sets of the reset as pulses only
+	CHECK(bus.instructions + 4 == boardLCD.instructions);
+	CHECK(bus.data == boardLCD.data);
+	CHECK(bus.pulses == boardLCD.pulses);
+	printf("lcd: %d frames, worst key to frame %lu ms, %.1f s\n", frames,
+		scriptWorst, (double)boardCycles / BOARD_HZ);
+	return test_done("lcd");
+}
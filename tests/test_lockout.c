@@ -0,0 +1,132 @@
+/*
+ * test_lockout.c
+ *
+ * Host test for the wrong PIN lockout (Lockout.h). The system tick is set
+ * directly, so a day of guessing runs in a moment. Checks the backoff
+ * windows, that a reset never shortens a lockout, and how many PINs a
+ * guesser gets through in a day.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "../With LCD Screen_Security System and Code Entry/Lockout.h"
+#include "Test.h"
+
+#define DAY_MS (24UL * 60 * 60 * 1000)
+//PIN sources, as in EventLog.h
+#define SRC_KEYPAD 0
+#define SRC_CONSOLE 1
+#define SRC_MODBUS 2
+
+#define LIMIT 10				//wrong PINs from all sources before full lockout
+
+unsigned long guess_day(int sources, uint8_t limit);
+
+
+/*
+ * Function:  guess_day
+ *  Tries a wrong PIN from each source as soon as it is allowed to, for a
+ *  day, starting from clean counters.
+ *
+ *  sources	int		sources guessing (1 - LOCKOUT_SOURCES)
+ *  limit	uint8_t	full lockout limit, 0 for none
+ *
+ *  returns:    unsigned long	wrong PINs accepted for checking
+ */
+unsigned long guess_day(int sources, uint8_t limit){
+	unsigned long guesses = 0;
+	unsigned long end;
+
+	sysTicks = 1000;
+	for(int i = 0; i < LOCKOUT_SOURCES; i++){
+		lockout_clear(i);
+	}
+	lockout_init(limit);
+	end = sysTicks + DAY_MS;
+	while(sysTicks < end){
+		for(int i = 0; i < sources; i++){
+			if(lockout_remaining(i) == 0){
+				lockout_fail(i);
+				guesses++;
+			}
+		}
+		sysTicks += 100;		//a guess every 100 ms at best
+	}
+	return guesses;
+}
+
+int main(){
+	unsigned long window;
+	unsigned long guesses;
+
+	//erased EEPROM, nothing locked
+	sysTicks = 1000;
+	lockout_init(0);
+	CHECK(lockout_remaining(SRC_KEYPAD) == 0);
+
+	//LOCKOUT_FREE wrong PINs are free, then the window doubles
+	for(int i = 0; i < LOCKOUT_FREE - 1; i++){
+		lockout_fail(SRC_KEYPAD);
+		CHECK(lockout_remaining(SRC_KEYPAD) == 0);
+	}
+	window = LOCKOUT_BASE_S * 1000UL;
+	for(int i = 0; i < 12; i++){
+		lockout_fail(SRC_KEYPAD);
+		CHECK(lockout_remaining(SRC_KEYPAD) == window);
+		CHECK(lockout_remaining(SRC_CONSOLE) == 0);	//other sources free
+		sysTicks += window;
+		CHECK(lockout_remaining(SRC_KEYPAD) == 0);
+		window *= 2;
+		if(window > LOCKOUT_MAX_S * 1000UL){
+			window = LOCKOUT_MAX_S * 1000UL;
+		}
+	}
+
+	//a reset starts the window again, it is never shorter
+	lockout_fail(SRC_KEYPAD);
+	sysTicks += 1000;
+	CHECK(lockout_remaining(SRC_KEYPAD) == LOCKOUT_MAX_S * 1000UL - 1000);
+	lockout_init(0);
+	CHECK(lockout_remaining(SRC_KEYPAD) == LOCKOUT_MAX_S * 1000UL);
+
+	//a correct PIN clears the counters, and so does a reset after it
+	lockout_clear(SRC_KEYPAD);
+	lockout_init(0);
+	CHECK(lockout_remaining(SRC_KEYPAD) == 0);
+	CHECK(lockFails[SRC_KEYPAD] == 0);
+
+	//corrupt counters start clean
+	lockout_fail(SRC_KEYPAD);
+	hostEEPROM[LOCKOUT_ADDR + LOCKOUT_SOURCES + 1] ^= 0xFF;
+	lockout_init(0);
+	CHECK(lockFails[SRC_KEYPAD] == 0);
+
+	//the full lockout locks every source
+	lockout_init(LIMIT);
+	for(int i = 0; i < LIMIT; i++){
+		lockout_fail(i % LOCKOUT_SOURCES);
+	}
+	for(int i = 0; i < LOCKOUT_SOURCES; i++){
+		CHECK(lockout_remaining(i) == LOCKOUT_FULL_S * 1000UL);
+	}
+	//a correct PIN from one source ends the full lockout, other sources
+	//keep their own backoff
+	lockout_clear(SRC_MODBUS);
+	lockout_init(LIMIT);
+	CHECK(lockout_remaining(SRC_MODBUS) == 0);
+	CHECK(lockout_remaining(SRC_KEYPAD) == (LOCKOUT_BASE_S * 1000UL) << 1);
+
+	//one source without a full lockout: backoff up to LOCKOUT_MAX_S, then
+	//one guess per window
+	guesses = guess_day(1, 0);
+	printf("1 source, no limit: %lu guesses a day\n", guesses);
+	CHECK(guesses <= LOCKOUT_FREE + 8 + DAY_MS / (LOCKOUT_MAX_S * 1000UL));
+
+	//every source with the full lockout: about one guess per LOCKOUT_FULL_S
+	guesses = guess_day(LOCKOUT_SOURCES, LIMIT);
+	printf("%d sources, limit %d: %lu guesses a day\n", LOCKOUT_SOURCES, LIMIT,
+		guesses);
+	CHECK(guesses <= LIMIT + LOCKOUT_SOURCES +
+		LOCKOUT_SOURCES * DAY_MS / (LOCKOUT_FULL_S * 1000UL));
+	return test_done("lockout");
+}
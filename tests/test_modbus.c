@@ -0,0 +1,199 @@
+/*
+ * test_modbus.c
+ *
+ * Host test for the Modbus RTU slave frame handling (Modbus.h). Requests
+ * are put in modbusBuf as the receive interrupt would leave them and the
+ * reply is read back from it. The register map is a small array here.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "../With LCD Screen_Security System and Code Entry/Modbus.h"
+#include "Test.h"
+
+#define REGS 4
+
+int request(const uint8_t* req, int len);
+int is_exception(uint8_t fn, uint8_t code);
+
+uint16_t regs[REGS] = {0x1234, 0, 0, 0};
+int coils = 0x05;
+int writes = 0;				//register and coil writes
+
+
+/*
+ * Function:  modbusReadCoil
+ *  Register map. Coils 0 - 7 are the bits of coils.
+ *
+ *  returns:    int		coil state, -1 if there is no such coil
+ */
+int modbusReadCoil(uint16_t addr){
+	return (addr < 8) ? ((coils >> addr) & 1) : -1;
+}
+
+/*
+ * Function:  modbusWriteCoil
+ *  Register map. Coils 0 - 7 are the bits of coils.
+ *
+ *  returns:    int		0 written, 1 no such coil
+ */
+int modbusWriteCoil(uint16_t addr, int on){
+	if(addr >= 8){
+		return 1;
+	}
+	coils = on ? (coils | (1 << addr)) : (coils & ~(1 << addr));
+	writes++;
+	return 0;
+}
+
+/*
+ * Function:  modbusReadHolding
+ *  Register map. Holding registers are regs.
+ *
+ *  returns:    int		0 read, 1 no such register
+ */
+int modbusReadHolding(uint16_t addr, uint16_t* value){
+	if(addr >= REGS){
+		return 1;
+	}
+	*value = regs[addr];
+	return 0;
+}
+
+/*
+ * Function:  modbusWriteHolding
+ *  Register map. Holding registers are regs.
+ *
+ *  returns:    int		0 written, 1 no such register
+ */
+int modbusWriteHolding(uint16_t addr, uint16_t value){
+	if(addr >= REGS){
+		return 1;
+	}
+	regs[addr] = value;
+	writes++;
+	return 0;
+}
+
+/*
+ * Function:  modbusReadInput
+ *  Register map. Input register n reads n.
+ *
+ *  returns:    int		0 read, 1 no such register
+ */
+int modbusReadInput(uint16_t addr, uint16_t* value){
+	*value = addr;
+	return 0;
+}
+
+/*
+ * Function:  request
+ *  Handles a request with its CRC added, as the end of frame interrupt
+ *  does, and finishes sending any reply.
+ *
+ *  req		uint8_t*	request without CRC
+ *  len		int			request length without CRC
+ *
+ *  returns:    int		reply length with CRC, 0 if there was no reply
+ */
+int request(const uint8_t* req, int len){
+	uint16_t crc = crc16(req, len);
+	int reply;
+
+	memcpy(modbusBuf, req, len);
+	modbusBuf[len] = crc & 0xFF;
+	modbusBuf[len + 1] = crc >> 8;
+	modbusLen = len + 2;
+	TIMER5_COMPA_vect();
+	reply = modbusSending ? modbusLen : 0;
+	if(reply != 0){
+		CHECK(crc16(modbusBuf, reply) == 0);
+		USART2_TX_vect();		//last byte sent, bus released
+	}
+	return reply;
+}
+
+/*
+ * Function:  is_exception
+ *  Checks the reply in modbusBuf is an exception.
+ *
+ *  fn		uint8_t		function code of the request
+ *  code	uint8_t		expected exception code
+ *
+ *  returns:    1	reply is that exception
+ *		0	it is not
+ */
+int is_exception(uint8_t fn, uint8_t code){
+	return (modbusBuf[1] == (fn | 0x80)) && (modbusBuf[2] == code);
+}
+
+int main(){
+	const uint8_t readRegs[] = {MODBUS_ADDRESS, 0x03, 0, 0, 0, 2};
+	const uint8_t readLong[] = {MODBUS_ADDRESS, 0x03, 0, 0, 0, 2, 0x55};
+	const uint8_t writeReg[] = {MODBUS_ADDRESS, 0x06, 0, 1, 0xAB, 0xCD};
+	const uint8_t writeShort[] = {MODBUS_ADDRESS, 0x06, 0, 1};
+	const uint8_t writeLong[] = {MODBUS_ADDRESS, 0x06, 0, 1, 0xAB, 0xCD, 0};
+	const uint8_t writeCoil[] = {MODBUS_ADDRESS, 0x05, 0, 1, 0xFF, 0x00};
+	const uint8_t readCoils[] = {MODBUS_ADDRESS, 0x01, 0, 0, 0, 8};
+	const uint8_t readHuge[] = {MODBUS_ADDRESS, 0x03, 0, 0, 0x80, 0x00};
+	const uint8_t coilsHuge[] = {MODBUS_ADDRESS, 0x01, 0, 0, 0xFF, 0xF9};
+	const uint8_t far[] = {MODBUS_ADDRESS, 0x06, 0, REGS, 0, 1};
+	const uint8_t multiple[] = {MODBUS_ADDRESS, 0x10, 0, 1, 0, 1, 2, 0, 7};
+	const uint8_t broadcast[] = {0, 0x06, 0, 2, 0x00, 0x42};
+	const uint8_t other[] = {MODBUS_ADDRESS + 1, 0x06, 0, 2, 0x00, 0x42};
+	unsigned int crcErrors;
+
+	//8 byte requests are handled
+	CHECK(request(readRegs, sizeof(readRegs)) == 3 + 4 + 2);
+	CHECK((modbusBuf[2] == 4) && (modbusBuf[3] == 0x12) &&
+		(modbusBuf[4] == 0x34));
+	CHECK(request(writeReg, sizeof(writeReg)) == 8);
+	CHECK(regs[1] == 0xABCD);
+	CHECK(request(writeCoil, sizeof(writeCoil)) == 8);
+	CHECK(coils == 0x07);
+	CHECK(request(readCoils, sizeof(readCoils)) == 3 + 1 + 2);
+	CHECK(modbusBuf[3] == 0x07);
+
+	//a supported function with the wrong length is an illegal value and
+	//nothing is written, even if the first 6 bytes make a request
+	writes = 0;
+	CHECK(request(writeShort, sizeof(writeShort)) == 5);
+	CHECK(is_exception(0x06, MB_ILLEGAL_VALUE));
+	CHECK(request(writeLong, sizeof(writeLong)) == 5);
+	CHECK(is_exception(0x06, MB_ILLEGAL_VALUE));
+	CHECK(request(readLong, sizeof(readLong)) == 5);
+	CHECK(is_exception(0x03, MB_ILLEGAL_VALUE));
+	CHECK(writes == 0);
+
+	//an unsupported function is an illegal function whatever its length
+	CHECK(request(multiple, sizeof(multiple)) == 5);
+	CHECK(is_exception(0x10, MB_ILLEGAL_FUNCTION));
+
+	//counts that would wrap in 16 bit int
+	CHECK(request(readHuge, sizeof(readHuge)) == 5);
+	CHECK(is_exception(0x03, MB_ILLEGAL_VALUE));
+	CHECK(request(coilsHuge, sizeof(coilsHuge)) == 5);
+	CHECK(is_exception(0x01, MB_ILLEGAL_VALUE));
+
+	//registers that do not exist
+	CHECK(request(far, sizeof(far)) == 5);
+	CHECK(is_exception(0x06, MB_ILLEGAL_ADDRESS));
+
+	//broadcasts are handled but not answered, other slaves are ignored
+	CHECK(request(broadcast, sizeof(broadcast)) == 0);
+	CHECK(regs[2] == 0x42);
+	regs[2] = 0;
+	CHECK(request(other, sizeof(other)) == 0);
+	CHECK(regs[2] == 0);
+
+	//a bad CRC is counted and dropped
+	crcErrors = modbusCRCErrors;
+	memcpy(modbusBuf, writeReg, sizeof(writeReg));
+	modbusBuf[6] = 0;
+	modbusBuf[7] = 0;
+	modbusLen = 8;
+	TIMER5_COMPA_vect();
+	CHECK(!modbusSending);
+	CHECK(modbusCRCErrors == crcErrors + 1);
+	return test_done("modbus");
+}
@@ -0,0 +1,422 @@
+/*
+ * test_panel.c
+ *
+ * Host test for the keypad menu flows (Panel.h). Keys come from a script,
+ * the application functions are stand ins that use AlarmCore.h directly,
+ * and every frame drawn is seen by a stand in seg_render. A long random
+ * key stream is run at the end with the invariants checked after every
+ * command.
+ *
+ * Script characters:
+ *	0-9 A-D * #		key
+ *	T				one second of zone ticks while waiting for the next key
+ *	O / o			door zone opens / closes
+ *	X				alarm disarmed some other way (serial console)
+ *	space			ignored
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#define DISPLAY_SEG			//frames go to seg_render below
+#include <setjmp.h>
+#include <stdlib.h>
+#include "../Common/Panel.h"
+#include "Test.h"
+
+#define DOOR 0x01			//zone 0, entry delay
+#define RANDOM_KEYS 200000	//keys in the random stream
+
+void run(const char* keys);
+int saw(int view);
+int random_key();
+void tick(int n);
+
+jmp_buf scriptEnd;			//where panelKey goes when the script runs out
+const char* script = "";	//keys left
+long randomLeft = 0;		//random keys left, used instead of the script
+
+uint8_t views[VIEW_COUNT];	//frames of each view in this run
+int errors = 0;				//panelError calls
+int lastError = -1;			//last panelError message
+int pinSaved = 0;			//panelPINChanged calls
+int locked = 0;				//panelLocked result
+int pinChecked = 0;			//1 once panelCheckPIN has accepted a PIN
+int typed[PIN_LENGTH + 1];	//stored pin and #, typed by the random stream
+int typedLeft = 0;			//keys of typed still to come
+
+
+/*
+ * Function:  seg_render
+ *  Display driver. Counts the views drawn. A countdown must only be drawn
+ *  while the menu waits for a command.
+ *
+ *  returns:    none
+ */
+void seg_render(const DisplayModel* m){
+	views[m->view]++;
+	if(m->view == VIEW_COUNTDOWN){
+		CHECK(panelIdle);
+	}
+	return;
+}
+
+/*
+ * Function:  panelKey
+ *  Application function. Takes the next key from the script or the random
+ *  stream. Script actions before the key run while the panel waits, with
+ *  panel_countdown as the builds call it. Leaves the flow through
+ *  scriptEnd when there are no keys left.
+ *
+ *  returns:    int		key
+ */
+int panelKey(){
+	int key;
+
+	if(randomLeft > 0){
+		randomLeft--;
+		return random_key();
+	}
+	while(1){
+		switch(*script){
+			case '\0':
+				longjmp(scriptEnd, 1);
+			case ' ':
+				break;
+			case 'T':
+				tick(ZONE_TICKS_PER_S);
+				panel_countdown();
+				break;
+			case 'O':
+				PINK = DOOR;
+				break;
+			case 'o':
+				PINK = 0x00;
+				break;
+			case 'X':
+				core_disarm(pin);
+				break;
+			default:
+				key = *script++;
+				if((key >= '0') && (key <= '9')){
+					return key - '0';
+				}
+				if((key >= 'A') && (key <= 'D')){
+					return key - 'A' + 0xA;
+				}
+				return (key == '#') ? 0xE : 0xF;
+		}
+		script++;
+	}
+}
+
+/*
+ * Function:  panelError
+ *  Application function. Counts the error.
+ *
+ *  returns:    none
+ */
+void panelError(int msg){
+	display_show(VIEW_ERROR, msg, 0);
+	errors++;
+	lastError = msg;
+	return;
+}
+
+/*
+ * Function:  panelPause
+ *  Application function. No time passes.
+ *
+ *  returns:    none
+ */
+void panelPause(uint16_t ms){
+	return;
+}
+
+/*
+ * Function:  panelShowPIN
+ *  Application function. Shows the new PIN.
+ *
+ *  returns:    none
+ */
+void panelShowPIN(){
+	display_show(VIEW_PIN, 0, 0);
+	return;
+}
+
+/*
+ * Function:  panelLocked
+ *  Application function.
+ *
+ *  returns:    int		locked
+ */
+int panelLocked(){
+	return locked;
+}
+
+/*
+ * Function:  panelArmSystem
+ *  Application function. Arms through AlarmCore.h.
+ *
+ *  returns:    int		as core_arm
+ */
+int panelArmSystem(){
+	return core_arm();
+}
+
+/*
+ * Function:  panelDisarmSystem
+ *  Application function. Disarms through AlarmCore.h.
+ *
+ *  returns:    int		as core_disarm
+ */
+int panelDisarmSystem(const int code[PIN_LENGTH]){
+	return core_disarm(code);
+}
+
+/*
+ * Function:  panelCheckPIN
+ *  Application function. Checks code against the stored pin.
+ *
+ *  returns:    0	code is the pin
+ *		1	it is not
+ */
+int panelCheckPIN(const int code[PIN_LENGTH]){
+	if(!pinMatches(pin, code)){
+		return 1;
+	}
+	pinChecked = 1;
+	return 0;
+}
+
+/*
+ * Function:  panelPINChanged
+ *  Application function. Counts the saves.
+ *
+ *  returns:    none
+ */
+void panelPINChanged(){
+	pinSaved++;
+	return;
+}
+
+/*
+ * Function:  run
+ *  Runs menu commands until the script runs out.
+ *
+ *  keys	const char*		script
+ *
+ *  returns:    none
+ */
+void run(const char* keys){
+	memset(views, 0, sizeof(views));
+	script = keys;
+	if(setjmp(scriptEnd) == 0){
+		while(1){
+			panel_select();
+		}
+	}
+	panelIdle = 0;			//the menu was left part way through
+	return;
+}
+
+/*
+ * Function:  saw
+ *  Whether a view was drawn in the last run.
+ *
+ *  view	int		VIEW_ value
+ *
+ *  returns:    int		1 if it was drawn
+ */
+int saw(int view){
+	return views[view] != 0;
+}
+
+/*
+ * Function:  random_key
+ *  A random key. Digits come up most, and now and then the zones run
+ *  for a while or the door opens or closes. At a PIN prompt the stored pin
+ *  is sometimes typed, so the paths behind a right PIN are run too.
+ *
+ *  returns:    int		key
+ */
+int random_key(){
+	int r = rand() % 100;
+
+	if(typedLeft > 0){
+		return typed[PIN_LENGTH + 1 - typedLeft--];
+	}
+	if((displayModel.view == VIEW_ENTER_PIN) && (displayModel.value == 0) &&
+	   (r < 30)){
+		memcpy(typed, pin, sizeof(pin));
+		typed[PIN_LENGTH] = 0xE;
+		typedLeft = PIN_LENGTH;
+		return typed[0];
+	}
+	if(r < 5){
+		tick(rand() % (5 * ZONE_TICKS_PER_S));
+		panel_countdown();
+	}
+	else if(r < 7){
+		PINK ^= DOOR;
+	}
+	r = rand() % 100;
+	if(r < 60){
+		return rand() % 10;
+	}
+	if(r < 80){
+		return 0xE;
+	}
+	return 0xA + rand() % 6;
+}
+
+/*
+ * Function:  tick
+ *  Runs the zone interrupt.
+ *
+ *  n		int		ticks (ZONE_TICK_MS each)
+ *
+ *  returns:    none
+ */
+void tick(int n){
+	for(int i = 0; i < n; i++){
+		zones_tick();
+	}
+	return;
+}
+
+int main(){
+	const int first[PIN_LENGTH] = {1, 2, 3, 4};
+	const int second[PIN_LENGTH] = {3, 4, 5, 6};
+	const int third[PIN_LENGTH] = {7, 8, 9, 0};
+	int entry;
+	int before[PIN_LENGTH];
+	int wasSet;
+	int wasArmed;
+	int disarms = 0;
+
+	zones_init(DOOR, DOOR, 30, 30);
+	PINK = 0x00;
+
+	//setup waits for A or C, then the PIN is entered and confirmed
+	run("5 A1234#1");
+	CHECK(PINset == 1);
+	CHECK(pinMatches(pin, first));
+	CHECK(pinSaved == 1);
+	CHECK(saw(VIEW_SETUP) && saw(VIEW_ENTER_CODE) && saw(VIEW_PIN));
+	CHECK(displayModel.view == VIEW_IDLE);
+
+	//a bad entry or confirm key is an error and asks again, and nothing is
+	//stored until the PIN is confirmed
+	PINset = 0;
+	run("A12# 3456# 3");
+	CHECK(errors == 2);
+	CHECK(PINset == 0);
+	CHECK(pinMatches(pin, first));
+	run("C3456#2 3456#1");
+	CHECK(PINset == 1);
+	CHECK(pinMatches(pin, second));
+	CHECK(pinSaved == 2);
+
+	//changing the PIN asks for the current one first
+	errors = 0;
+	run("C9999#");
+	CHECK((errors == 1) && (lastError == DISP_ERR_WRONG_PIN));
+	CHECK(!saw(VIEW_ENTER_CODE));
+	CHECK(pinMatches(pin, second));
+	run("C34#");
+	CHECK((errors == 2) && (lastError == DISP_ERR_GENERAL));
+	run("C3456#7890#1");
+	CHECK(pinMatches(pin, third));
+	CHECK(pinSaved == 3);
+
+	//no PIN entry while locked out
+	locked = 1;
+	run("C7890#");
+	CHECK(!saw(VIEW_ENTER_PIN));
+	run("A D7890#");
+	CHECK(alarmEnable == 1);
+	CHECK(!saw(VIEW_ENTER_PIN));
+	locked = 0;
+
+	//the exit delay counts down on the menu, arming again keeps it going
+	run("TTTTTTTTTT");
+	CHECK(displayModel.view == VIEW_COUNTDOWN);
+	CHECK(displayModel.value == 20);
+	run("A TT");
+	CHECK(saw(VIEW_ARMED));
+	CHECK(zones_countdown(&entry) == 18);
+	CHECK(displayModel.value == 18);
+
+	//no countdown over a PIN being entered
+	run("D12TTT");
+	CHECK(displayModel.view == VIEW_ENTER_PIN);
+	CHECK(displayModel.value == 2);
+	CHECK(zones_countdown(&entry) == 15);
+
+	//a wrong PIN leaves it armed, * deletes a digit
+	errors = 0;
+	run("D0000#");
+	CHECK((errors == 1) && (lastError == DISP_ERR_WRONG_PIN));
+	CHECK(alarmEnable == 1);
+	run("D789*90#");
+	CHECK(saw(VIEW_DISARMED));
+	CHECK(alarmEnable == 0);
+	CHECK(zoneState == ZONES_DISARMED);
+
+	//disarming when not armed
+	run("D");
+	CHECK((errors == 2) && (lastError == DISP_ERR_NOT_ARMED));
+
+	//too many digits
+	run("A D11111111111111111111#");
+	CHECK((errors == 3) && (lastError == DISP_ERR_GENERAL));
+	CHECK(alarmEnable == 1);
+
+	//disarmed from the console, the menu is drawn again without the delay
+	run("T X T");
+	CHECK(displayModel.view == VIEW_IDLE);
+	CHECK(displayModel.value == 0);
+
+	//entry delay, then the alarm
+	run("A" "TTTTTTTTTTTTTTTTTTTTTTTTTTTTTTT" "O TT");
+	CHECK(displayModel.view == VIEW_COUNTDOWN);
+	CHECK(displayModel.entry == 1);
+	CHECK(displayModel.value == 29);
+	run("A TTTTTTTTTTTTTTTTTTTTTTTTTTTTT");
+	CHECK(zoneState == ZONES_ALARM);
+	CHECK(displayModel.value == DISP_COUNTDOWN_ALARM);
+	run("o D7890#");
+	CHECK(alarmEnable == 0);
+
+	core_check();
+	CHECK(invCount == 0);
+
+	//random keys: the stored pin only changes after the current one has
+	//been checked, arming only through A and disarming only with the pin
+	srand(2560);
+	randomLeft = RANDOM_KEYS;
+	if(setjmp(scriptEnd) == 0){
+		while(randomLeft > 0){
+			memcpy(before, pin, sizeof(before));
+			wasSet = PINset;
+			wasArmed = alarmEnable;
+			pinChecked = 0;
+			script = "";			//panelKey leaves through scriptEnd when
+									//the random keys run out
+			panel_select();
+			if(!pinMatches(before, pin)){
+				CHECK(!wasSet || pinChecked);
+			}
+			if(wasArmed && !alarmEnable){
+				CHECK(views[VIEW_DISARMED]);
+				disarms++;
+			}
+			core_check();
+			memset(views, 0, sizeof(views));
+		}
+	}
+	CHECK(invCount == 0);
+	printf("random: %d PINs saved, %d disarms\n", pinSaved, disarms);
+	CHECK((pinSaved > 100) && (disarms > 100));
+	return test_done("panel");
+}
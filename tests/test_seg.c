@@ -0,0 +1,128 @@
+/*
+ * test_seg.c
+ *
+ * Host test of the whole 7 segment build (main.c) on the host board model,
+ * with the steps of test_lcd.c. Keys are pressed on the keypad matrix and
+ * read by the timer 0 scan. The four digits are decoded from the segment
+ * and digit enable ports as the main loop multiplexes them, and frame times
+ * are taken from the board clock, as the build has no system tick.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "app.h"
+#define main app_main
+#include "../With 4 Digit 7 Seg Display_Security System and Code Entry/main.c"
+#undef main
+#include "Script.h"
+
+#define KEY_MS 10				//key to frame, one scan
+#define SAVE_MS KEY_MS			//key to frame, with the PIN saved
+#define ERROR_MS KEY_MS			//key to an error
+#define BLINK_MS 5500			//error message to the next screen
+#define BOOT_MS 50				//reset to the first screen
+
+void seg_trace(const DisplayModel* m);
+
+const ScriptStep script[] = {
+	{"",		VIEW_SETUP,			0,	"8888",	BOOT_MS},
+	{"A",		VIEW_ENTER_CODE,	0,	"ECDE",	KEY_MS},
+	{"~1",		VIEW_ENTER_CODE,	1,	"ECDE",	KEY_MS},
+	{"=2",		VIEW_ENTER_CODE,	2,	"ECDE",	KEY_MS},
+	{"*",		VIEW_ENTER_CODE,	1,	"ECDE",	KEY_MS},
+	{"~2~3~4",	VIEW_ENTER_CODE,	4,	"ECDE",	KEY_MS},
+	{"#",		VIEW_PIN,			0,	"1234",	KEY_MS},
+	{"2",		VIEW_ENTER_CODE,	0,	"ECDE",	KEY_MS},
+	{"1234#",	VIEW_PIN,			0,	"1234",	KEY_MS},
+	{"5",		VIEW_ERROR,	DISP_ERR_GENERAL,	"ERR ",	ERROR_MS},
+	{"",		VIEW_PIN,			0,	"1234",	BLINK_MS},
+	{"1",		VIEW_IDLE,			0,	"5UCC",	SAVE_MS},
+	{"D",		VIEW_ERROR,	DISP_ERR_NOT_ARMED,	"ERR ",	ERROR_MS},
+	{"",		VIEW_IDLE,			0,	"5UCC",	BLINK_MS},
+	{"~A",		VIEW_ARMED,			0,	"ALAR",	KEY_MS},
+	{"",		VIEW_IDLE,			1,	"A 2",	PANEL_SHOW_MS + 50},	//countdown
+	{"",		VIEW_COUNTDOWN,	SCRIPT_ANY,	"A 2",	1050},
+	{"=D",		VIEW_ENTER_PIN,		0,	"ERPI",	KEY_MS},
+	{"9999#",	VIEW_ERROR,	DISP_ERR_WRONG_PIN,	"ERR ",	ERROR_MS},
+	{"",		VIEW_IDLE,			1,	"A ??",	BLINK_MS},
+	{"D1234#",	VIEW_DISARMED,		0,	"5UCC",	KEY_MS},
+	{"",		VIEW_IDLE,			0,	"5UCC",	PANEL_SHOW_MS + 50},
+	{"C",		VIEW_ENTER_PIN,		0,	"ERPI",	KEY_MS},
+	{"1234#",	VIEW_ENTER_CODE,	0,	"ECDE",	KEY_MS},
+	{"56~78#",	VIEW_PIN,			0,	"5678",	KEY_MS},
+	{"~1",		VIEW_IDLE,			0,	"5UCC",	SAVE_MS},
+	{"A",		VIEW_ARMED,			0,	"ALAR",	KEY_MS},
+	{"",		VIEW_IDLE,			1,	"A 2",	PANEL_SHOW_MS + 50},	//countdown
+	{"D1234#",	VIEW_ERROR,	DISP_ERR_WRONG_PIN,	"ERR ",	ERROR_MS},
+	{"",		VIEW_IDLE,			1,	"A ??",	BLINK_MS},
+	{"D5678#",	VIEW_DISARMED,		0,	"5UCC",	KEY_MS},
+	{"",		VIEW_IDLE,			0,	"5UCC",	PANEL_SHOW_MS + 50},
+	{"C567812345678901",	VIEW_ENTER_PIN,	PANEL_ENTRY_MAX - 1,	"ERPI",	KEY_MS},
+	{"2",		VIEW_ERROR,	DISP_ERR_GENERAL,	"ERR ",	ERROR_MS},
+	{"",		VIEW_IDLE,			0,	"5UCC",	BLINK_MS}
+};
+
+int frames = 0;				//frames drawn
+
+
+/*
+ * Function:  script_ms
+ *  Script.h clock, the board's.
+ *
+ *  returns:    unsigned long	ms since reset
+ */
+unsigned long script_ms(){
+	return boardCycles / BOARD_MS(1);
+}
+
+/*
+ * Function:  script_text
+ *  Script.h display text, the four digits as lit.
+ *
+ *	text	char[SCRIPT_TEXT]	digits, ' ' for a dark one
+ *
+ *  returns:    none
+ */
+void script_text(char text[SCRIPT_TEXT]){
+	for(int i = 0; i < 4; i++){
+		text[i] = board_seg_digit(i, displayNums, "0123456789ACDEILPRSU8 ",
+			SEG_BLANK + 1);
+	}
+	text[4] = '\0';
+	return;
+}
+
+/*
+ * Function:  seg_trace
+ *  displayTraceHook. Hands each frame to the script.
+ *
+ *	m		const DisplayModel*	frame drawn
+ *
+ *  returns:    none
+ */
+void seg_trace(const DisplayModel* m){
+	frames++;
+	script_frame(m->view, m->value);
+	return;
+}
+
+int main(){
+	BoardWiring wiring = {
+		{{'C', 3}, {'C', 2}, {'C', 1}, {'C', 0}},	//rows, readNumPad
+		{{'C', 7}, {'C', 6}, {'C', 5}, {'C', 4}},	//columns
+		{0, 0}, {0, 0}, {0, 0}, 0, 0,	//no LCD
+		'A', 'B'						//segments, digit enables
+	};
+
+	board_init(&wiring);
+	for(uint8_t zone = 0; zone < 8; zone++){
+		board_input('K', zone, 0);		//zone contacts closed
+	}
+	displayTraceHook = seg_trace;
+	script_run(script, sizeof(script) / sizeof(script[0]), app_main);
+
+	CHECK(frames > 0);
+	printf("seg: %d frames, worst key to frame %lu ms, %.1f s\n", frames,
+		scriptWorst, (double)boardCycles / BOARD_HZ);
+	return test_done("seg");
+}
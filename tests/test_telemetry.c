@@ -0,0 +1,190 @@
+/*
+ * test_telemetry.c
+ *
+ * Host test for the telemetry frames (Telemetry.h) and CRC-16/MODBUS
+ * (CRC16.h). Frames are taken from the USART0 transmit buffer, split at
+ * the 0x00 delimiters, COBS decoded and checked the way a monitoring
+ * station would.
+ * Author : Jace Johnson
+ * Rev 1
+ */
+
+#include "../With LCD Screen_Security System and Code Entry/Telemetry.h"
+#include "Test.h"
+
+#define FRAME_MAX 64
+
+uint16_t crc_bitwise(const uint8_t* data, int len);
+int take_frame(uint8_t* frame);
+int cobs_decode(const uint8_t* in, int len, uint8_t* out);
+int check_frame(const uint8_t* frame, int len, uint8_t type, uint8_t seq);
+
+
+/*
+ * Function:  crc_bitwise
+ *  CRC-16/MODBUS one bit at a time, to check the table against.
+ *
+ *  data	uint8_t*	bytes to check
+ *  len		int			number of bytes
+ *
+ *  returns:    uint16_t	CRC of the bytes
+ */
+uint16_t crc_bitwise(const uint8_t* data, int len){
+	uint16_t crc = 0xFFFF;
+
+	for(int i = 0; i < len; i++){
+		crc ^= data[i];
+		for(int b = 0; b < 8; b++){
+			crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+		}
+	}
+	return crc;
+}
+
+/*
+ * Function:  take_frame
+ *  Takes the bytes up to and including the next 0x00 from the transmit
+ *  buffer, as the transmit interrupt would send them.
+ *
+ *  frame	uint8_t*	encoded frame without the delimiter (FRAME_MAX)
+ *
+ *  returns:    int		encoded length, -1 if there is no whole frame
+ */
+int take_frame(uint8_t* frame){
+	int len = 0;
+	uint8_t b;
+
+	while(txTail != txHead){
+		b = txBuf[txTail];
+		txTail = (txTail + 1) & TX_MASK;
+		if(b == 0x00){
+			return len;
+		}
+		if(len < FRAME_MAX){
+			frame[len++] = b;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Function:  cobs_decode
+ *  Decodes a COBS block sequence.
+ *
+ *  in		uint8_t*	encoded bytes, no 0x00
+ *  len		int			number of encoded bytes
+ *  out		uint8_t*	decoded bytes
+ *
+ *  returns:    int		decoded length, -1 if the encoding is broken
+ */
+int cobs_decode(const uint8_t* in, int len, uint8_t* out){
+	int n = 0;
+	int i = 0;
+	uint8_t code;
+
+	while(i < len){
+		code = in[i++];
+		if((code == 0) || (i + code - 1 > len)){
+			return -1;
+		}
+		for(int j = 1; j < code; j++){
+			if(in[i] == 0){
+				return -1;
+			}
+			out[n++] = in[i++];
+		}
+		if((code != 0xFF) && (i < len)){
+			out[n++] = 0x00;
+		}
+	}
+	return n;
+}
+
+/*
+ * Function:  check_frame
+ *  Checks the type, sequence number and CRC of a decoded frame.
+ *
+ *  frame	uint8_t*	decoded frame
+ *  len		int			decoded length
+ *  type	uint8_t		expected event type
+ *  seq		uint8_t		expected sequence number
+ *
+ *  returns:    1	frame is good
+ *		0	it is not
+ */
+int check_frame(const uint8_t* frame, int len, uint8_t type, uint8_t seq){
+	if(len < 4){
+		return 0;
+	}
+	return (frame[0] == type) && (frame[1] == seq) &&
+		(crc16(frame, len - 2) == (frame[len - 2] | (frame[len - 1] << 8))) &&
+		(crc16(frame, len) == 0);	//CRC over the CRC is 0
+}
+
+int main(){
+	const uint8_t check[] = "123456789";
+	uint8_t data[256];
+	uint8_t enc[FRAME_MAX];
+	uint8_t frame[FRAME_MAX];
+	int len;
+	uint8_t seq;
+
+	UCSR0A = (1<<UDRE0);		//a full buffer is sent by polling
+
+	//CRC check value and the table against the bitwise CRC
+	CHECK(crc16(check, 9) == 0x4B37);
+	for(int i = 0; i < 256; i++){
+		data[i] = i * 37 + 11;
+	}
+	for(int len = 0; len <= 256; len += 17){
+		CHECK(crc16(data, len) == crc_bitwise(data, len));
+	}
+
+	//no payload
+	seq = telSeq;
+	tel_event(TEL_ARM);
+	len = take_frame(enc);
+	CHECK(len > 0);
+	CHECK(memchr(enc, 0, len) == 0);
+	len = cobs_decode(enc, len, frame);
+	CHECK(len == 4);
+	CHECK(check_frame(frame, len, TEL_ARM, seq));
+
+	//zero payload byte is stuffed
+	tel_event8(TEL_ZONE_TRIP, 0);
+	len = cobs_decode(enc, take_frame(enc), frame);
+	CHECK(len == 5);
+	CHECK(check_frame(frame, len, TEL_ZONE_TRIP, seq + 1));
+	CHECK(frame[2] == 0);
+
+	//multi byte values are little endian, zeros inside and at the end
+	tel_begin(TEL_STATS);
+	tel_put32(0x00120034);
+	tel_put16(0x0100);
+	tel_put16(0);
+	tel_put16(0xFFFF);
+	tel_end();
+	len = cobs_decode(enc, take_frame(enc), frame);
+	CHECK(len == 2 + 10 + 2);
+	CHECK(check_frame(frame, len, TEL_STATS, seq + 2));
+	CHECK((frame[2] == 0x34) && (frame[3] == 0x00) && (frame[4] == 0x12) &&
+		(frame[5] == 0x00));
+	CHECK((frame[6] == 0x00) && (frame[7] == 0x01));
+	CHECK((frame[8] == 0x00) && (frame[9] == 0x00));
+
+	//frames keep coming when the buffer wraps, and the sequence counts up
+	for(int i = 0; i < 3 * TX_BUF_SIZE; i++){
+		tel_event8(TEL_KEYPRESS, i & 0x0F);
+		len = cobs_decode(enc, take_frame(enc), frame);
+		CHECK(check_frame(frame, len, TEL_KEYPRESS, (uint8_t)(seq + 3 + i)));
+	}
+
+	//a damaged frame is dropped
+	tel_event(TEL_DISARM);
+	len = take_frame(enc);
+	enc[len - 1] ^= 0x01;
+	len = cobs_decode(enc, len, frame);
+	CHECK(!check_frame(frame, len, TEL_DISARM, (uint8_t)(seq + 3 +
+		3 * TX_BUF_SIZE)));
+	return test_done("telemetry");
+}